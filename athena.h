@@ -1,81 +1,103 @@
-// athena.h - common db routines.
-
-#ifndef __ATHENA_H__
-#define __ATHENA_H__
-
-#include <WinSock2.h>
-
-#include <stdio.h>
-
-#include "adlist.h"
-#include "sds.h"
-
-// Some common definitions.
-#define va_copy(d, s) ((d) = (s))
-typedef size_t valType;
-
-#define QUERY_BUF_SIZE 512
-#define BG_STATUS_SLEEP 10000
-#define CLIENT_TIMEOUT 30
-
-typedef struct client
-{
-    SOCKET socket;
-    int fd;
-    FILE *rf, *wf;
-    sds queryBuf;
-    uintptr_t tid;
-} client;
-
-typedef struct server
-{
-    int working;
-    list *clients;
-    SOCKET listenSocket;
-    FD_SET listenSet;
-} server;
-
-// Command prototypes.
-typedef void (*athenaCommandProc)(FILE *f, int argc, sds *argv);
-typedef struct athenaCommand
-{
-    char *name;
-    size_t arity;
-    athenaCommandProc proc;
-    char argsDelim;
-} athenaCommand;
-
-int commandExecutor(client *c, const sds query);
-
-void setCommand(FILE *f, int argc, sds *argv);
-void delCommand(FILE *f, int argc, sds *argv);
-void existsCommand(FILE *f, int argc, sds *argv);
-void containsCommand(FILE *f, int argc, sds *argv);
-void renameCommand(FILE *f, int argc, sds *argv);
-void randsetCommand(FILE *f, int argc, sds *argv);
-void randCommand(FILE *f, int argc, sds *argv);
-void evalCommand(FILE *f, int argc, sds *argv);
-void addCommand(FILE *f, int argc,  sds *argv);
-void remCommand(FILE *f, int argc, sds *argv);
-void cardCommand(FILE *f, int argc, sds *argv);
-void movCommand(FILE *f, int argc, sds *argv);
-void popCommand(FILE *f, int argc, sds *argv);
-void lockCommand(FILE *f, int argc, sds *argv);
-void unlockCommand(FILE *f, int argc, sds *argv);
-void pingCommand(FILE *f, int argc, sds *argv);
-void quitCommand(FILE *f, int argc, sds *argv); // Handled separately.
-void shutdownCommand(FILE *f, int argc, sds *argv); // Handled separately.
-void flushallCommand(FILE *f, int argc, sds *argv);
-void gcCommand(FILE *f, int argc, sds *argv);
-void truncCommand(FILE *f, int argc, sds *argv);
-void indexCommand(FILE *f, int argc, sds *argv);
-void setsCommand(FILE *f, int argc, sds *argv);
-void eqCommand(FILE *f, int argc, sds *argv);
-void subeCommand(FILE *f, int argc, sds *argv);
-void subCommand(FILE *f, int argc, sds *argv);
-
-void eqCommand(FILE *f, int argc, sds *argv);
-void subeCommand(FILE *f, int argc, sds *argv);
-void subCommand(FILE *f, int argc, sds *argv);
-
-#endif __ATHENA_H__
+// athena.h - common db routines.
+
+#ifndef __ATHENA_H__
+#define __ATHENA_H__
+
+#include <WinSock2.h>
+
+#include <stdio.h>
+
+#include "adlist.h"
+#include "sds.h"
+
+// Some common definitions.
+#define va_copy(d, s) ((d) = (s))
+typedef size_t valType;
+
+#define QUERY_BUF_SIZE 512
+#define BG_STATUS_SLEEP 10000
+#define CLIENT_TIMEOUT 30
+#define TUPLE_INDEX_POSITIONS 2 // Tuple components at positions below this are indexed.
+#define SET_SIGNATURES 1 // Named sets keep MinHash signatures for SIMILAR, without them it scans every set.
+#define SET_SKETCHES 1 // Named sets keep HyperLogLog sketches for APPROXCARD, without them they are built per query.
+
+typedef struct client
+{
+    SOCKET socket;
+    int fd;
+    FILE *rf, *wf;
+    sds queryBuf;
+    uintptr_t tid;
+} client;
+
+typedef struct server
+{
+    int working;
+    list *clients;
+    SOCKET listenSocket;
+    FD_SET listenSet;
+} server;
+
+// Command prototypes.
+typedef void (*athenaCommandProc)(FILE *f, int argc, sds *argv);
+typedef struct athenaCommand
+{
+    char *name;
+    size_t arity;
+    athenaCommandProc proc;
+    char argsDelim;
+} athenaCommand;
+
+int initCommands(void);
+int commandExecutor(client *c, const sds query);
+
+void setCommand(FILE *f, int argc, sds *argv);
+void delCommand(FILE *f, int argc, sds *argv);
+void existsCommand(FILE *f, int argc, sds *argv);
+void containsCommand(FILE *f, int argc, sds *argv);
+void mcontainsCommand(FILE *f, int argc, sds *argv);
+void whichCommand(FILE *f, int argc, sds *argv);
+void renameCommand(FILE *f, int argc, sds *argv);
+void randsetCommand(FILE *f, int argc, sds *argv);
+void randCommand(FILE *f, int argc, sds *argv);
+void evalCommand(FILE *f, int argc, sds *argv);
+void addCommand(FILE *f, int argc,  sds *argv);
+void remCommand(FILE *f, int argc, sds *argv);
+// Reads members from client stream, so it gets the client instead of parsed arguments.
+void loadCommand(client *c, const char *args);
+void maddCommand(FILE *f, int argc, sds *argv);
+void mremCommand(FILE *f, int argc, sds *argv);
+void unionStoreCommand(FILE *f, int argc, sds *argv);
+void interStoreCommand(FILE *f, int argc, sds *argv);
+void diffStoreCommand(FILE *f, int argc, sds *argv);
+void cardCommand(FILE *f, int argc, sds *argv);
+void approxCardCommand(FILE *f, int argc, sds *argv);
+void movCommand(FILE *f, int argc, sds *argv);
+void popCommand(FILE *f, int argc, sds *argv);
+void lockCommand(FILE *f, int argc, sds *argv);
+void unlockCommand(FILE *f, int argc, sds *argv);
+void pingCommand(FILE *f, int argc, sds *argv);
+void quitCommand(FILE *f, int argc, sds *argv); // Handled separately.
+void shutdownCommand(FILE *f, int argc, sds *argv); // Handled separately.
+void flushallCommand(FILE *f, int argc, sds *argv);
+void gcCommand(FILE *f, int argc, sds *argv);
+void truncCommand(FILE *f, int argc, sds *argv);
+void indexCommand(FILE *f, int argc, sds *argv);
+void setsCommand(FILE *f, int argc, sds *argv);
+void scanCommand(FILE *f, int argc, sds *argv);
+void sscanCommand(FILE *f, int argc, sds *argv);
+void eqCommand(FILE *f, int argc, sds *argv);
+void subeCommand(FILE *f, int argc, sds *argv);
+void subCommand(FILE *f, int argc, sds *argv);
+void intersectsCommand(FILE *f, int argc, sds *argv);
+void disjointCommand(FILE *f, int argc, sds *argv);
+void subsetsCommand(FILE *f, int argc, sds *argv);
+void supersetsCommand(FILE *f, int argc, sds *argv);
+void similarCommand(FILE *f, int argc, sds *argv);
+void jaccardCommand(FILE *f, int argc, sds *argv);
+
+void eqCommand(FILE *f, int argc, sds *argv);
+void subeCommand(FILE *f, int argc, sds *argv);
+void subCommand(FILE *f, int argc, sds *argv);
+
+#endif __ATHENA_H__
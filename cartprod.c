@@ -0,0 +1,254 @@
+// cartprod.c - Lazy cartesian product.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <memory.h>
+
+#include "adlist.h"
+
+#include "athena.h"
+#include "dbengine.h"
+#include "dbobject.h"
+#include "tuple.h"
+#include "cartprod.h"
+
+cartProd *cartProdCreate(const set *a, const set *b)
+{
+    cartProd *cp = NULL;
+
+    if (NULL == a || NULL == b)
+        return NULL;
+
+    if (NULL == (cp = (cartProd *) calloc(1, sizeof(cartProd))))
+        return NULL;
+
+    if (NULL == (cp->a = setCopy(a)) ||
+        NULL == (cp->b = setCopy(b)))
+    {
+        cartProdDestroy(cp);
+        return NULL;
+    }
+
+    return cp;
+}
+
+void cartProdDestroy(cartProd *cp)
+{
+    if (NULL == cp)
+        return;
+
+    setDestroy(cp->a);
+    setDestroy(cp->b);
+    free(cp);
+}
+
+int cartProdCmp(const cartProd *x, const cartProd *y)
+{
+    if (NULL == x || NULL == y)
+        return -1;
+
+    // Products with an empty factor are all the same empty set.
+    if ((0 == x->a->card || 0 == x->b->card) &&
+        (0 == y->a->card || 0 == y->b->card))
+    {
+        return 1;
+    }
+
+    return 1 == setCmpE(x->a, y->a) && 1 == setCmpE(x->b, y->b);
+}
+
+int cartProdCard(valType aCard, valType bCard, valType *card)
+{
+    if (NULL == card || (0 != aCard && bCard > (valType) -1 / aCard))
+        return -1;
+
+    *card = aCard * bCard;
+    return 0;
+}
+
+int cartProdIsMember(const set *a, const set *b, list *t)
+{
+    if (NULL == a || NULL == b || NULL == t || 2 != listLength(t))
+        return 0;
+
+    return setIsMember(a, (valType) listNodeValue(listFirst(t))) &&
+           setIsMember(b, (valType) listNodeValue(listLast(t)));
+}
+
+set *cartProdInter(const set *a, const set *b, const set *s, int lock)
+{
+    setIterator *iter = NULL;
+    set *result = NULL;
+
+    if (NULL == a || NULL == b || NULL == s)
+        return NULL;
+
+    if (NULL == (result = setCreate()))
+        return NULL;
+
+    if (0 != setGetIter(s, &iter))
+    {
+        setDestroy(result);
+        return NULL;
+    }
+
+    if (NULL == iter)
+        return result;
+
+    while (0 == setGetNext(iter))
+    {
+        const dbObject *obj = dbGetObject(iter->val, lock);
+
+        if (NULL == obj || objectTuple != obj->objectType ||
+            !cartProdIsMember(a, b, obj->objectPtr.tuplePtr))
+        {
+            continue;
+        }
+
+        if (-1 == setAdd(result, iter->val))
+        {
+            setDestroyIter(iter);
+            setDestroy(result);
+            return NULL;
+        }
+    }
+
+    setDestroyIter(iter);
+    return result;
+}
+
+set *cartProdFlatten(const cartProd *cp, int lock)
+{
+    set *a = NULL, *b = NULL, *result = NULL;
+
+    if (NULL == cp)
+        return NULL;
+
+    if (NULL == (a = setFlatten(cp->a, lock)))
+        return NULL;
+
+    if (NULL == (b = setFlatten(cp->b, lock)))
+    {
+        setDestroy(a);
+        return NULL;
+    }
+
+    result = setUnion(a, b);
+    setDestroy(a);
+    setDestroy(b);
+    return result;
+}
+
+set *cartProdMaterialize(const cartProd *cp)
+{
+    if (NULL == cp)
+        return NULL;
+
+    return cartProdPairs(cp->a, cp->b);
+}
+
+set *cartProdPairs(const set *a, const set *b)
+{
+    set *result = NULL;
+    setIterator *aIter = NULL, *bIter = NULL, bIterStart;
+    tupleBatch *batch = NULL;
+    int failed = 0;
+
+    if (NULL == a || NULL == b || NULL == (result = setCreate()))
+        return NULL;
+
+    if (0 == a->card || 0 == b->card)
+        return result;
+
+    if (NULL == (batch = (tupleBatch *) calloc(1, sizeof(tupleBatch))) ||
+        0 != setGetIter(a, &aIter) || 0 != setGetIter(b, &bIter))
+    {
+        setDestroyIter(aIter);
+        free(batch);
+        setDestroy(result);
+        return NULL;
+    }
+
+    memcpy(&bIterStart, bIter, sizeof(setIterator));
+
+    while (!failed && 0 == setGetNext(aIter))
+    {
+        memcpy(bIter, &bIterStart, sizeof(setIterator));
+
+        while (!failed && 0 == setGetNext(bIter))
+            failed = 0 != tupleBatchAddPair(batch, aIter->val, bIter->val, result);
+    }
+
+    setDestroyIter(aIter);
+    setDestroyIter(bIter);
+
+    if (failed || 0 != tupleBatchFlush(batch, result))
+    {
+        tupleBatchDiscard(batch);
+        free(batch);
+        setDestroy(result);
+        return NULL;
+    }
+
+    free(batch);
+    return result;
+}
+
+int cartProdPrint(const cartProd *cp, reply *r, int lock)
+{
+    setIterator *aIter = NULL, *bIter = NULL, bIterStart;
+    valType card = 0, counter = 0;
+    const dbObject *a = NULL, *b = NULL;
+    int result = 0;
+
+    if (NULL == cp || NULL == r || 0 != cartProdCard(cp->a->card, cp->b->card, &card))
+        return -1;
+
+    if (0 != replyStr(r, "{ "))
+        return -1;
+
+    if (0 == card)
+        return 0 == replyStr(r, "}") ? 0 : -1;
+
+    if (0 != setGetIter(cp->a, &aIter) || NULL == aIter)
+        return -1;
+
+    if (0 != setGetIter(cp->b, &bIter) || NULL == bIter)
+    {
+        setDestroyIter(aIter);
+        return -1;
+    }
+
+    memcpy(&bIterStart, bIter, sizeof(setIterator));
+
+    // Stops at the first failed write, like powerSetPrint.
+    while (0 == result && 0 == setGetNext(aIter))
+    {
+        memcpy(bIter, &bIterStart, sizeof(setIterator));
+        a = dbGetObject(aIter->val, lock);
+
+        while (0 == result && 0 == setGetNext(bIter))
+        {
+            b = dbGetObject(bIter->val, lock);
+
+            result |= replyStr(r, "[ ");
+            result |= NULL != a ? replyObject(r, a, lock) : replyStr(r, "(null)");
+            result |= replyStr(r, ", ");
+            result |= NULL != b ? replyObject(r, b, lock) : replyStr(r, "(null)");
+            result |= replyStr(r, " ]");
+
+            counter++;
+            if (counter < card)
+                result |= replyStr(r, ",");
+
+            result |= replyStr(r, " ");
+        }
+    }
+
+    if (0 == result)
+        result |= replyStr(r, "}");
+
+    setDestroyIter(aIter);
+    setDestroyIter(bIter);
+    return 0 == result ? 0 : -1;
+}
@@ -0,0 +1,44 @@
+// cartprod.h - Lazy cartesian product.
+
+#ifndef __CARTPROD_H__
+#define __CARTPROD_H__
+
+#include <stdio.h>
+
+#include "adlist.h"
+
+#include "athena.h"
+#include "set.h"
+#include "reply.h"
+
+// Cartesian product a x b. Pair tuples are never stored, they are enumerated on demand.
+typedef struct cartProd
+{
+    set *a, *b;
+} cartProd;
+
+// Creates cartesian product of copies of a and b. Returns NULL on error.
+cartProd *cartProdCreate(const set *a, const set *b);
+// Destroys cartesian product.
+void cartProdDestroy(cartProd *cp);
+
+// Compares given cartesian products. Returns 1 on eq, 0 on not eq, -1 on error.
+int cartProdCmp(const cartProd *x, const cartProd *y);
+// Sets *card to aCard * bCard. Returns -1 if it doesn't fit in valType.
+int cartProdCard(valType aCard, valType bCard, valType *card);
+// Returns 1 if tuple t is a pair [ x, y ] with x in a and y in b, 0 otherwise.
+int cartProdIsMember(const set *a, const set *b, list *t);
+// Returns set of members of s which are members of a x b or NULL on error.
+set *cartProdInter(const set *a, const set *b, const set *s, int lock);
+// Returns flattened cartesian product or NULL on error.
+set *cartProdFlatten(const cartProd *cp, int lock);
+// Builds and registers every pair. Returns set of pair ids or NULL on error.
+set *cartProdMaterialize(const cartProd *cp);
+// Builds every pair [ x, y ] of x in a and y in b and registers them in batches.
+// Returns set of pair ids or NULL on error.
+set *cartProdPairs(const set *a, const set *b);
+
+// Prints pairs in the order of a, then b. Returns -1 on error.
+int cartProdPrint(const cartProd *cp, reply *r, int lock);
+
+#endif /* __CARTPROD_H__ */
@@ -1,141 +1,247 @@
-// command.c - Command definitions and execution.
-
-#include "athena.h"
-#include "command.h"
-
-static struct athenaCommand commandList[] =
-    {
-        { "set", 2, setCommand, ' ' },
-        { "del", 1, delCommand, ' ' },
-        { "exists", 1, existsCommand, ' ' },
-        { "contains", 2, containsCommand, ' ' },
-        { "rename", 2, renameCommand, ' ' },
-        { "randset", 0, randsetCommand, ' ' },
-        { "rand", 1, randCommand, ' ' },
-        { "eval", 1, evalCommand, ' ' },
-        { "add", 2, addCommand, ' ' },
-        { "rem", 2, remCommand, ' ' },
-        { "card", 1, cardCommand, ' ' },
-        { "mov", 3, movCommand, ' ' },
-        { "pop", 1, popCommand, ' ' },
-        { "lock", 1, lockCommand, ' ' },
-        { "unlock", 1, unlockCommand, ' ' },
-        { "ping", 0, pingCommand, ' ' },
-        { "quit", 0, NULL, ' ' },
-        { "shutdown", 0, NULL, ' ' },
-        { "flushall", 0, flushallCommand, ' ' },
-        { "gc", 0, gcCommand, ' ' },
-        { "trunc", 0, truncCommand, ' ' },
-        { "index", 0, indexCommand, ' ' },
-        { "sets", 0, setsCommand, ' ' },
-        { "eq", 2, eqCommand, '.' },
-        { "sube", 2, subeCommand, '.' },
-        { "sub", 2, subCommand, '.' }
-    };
-
-int commandExecutor(client *c, const sds query)
-{
-    size_t i;
-    sds command = NULL;
-    char *p = NULL;
-    athenaCommand *cmdDescription = NULL;
-
-    if (NULL == c || NULL == c->wf || NULL == query || 0 == strlen(query))
-        return 0;
-
-    if (NULL != (p = strchr(query, ' ')))
-    {
-        command = sdsnewlen(query, p - query);
-    }
-    else
-    {
-        command = sdsnew(query);
-    }
-
-    for (i = 0; i < sizeof(commandList) / sizeof(athenaCommand); i++)
-        if (0 == strcmp(command, commandList[i].name))
-        {
-            cmdDescription = &commandList[i];
-            break;
-        }
-
-    if (NULL != cmdDescription)
-    {
-        if (NULL != commandList[i].proc)
-        {
-            size_t argc = commandList[i].arity;
-            sds *argv = NULL;
-
-            if (0 == argc)
-            {
-                commandList[i].proc(c->wf, argc, argv);
-                return 0;
-            }
-            else
-            {
-                char *n = NULL;
-                size_t argsCounter = 0;
-                char delim = commandList[i].argsDelim;
-                argv = (sds *) calloc(argc, sizeof(sds));
-
-                if (NULL != p)
-                {
-                    while (isspace(*p))
-                        p++;
-
-                    do
-                    {
-                        if (NULL == (n = strchr(p, delim)) || argsCounter == argc - 1)
-                        {
-                            argv[argsCounter] = sdsnew(p);
-                        }
-                        else
-                        {
-                            argv[argsCounter] = sdsnewlen(p, n - p);
-                        }
-
-                        p = n + 1;
-                        argsCounter++;
-                    }
-                    while (argsCounter < argc && NULL != n);
-                }
-
-                while (argsCounter < argc)
-                {
-                    argv[argsCounter++] = NULL;
-                }
-
-                if (argsCounter == argc)
-                {
-                    commandList[i].proc(c->wf, argc, argv);
-                }
-
-                for (i = 0; i < argsCounter; i++)
-                {
-                    if (NULL != argv[i])
-                        sdsfree(argv[i]);
-                }
-                free(argv);
-
-                return 0;
-            }
-        }
-        else
-        {
-            if (0 == strcmp("quit", command))
-            {
-                fprintf(c->wf, "Bye.\r\n");
-                return -1;
-            }
-            else if (0 == strcmp("shutdown", command))
-            {
-                fprintf(c->wf, "Bye.\r\n");
-                return -2;
-            }
-        }
-    }
-
-    fprintf(c->wf, "Unknown command.\r\n");
-    sdsfree(command);
-    return 0;
-}
+// command.c - Command definitions and execution.
+
+#include <memory.h>
+#include <ctype.h>
+
+#include "athena.h"
+#include "command.h"
+
+#define COMMAND_SLOTS 128               // Perfect hash table size, power of two.
+#define COMMAND_MAX_ARITY 3
+#define COMMAND_ARGS_BUF_SIZE 1024      // Stack arena for argument views.
+
+static char *findArgsDelim(const char *s, char delim);
+static unsigned commandHash(const char *name, size_t len, unsigned seed);
+static const athenaCommand *commandLookup(const char *name, size_t len);
+static sds commandArg(char *arena, size_t *used, const char *p, size_t len, int *onHeap);
+
+static struct athenaCommand commandList[] =
+    {
+        { "set", 2, setCommand, ' ' },
+        { "del", 1, delCommand, ' ' },
+        { "exists", 1, existsCommand, ' ' },
+        { "contains", 2, containsCommand, ' ' },
+        { "mcontains", 2, mcontainsCommand, ' ' },
+        { "which", 1, whichCommand, ' ' },
+        { "rename", 2, renameCommand, ' ' },
+        { "randset", 0, randsetCommand, ' ' },
+        { "rand", 2, randCommand, ' ' },
+        { "eval", 1, evalCommand, ' ' },
+        { "add", 2, addCommand, ' ' },
+        { "rem", 2, remCommand, ' ' },
+        { "madd", 2, maddCommand, ' ' },
+        { "mrem", 2, mremCommand, ' ' },
+        { "unionstore", 2, unionStoreCommand, ' ' },
+        { "interstore", 2, interStoreCommand, ' ' },
+        { "diffstore", 2, diffStoreCommand, ' ' },
+        { "load", 1, NULL, ' ' },
+        { "card", 1, cardCommand, ' ' },
+        { "approxcard", 1, approxCardCommand, ' ' },
+        { "mov", 3, movCommand, ' ' },
+        { "pop", 2, popCommand, ' ' },
+        { "lock", 1, lockCommand, ' ' },
+        { "unlock", 1, unlockCommand, ' ' },
+        { "ping", 0, pingCommand, ' ' },
+        { "quit", 0, NULL, ' ' },
+        { "shutdown", 0, NULL, ' ' },
+        { "flushall", 0, flushallCommand, ' ' },
+        { "gc", 0, gcCommand, ' ' },
+        { "trunc", 0, truncCommand, ' ' },
+        { "index", 1, indexCommand, ' ' },
+        { "sets", 0, setsCommand, ' ' },
+        { "scan", 1, scanCommand, ' ' },
+        { "sscan", 2, sscanCommand, ' ' },
+        { "eq", 2, eqCommand, '.' },
+        { "sube", 2, subeCommand, '.' },
+        { "sub", 2, subCommand, '.' },
+        { "intersects", 2, intersectsCommand, '.' },
+        { "disjoint", 2, disjointCommand, '.' },
+        { "subsets", 2, subsetsCommand, ' ' },
+        { "supersets", 2, supersetsCommand, ' ' },
+        { "similar", 1, similarCommand, ' ' },
+        { "jaccard", 2, jaccardCommand, '.' }
+    };
+
+static unsigned char commandSlots[COMMAND_SLOTS]; // Index in commandList plus one, 0 for empty slot.
+static unsigned commandSeed;
+
+int initCommands(void)
+{
+    size_t i, count = sizeof(commandList) / sizeof(athenaCommand);
+    unsigned slot;
+
+    // Seed is searched once at startup, so adding a command doesn't need a regenerated table.
+    for (commandSeed = 0; commandSeed < 0x10000; commandSeed++)
+    {
+        memset(commandSlots, 0, sizeof(commandSlots));
+
+        for (i = 0; i < count; i++)
+        {
+            if (commandList[i].arity > COMMAND_MAX_ARITY)
+                return -1;
+
+            slot = commandHash(commandList[i].name, strlen(commandList[i].name), commandSeed);
+
+            if (0 != commandSlots[slot])
+                break;
+
+            commandSlots[slot] = (unsigned char) (i + 1);
+        }
+
+        if (i == count)
+            return 0;
+    }
+
+    return -1;
+}
+
+int commandExecutor(client *c, const sds query)
+{
+    union
+    {
+        int align;
+        char bytes[COMMAND_ARGS_BUF_SIZE];
+    } arena;
+    sds argv[COMMAND_MAX_ARITY];
+    int onHeap[COMMAND_MAX_ARITY];
+    size_t i, argc = 0, used = 0, queryLen;
+    const char *p = NULL, *n = NULL;
+    const athenaCommand *cmd = NULL;
+
+    if (NULL == c || NULL == c->wf || NULL == query || '\0' == query[0])
+        return 0;
+
+    // Query buffer is filled by fgets, so its sds length isn't maintained.
+    queryLen = strlen(query);
+    p = (const char *) memchr(query, ' ', queryLen);
+
+    if (NULL == (cmd = commandLookup(query, NULL != p ? (size_t) (p - query) : queryLen)))
+    {
+        fprintf(c->wf, "Unknown command.\r\n");
+        return 0;
+    }
+
+    if (NULL == cmd->proc)
+    {
+        if (0 == strcmp("quit", cmd->name))
+        {
+            fprintf(c->wf, "Bye.\r\n");
+            return -1;
+        }
+        else if (0 == strcmp("shutdown", cmd->name))
+        {
+            fprintf(c->wf, "Bye.\r\n");
+            return -2;
+        }
+        else if (0 == strcmp("load", cmd->name))
+        {
+            loadCommand(c, NULL != p ? p : "");
+        }
+
+        return 0;
+    }
+
+    if (0 == cmd->arity)
+    {
+        cmd->proc(c->wf, 0, NULL);
+        return 0;
+    }
+
+    // Arguments are sds views in a stack arena, the heap is used only for the ones which don't fit.
+    if (NULL != p)
+    {
+        while (isspace((unsigned char) *p))
+            p++;
+
+        do
+        {
+            n = argc == cmd->arity - 1 ? NULL : findArgsDelim(p, cmd->argsDelim);
+            argv[argc] = commandArg(arena.bytes, &used, p, NULL != n ? (size_t) (n - p) : strlen(p), &onHeap[argc]);
+
+            if (NULL == argv[argc])
+                break;
+
+            argc++;
+            p = n + 1;
+        }
+        while (argc < cmd->arity && NULL != n);
+    }
+
+    for (i = argc; i < cmd->arity; i++)
+    {
+        argv[i] = NULL;
+        onHeap[i] = 0;
+    }
+
+    cmd->proc(c->wf, cmd->arity, argv);
+
+    for (i = 0; i < argc; i++)
+        if (onHeap[i])
+            sdsfree(argv[i]);
+
+    return 0;
+}
+
+// Private api.
+// Returns first delim in s or NULL. Dots of range literals aren't argument delimiters.
+static char *findArgsDelim(const char *s, char delim)
+{
+    while (NULL != (s = strchr(s, delim)) && '.' == delim && '.' == s[1])
+        s += 2;
+
+    return (char *) s;
+}
+
+// FNV-1a of name mixed with seed, reduced to a slot.
+static unsigned commandHash(const char *name, size_t len, unsigned seed)
+{
+    unsigned h = 2166136261u ^ (seed * 0x9E3779B9u);
+
+    while (len--)
+    {
+        h ^= (unsigned char) *name++;
+        h *= 16777619u;
+    }
+
+    return (h ^ (h >> 16)) & (COMMAND_SLOTS - 1);
+}
+
+// Returns command named by len bytes at name or NULL.
+static const athenaCommand *commandLookup(const char *name, size_t len)
+{
+    unsigned char slot = commandSlots[commandHash(name, len, commandSeed)];
+    const athenaCommand *cmd = NULL;
+
+    if (0 == slot)
+        return NULL;
+
+    cmd = &commandList[slot - 1];
+
+    if (0 != strncmp(cmd->name, name, len) || '\0' != cmd->name[len])
+        return NULL;
+
+    return cmd;
+}
+
+// Returns read-only sds copy of len bytes at p placed in arena at *used, or on the heap with *onHeap set
+// if the arena is full. Returns NULL on error.
+static sds commandArg(char *arena, size_t *used, const char *p, size_t len, int *onHeap)
+{
+    struct sdshdr *sh = NULL;
+    size_t need = sizeof(struct sdshdr) + len + 1;
+
+    *onHeap = *used + need > COMMAND_ARGS_BUF_SIZE;
+
+    if (*onHeap)
+        return sdsnewlen(p, len);
+
+    sh = (struct sdshdr *) (arena + *used);
+    sh->len = (int) len;
+    sh->free = 0;
+    memcpy(sh->buf, p, len);
+    sh->buf[len] = '\0';
+
+    // Next header stays aligned.
+    *used += (need + sizeof(int) - 1) & ~(sizeof(int) - 1);
+    return sh->buf;
+}
@@ -1,8 +1,10 @@
-// command.h - Command definitions and execution.
-
-#ifndef __COMMAND_H__
-#define __COMMAND_H__
-
-int commandExecutor(client *c, const sds query);
-
-#endif /* __COMMAND_H__ */
+// command.h - Command definitions and execution.
+
+#ifndef __COMMAND_H__
+#define __COMMAND_H__
+
+// Builds command dispatch table. Returns 0 on ok, -1 on error.
+int initCommands(void);
+int commandExecutor(client *c, const sds query);
+
+#endif /* __COMMAND_H__ */
@@ -1,928 +1,1765 @@
-// commands.c - Command implementations.
-
-#include <stddef.h>
-
-#include "dict.h"
-
-#include "dbengine.h"
-#include "syncengine.h"
-#include "athena.h"
-#include "eval.h"
-#include "setutils.h"
-
-void setCommand(FILE *f, int argc, sds *argv)
-{
-    sds newSet = NULL, expr = NULL;
-    dbObject *newSetValue = NULL;
-
-    if (NULL == f || NULL == argv)
-        return;
-
-    if (0 == argc)
-    {
-        fprintf(f, "Expected 1 or 2 arguments.\r\n");
-        return;
-    }
-
-    newSet = argv[0];
-    expr = 2 == argc ? argv[1] : NULL;
-
-    if (NULL == newSet || 0 == strlen(newSet))
-    {
-        fprintf(f, "Bad set name.\r\n");
-        return;
-    }
-
-    if (NULL == expr)
-    {
-        valType newSetId;
-
-        if (NULL == (newSetValue = (dbObject *) calloc(1, sizeof(dbObject))))
-        {
-            fprintf(f, "ERROR.\r\n");
-            return;
-        }
-
-        if (NULL == (newSetValue->objectPtr.setPtr = setCreate()))
-        {
-            free(newSetValue);
-            fprintf(f, "ERROR.\r\n");
-            return;
-        }
-
-        newSetValue->objectType = objectSet;
-
-        if (0 != dbRegisterObject(&newSetValue, &newSetId))
-        {
-            dbObjectRelease(newSetValue);
-            free(newSetValue);
-            fprintf(f, "ERROR.\r\n");
-            return;
-        }
-    }
-    else
-    {
-        size_t pos = 0;
-        if (NULL == (newSetValue = eval(expr, &pos)))
-        {
-            fprintf(f, "ERROR.\r\n");
-            return;
-        }
-    }
-
-    if (objectSet != newSetValue->objectType)
-    {
-        fprintf(f, "Wrong initializer type.\r\n");
-        return;
-    }
-
-    if (0 == dbSet(newSet, newSetValue->objectPtr.setPtr))
-    {
-        fprintf(f, "OK.\r\n");
-    }
-    else
-    {
-        fprintf(f, "ERROR.\r\n");
-    }
-}
-
-void delCommand(FILE *f, int argc, sds *argv)
-{
-    sds setName = NULL;
-
-    if (NULL == f || NULL == argv)
-        return;
-
-    if (1 != argc)
-    {
-        fprintf(f, "Expected 1 argument.\r\n");
-        return;
-    }
-
-    if (NULL == (setName = argv[0]) || 0 == strlen(setName))
-    {
-        fprintf(f, "Bad set name.\r\n");
-        return;
-    }
-
-    if (NULL == dbGet(setName))
-    {
-        fprintf(f, "ERROR.\r\n");
-        return;
-    }
-
-    if (DICT_OK != dbRemove(setName))
-    {
-        fprintf(f, "ERROR.\r\n");
-        return;
-    }
-
-    fprintf(f, "OK.\r\n");
-}
-
-void existsCommand(FILE *f, int argc, sds *argv)
-{
-    sds setName = NULL;
-
-    if (NULL == f || NULL == argv)
-        return;
-
-    if (1 != argc)
-    {
-        fprintf(f, "Expected 1 argument.\r\n");
-        return;
-    }
-
-    if (NULL == (setName = argv[0]) || 0 == strlen(setName))
-    {
-        fprintf(f, "Bad set name.\r\n");
-        return;
-    }
-
-    if (NULL == dbGet(setName))
-    {
-        fprintf(f, "0\r\n");
-        return;
-    }
-
-    fprintf(f, "1\r\n");
-}
-
-void containsCommand(FILE *f, int argc, sds *argv)
-{
-    sds setName = NULL, member = NULL;
-    valType memberId = 0;
-    const set *container = NULL;
-
-    if (NULL == f || NULL == argv)
-        return;
-
-    if (2 != argc)
-    {
-        fprintf(f, "Expected 2 arguments.\r\n");
-        return;
-    }
-
-    if (NULL == (setName = argv[0]) || 0 == strlen(setName))
-    {
-        fprintf(f, "Bad set name.\r\n");
-        return;
-    }
-
-    if (NULL == (member = argv[1]) || 0 == strlen(member))
-    {
-        fprintf(f, "Bad set member.\r\n");
-        return;
-    }
-
-    if (NULL == (container = dbGet(setName)))
-    {
-        fprintf(f, "0\r\n");
-        return;
-    }
-
-    lockRead(container);
-
-    if (NULL == dbObjectParse(member, &memberId))
-    {
-        unlockRead(container);
-        fprintf(f, "Bad set member.\r\n");
-        return;
-    }
-
-    if (!setIsMember(container, memberId))
-    {
-        unlockRead(container);
-        fprintf(f, "0\r\n");
-        return;
-    }
-
-    unlockRead(container);
-    fprintf(f, "1\r\n");
-}
-
-void renameCommand(FILE *f, int argc, sds *argv)
-{
-    sds oldSetName = NULL, newSetName = NULL;
-
-    if (NULL == f || NULL == argv)
-        return;
-
-    if (2 != argc)
-    {
-        fprintf(f, "Expected 2 arguments.\r\n");
-        return;
-    }
-
-    if (NULL == (oldSetName = argv[0]) || 0 == strlen(oldSetName) ||
-        NULL == (newSetName = argv[1]) || 0 == strlen(newSetName))
-    {
-        fprintf(f, "Bad set name.\r\n");
-        return;
-    }
-
-    if (NULL == dbGet(oldSetName))
-    {
-        fprintf(f, "Set doesn't exist.\r\n");
-        return;
-    }
-
-    if (NULL != dbGet(newSetName))
-    {
-        fprintf(f, "Set with desired new name already exists.\r\n");
-        return;
-    }
-
-    if (0 != dbRename(oldSetName, newSetName))
-    {
-        fprintf(f, "ERROR.\r\n");
-        return;
-    }
-
-    fprintf(f, "OK.\r\n");
-}
-
-void randsetCommand(FILE *f, int argc, sds *argv)
-{
-    sds randSetName = NULL;
-    set *randSet = NULL;
-
-    if (NULL == f)
-        return;
-
-    if (NULL != (randSetName = dbGetRandSet()))
-    {
-        fprintf(f, "%s\r\n", randSetName);
-        randSet = (set *) dbGet(randSetName); 
-        lockRead(randSet);
-        setPrint(randSet, f, 1);
-        unlockRead(randSet);
-        fprintf(f, "\r\n");
-    }
-    else
-    {
-        fprintf(f, "No any sets in db.\r\n");
-    }
-}
-
-void randCommand(FILE *f, int argc, sds *argv)
-{
-    sds setName = NULL;
-    const set *targetSet = NULL;
-    valType randMemberId = 0;
-    const dbObject *targetObject = NULL;
-
-    if (NULL == f || NULL == argv)
-        return;
-
-    if (1 != argc)
-    {
-        fprintf(f, "Expected 1 argument.\r\n");
-        return;
-    }
-
-    if (NULL == (setName = argv[0]) || 0 == strlen(setName))
-    {
-        fprintf(f, "Bad set name.\r\n");
-        return;
-    }
-
-    if (NULL == (targetSet = dbGet(setName)))
-    {
-        fprintf(f, "Set doesn't exist.\r\n");
-        return;
-    }
-
-    lockRead(targetSet);
-    if (0 != setGetRand(targetSet, &randMemberId))
-    {
-        unlockRead(targetSet);
-        fprintf(f, "ERROR.\r\n");
-        return;
-    }
-
-    if (NULL == (targetObject = dbGetObject(randMemberId, 1)))
-    {
-        unlockRead(targetSet);
-        fprintf(f, "ERROR.\r\n");
-        return;
-    }
-
-    if (0 != dbObjectPrint(targetObject, f, 1))
-    {
-        unlockRead(targetSet);
-        fprintf(f, "ERROR.\r\n");
-    }
-
-    fprintf(f, "\r\n");
-
-    unlockRead(targetSet);
-}
-
-void evalCommand(FILE *f, int argc, sds *argv)
-{
-    sds expr = NULL;
-    size_t pos = 0;
-    dbObject *result = NULL;
-
-    if (NULL == f || NULL == argv)
-        return;
-
-    if (1 != argc)
-    {
-        fprintf(f, "Expected 1 argument.\r\n");
-        return;
-    }
-
-    if (NULL == (expr = argv[0]) || 0 == strlen(expr))
-    {
-        fprintf(f, "Bad expression.\r\n");
-        return;
-    }
-
-    if (NULL == (result = eval(expr, &pos)))
-    {
-        fprintf(f, "ERROR.\r\n");
-        return;
-    }
-
-    if (0 != dbObjectPrint(result, f, 1))
-    {
-        fprintf(f, "ERROR.\r\n");
-        return;
-    }
-
-    fprintf(f, "\r\n");
-}
-
-void addCommand(FILE *f, int argc,  sds *argv)
-{
-    sds setName = NULL, member = NULL;
-    valType memberId = 0;
-    set *container = NULL;
-
-    if (NULL == f || NULL == argv)
-        return;
-
-    if (2 != argc)
-    {
-        fprintf(f, "Expected 2 arguments.\r\n");
-        return;
-    }
-
-    if (NULL == (setName = argv[0]) || 0 == strlen(setName))
-    {
-        fprintf(f, "Bad set name.\r\n");
-        return;
-    }
-
-    if (NULL == (member = argv[1]) || 0 == strlen(member))
-    {
-        fprintf(f, "Bad set member.\r\n");
-        return;
-    }
-
-    if (NULL == (container = (set *) dbGet(setName)))
-    {
-        fprintf(f, "Set doesn't exist.\r\n");
-        return;
-    }
-
-    if (NULL == dbObjectParse(member, &memberId))
-    {
-        fprintf(f, "Bad set member.\r\n");
-        return;
-    }
-
-    lockWrite(container);
-    if (-1 == setAdd(container, memberId))
-    {
-        unlockWrite(container);
-        fprintf(f, "ERROR.\r\n");
-        return;
-    }
-
-    unlockWrite(container);
-    fprintf(f, "OK.\r\n");
-}
-
-void remCommand(FILE *f, int argc, sds *argv)
-{
-    sds setName = NULL, member = NULL;
-    valType memberId = 0;
-    set *container = NULL;
-
-    if (NULL == f || NULL == argv)
-        return;
-
-    if (2 != argc)
-    {
-        fprintf(f, "Expected 2 arguments.\r\n");
-        return;
-    }
-
-    if (NULL == (setName = argv[0]) || 0 == strlen(setName))
-    {
-        fprintf(f, "Bad set name.\r\n");
-        return;
-    }
-
-    if (NULL == (member = argv[1]) || 0 == strlen(member))
-    {
-        fprintf(f, "Bad set member.\r\n");
-        return;
-    }
-
-    if (NULL == (container = (set *) dbGet(setName)))
-    {
-        fprintf(f, "Set doesn't exist.\r\n");
-        return;
-    }
-
-    if (NULL == dbObjectParse(member, &memberId))
-    {
-        fprintf(f, "Bad set member.\r\n");
-        return;
-    }
-
-    lockWrite(container);
-    if (-1 == setRemove(container, memberId))
-    {
-        unlockWrite(container);
-        fprintf(f, "ERROR.\r\n");
-        return;
-    }
-
-    unlockWrite(container);
-    fprintf(f, "OK.\r\n");
-}
-
-void cardCommand(FILE *f, int argc, sds *argv)
-{
-    sds setName = NULL;
-    dbObject *targetSet = NULL;
-    size_t pos = 0;
-
-    if (NULL == f || NULL == argv)
-        return;
-
-    if (1 != argc)
-    {
-        fprintf(f, "Expected 1 argument.\r\n");
-        return;
-    }
-
-    if (NULL == (setName = argv[0]) || 0 == strlen(setName))
-    {
-        fprintf(f, "Bad set name.\r\n");
-        return;
-    }
-
-    if (NULL == (targetSet = eval(setName, &pos)))
-    {
-        fprintf(f, "Set doesn't exist.\r\n");
-        return;
-    }
-
-    if (objectSet != targetSet->objectType)
-    {
-        fprintf(f, "Not a set result.\r\n");
-        return;
-    }
-
-    fprintf(f, "%u\r\n", setCard(targetSet->objectPtr.setPtr));
-}
-
-void movCommand(FILE *f, int argc, sds *argv)
-{
-    sds fromSetName = NULL, toSetName = NULL, member = NULL;
-    set *fromSet = NULL, *toSet = NULL;
-    valType memberId = 0;
-
-    if (NULL == f || NULL == argv)
-        return;
-
-    if (3 != argc)
-    {
-        fprintf(f, "Expected 3 arguments.\r\n");
-        return;
-    }
-
-    if (NULL == (fromSetName = argv[0]) || 0 == strlen(fromSetName) ||
-        NULL == (toSetName = argv[1]) || 0 == strlen(toSetName))
-    {
-        fprintf(f, "Bad set name.\r\n");
-        return;
-    }
-
-    if (NULL == (member = argv[2]) || 0 == strlen(member))
-    {
-        fprintf(f, "Bad member.\r\n");
-        return;
-    }
-
-    if (NULL == (fromSet = (set *) dbGet(fromSetName)) ||
-        NULL == (toSet = (set *) dbGet(toSetName)))
-    {
-        fprintf(f, "Set doesn't exist.\r\n");
-        return;
-    }
-
-    if (NULL == dbObjectParse(member, &memberId))
-    {
-        fprintf(f, "Bad set member.\r\n");
-        return;
-    }
-
-    lockWrite(fromSet);
-    if (!setIsMember(fromSet, memberId))
-    {
-        unlockWrite(fromSet);
-        fprintf(f, "From set doesn't contain member.\r\n");
-        return;
-    }
-
-    lockWrite(toSet);
-    if (-1 == setAdd(toSet, memberId) ||
-        -1 == setRemove(fromSet, memberId))
-    {
-        unlockWrite(fromSet);
-        unlockWrite(toSet);
-        fprintf(f, "ERROR.\r\n");
-        return;
-    }
-
-    unlockWrite(fromSet);
-    unlockWrite(toSet);
-    fprintf(f, "OK.\r\n");
-}
-
-void popCommand(FILE *f, int argc, sds *argv)
-{
-    sds setName = NULL;
-    set *targetSet = NULL;
-    valType randMemberId = 0;
-    const dbObject *targetObject = NULL;
-
-    if (NULL == f || NULL == argv)
-        return;
-
-    if (1 != argc)
-    {
-        fprintf(f, "Expected 1 argument.\r\n");
-        return;
-    }
-
-    if (NULL == (setName = argv[0]) || 0 == strlen(setName))
-    {
-        fprintf(f, "Bad set name.\r\n");
-        return;
-    }
-
-    if (NULL == (targetSet = (set *) dbGet(setName)))
-    {
-        fprintf(f, "Set doesn't exist.\r\n");
-        return;
-    }
-
-    lockWrite(targetSet);
-    if (0 != setGetRand(targetSet, &randMemberId))
-    {
-        unlockWrite(targetSet);
-        fprintf(f, "ERROR.\r\n");
-        return;
-    }
-
-    if (NULL == (targetObject = dbGetObject(randMemberId, 1)))
-    {
-        unlockWrite(targetSet);
-        fprintf(f, "ERROR.\r\n");
-        return;
-    }
-
-    if (0 != dbObjectPrint(targetObject, f, 1))
-    {
-        unlockWrite(targetSet);
-        fprintf(f, "ERROR.\r\n");
-    }
-
-    fprintf(f, "\r\n");
-
-    setRemove(targetSet, randMemberId);
-
-    unlockWrite(targetSet);
-}
-
-void lockCommand(FILE *f, int argc, sds *argv)
-{
-    sds setName = NULL;
-    set *targetSet = NULL;
-
-    if (NULL == f || NULL == argv)
-        return;
-
-    if (1 != argc)
-    {
-        fprintf(f, "Expected 1 argument.\r\n");
-        return;
-    }
-
-    if (NULL == (setName = argv[0]) || 0 == strlen(setName))
-    {
-        fprintf(f, "Bad set name.\r\n");
-        return;
-    }
-
-    if (NULL == (targetSet = (set *) dbGet(setName)))
-    {
-        fprintf(f, "Set doesn't exist.\r\n");
-        return;
-    }
-
-    lockWrite(targetSet);
-    fprintf(f, "OK.\r\n");
-}
-
-void unlockCommand(FILE *f, int argc, sds *argv)
-{
-    sds setName = NULL;
-    set *targetSet = NULL;
-
-    if (NULL == f || NULL == argv)
-        return;
-
-    if (1 != argc)
-    {
-        fprintf(f, "Expected 1 argument.\r\n");
-        return;
-    }
-
-    if (NULL == (setName = argv[0]) || 0 == strlen(setName))
-    {
-        fprintf(f, "Bad set name.\r\n");
-        return;
-    }
-
-    if (NULL == (targetSet = (set *) dbGet(setName)))
-    {
-        fprintf(f, "Set doesn't exist.\r\n");
-        return;
-    }
-
-    unlockWrite(targetSet);
-    fprintf(f, "OK.\r\n");
-}
-
-void pingCommand(FILE *f, int argc, sds *argv)
-{
-    if (NULL == f)
-        return;
-
-    fprintf(f, "PONG.\r\n");
-}
-
-void flushallCommand(FILE *f, int argc, sds *argv)
-{
-    if (NULL == f)
-        return;
-
-    if (0 != dbFlushAll())
-    {
-        fprintf(f, "ERROR.\r\n");
-    }
-
-    fprintf(f, "OK.\r\n");
-}
-
-void gcCommand(FILE *f, int argc, sds *argv)
-{
-    valType result = 0;
-
-    if (NULL == f)
-        return;
-
-    result = dbGC();
-    fprintf(f, "Collected %u.\r\n", result);
-}
-
-void truncCommand(FILE *f, int argc, sds *argv)
-{
-    valType freed = 0;
-
-    if (NULL == f)
-        return;
-
-    freed = dbSetTrunc();
-    fprintf(f, "Freed %u.\r\n", freed);
-}
-
-void indexCommand(FILE *f, int argc, sds *argv)
-{
-    if (NULL == f)
-        return;
-
-    dbPrintIndex(f);
-}
-
-void setsCommand(FILE *f, int argc, sds *argv)
-{
-    if (NULL == f)
-        return;
-
-    dbPrintSets(f);
-}
-
-void eqCommand(FILE *f, int argc, sds *argv)
-{
-    sds setNameA = NULL, setNameB = NULL;
-    dbObject *setA = NULL, *setB = NULL;
-    size_t posA = 0, posB = 0;
-    int result = 0;
-
-    if (NULL == f || NULL == argv)
-        return;
-
-    if (2 != argc)
-    {
-        fprintf(f, "Expected 2 arguments.\r\n");
-        return;
-    }
-
-    if (NULL == (setNameA = argv[0]) || 0 == strlen(setNameA) ||
-        NULL == (setNameB = argv[1]) || 0 == strlen(setNameB))
-    {
-        fprintf(f, "Bad set name.\r\n");
-        return;
-    }
-
-    if (NULL == (setA = eval(setNameA, &posA)) ||
-        NULL == (setB = eval(setNameB, &posB)))
-    {
-        fprintf(f, "Set doesn't exist.\r\n");
-        return;
-    }
-
-    if (objectSet != setA->objectType)
-    {
-        fprintf(f, "Expected set result.\r\n");
-        dbUnregisterObject(setA->id);
-    }
-
-    if (objectSet != setB->objectType)
-    {
-        fprintf(f, "Expected set result.\r\n");
-        dbUnregisterObject(setA->id);
-    }
-
-    if (!(objectSet == setA->objectType &&
-          objectSet == setB->objectType))
-    {
-        return;
-    }
-
-    result = setCmpE(setA->objectPtr.setPtr, setB->objectPtr.setPtr);
-    switch (result)
-    {
-        case -1:
-            fprintf(f, "ERROR.\r\n");
-            return;
-
-        case 0:
-            fprintf(f, "0\r\n");
-            return;
-
-        case 1:
-            fprintf(f, "1\r\n");
-            return;
-    }
-}
-
-void subeCommand(FILE *f, int argc, sds *argv)
-{
-    sds setNameA = NULL, setNameB = NULL;
-    dbObject *setA = NULL, *setB = NULL;
-    size_t posA = 0, posB = 0;
-    int result = 0;
-
-    if (NULL == f || NULL == argv)
-        return;
-
-    if (2 != argc)
-    {
-        fprintf(f, "Expected 2 arguments.\r\n");
-        return;
-    }
-
-    if (NULL == (setNameA = argv[0]) || 0 == strlen(setNameA) ||
-        NULL == (setNameB = argv[1]) || 0 == strlen(setNameB))
-    {
-        fprintf(f, "Bad set name.\r\n");
-        return;
-    }
-
-    if (NULL == (setA = eval(setNameA, &posA)) ||
-        NULL == (setB = eval(setNameB, &posB)))
-    {
-        fprintf(f, "Set doesn't exist.\r\n");
-        return;
-    }
-
-    if (objectSet != setA->objectType)
-    {
-        fprintf(f, "Expected set result.\r\n");
-        dbUnregisterObject(setA->id);
-    }
-
-    if (objectSet != setB->objectType)
-    {
-        fprintf(f, "Expected set result.\r\n");
-        dbUnregisterObject(setA->id);
-    }
-
-    if (!(objectSet == setA->objectType &&
-          objectSet == setB->objectType))
-    {
-        return;
-    }
-
-    result = setCmpSubsetOrEq(setA->objectPtr.setPtr, setB->objectPtr.setPtr);
-    switch (result)
-    {
-        case -1:
-            fprintf(f, "ERROR.\r\n");
-            return;
-
-        case 0:
-            fprintf(f, "0\r\n");
-            return;
-
-        case 1:
-            fprintf(f, "1\r\n");
-            return;
-    }
-}
-
-void subCommand(FILE *f, int argc, sds *argv)
-{
-        sds setNameA = NULL, setNameB = NULL;
-    dbObject *setA = NULL, *setB = NULL;
-    size_t posA = 0, posB = 0;
-    int result = 0;
-
-    if (NULL == f || NULL == argv)
-        return;
-
-    if (2 != argc)
-    {
-        fprintf(f, "Expected 2 arguments.\r\n");
-        return;
-    }
-
-    if (NULL == (setNameA = argv[0]) || 0 == strlen(setNameA) ||
-        NULL == (setNameB = argv[1]) || 0 == strlen(setNameB))
-    {
-        fprintf(f, "Bad set name.\r\n");
-        return;
-    }
-
-    if (NULL == (setA = eval(setNameA, &posA)) ||
-        NULL == (setB = eval(setNameB, &posB)))
-    {
-        fprintf(f, "Set doesn't exist.\r\n");
-        return;
-    }
-
-    if (objectSet != setA->objectType)
-    {
-        fprintf(f, "Expected set result.\r\n");
-        dbUnregisterObject(setA->id);
-    }
-
-    if (objectSet != setB->objectType)
-    {
-        fprintf(f, "Expected set result.\r\n");
-        dbUnregisterObject(setA->id);
-    }
-
-    if (!(objectSet == setA->objectType &&
-          objectSet == setB->objectType))
-    {
-        return;
-    }
-
-    result = setCmpSubset(setA->objectPtr.setPtr, setB->objectPtr.setPtr);
-    switch (result)
-    {
-        case -1:
-            fprintf(f, "ERROR.\r\n");
-            return;
-
-        case 0:
-            fprintf(f, "0\r\n");
-            return;
-
-        case 1:
-            fprintf(f, "1\r\n");
-            return;
-    }
-}
+// commands.c - Command implementations.
+
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+#include "dict.h"
+
+#include "dbengine.h"
+#include "syncengine.h"
+#include "athena.h"
+#include "eval.h"
+#include "setutils.h"
+#include "reply.h"
+#include "tokenizer.h"
+
+// LOAD reads its stream this many bytes at a time and interns this many values at a time.
+#define LOAD_CHUNK_SIZE 65536
+#define LOAD_BATCH_SIZE 4096
+
+// RAND and POP return at most this many members at once.
+#define SAMPLE_MAX_COUNT 65536
+
+// SCAN and SSCAN return this many entries unless COUNT asks for another number, at most SCAN_MAX_COUNT.
+#define SCAN_DEFAULT_COUNT 10
+#define SCAN_MAX_COUNT 1024
+
+// INDEX page size unless COUNT asks for another one, at most INDEX_MAX_COUNT.
+#define INDEX_DEFAULT_COUNT 100
+#define INDEX_MAX_COUNT 1024
+
+static void predicateCommand(FILE *f, int argc, sds *argv, evalPredicate predicate, int negate);
+static void containmentCommand(FILE *f, int argc, sds *argv, int supersets);
+static void printNames(FILE *f, list *names, const char *none);
+static void batchMutateCommand(FILE *f, int argc, sds *argv, int add);
+static void storeCommand(FILE *f, int argc, sds *argv, setWordOp op);
+static int applyMembers(const sds setName, set *container, const set *members, setWordOp op);
+static void sampleCommand(FILE *f, int argc, sds *argv, int pop);
+static int parseScanArgs(const char *s, unsigned long *cursor, size_t *count);
+static int parseIndexArgs(const char *s, valType *from, valType *to, unsigned *types, size_t *count);
+static int parseOptionVal(const char **s, valType *val);
+static int loadStream(FILE *rf, set *s);
+static int loadBatch(set *s, const valType *vals, valType *ids, size_t count);
+
+void setCommand(FILE *f, int argc, sds *argv)
+{
+    sds newSet = NULL, expr = NULL;
+    dbObject *newSetValue = NULL;
+
+    if (NULL == f || NULL == argv)
+        return;
+
+    if (0 == argc)
+    {
+        fprintf(f, "Expected 1 or 2 arguments.\r\n");
+        return;
+    }
+
+    newSet = argv[0];
+    expr = 2 == argc ? argv[1] : NULL;
+
+    if (NULL == newSet || 0 == strlen(newSet))
+    {
+        fprintf(f, "Bad set name.\r\n");
+        return;
+    }
+
+    if (NULL == expr)
+    {
+        valType newSetId;
+
+        if (NULL == (newSetValue = (dbObject *) calloc(1, sizeof(dbObject))))
+        {
+            fprintf(f, "ERROR.\r\n");
+            return;
+        }
+
+        if (NULL == (newSetValue->objectPtr.setPtr = setCreate()))
+        {
+            free(newSetValue);
+            fprintf(f, "ERROR.\r\n");
+            return;
+        }
+
+        newSetValue->objectType = objectSet;
+
+        if (0 != dbRegisterObject(&newSetValue, &newSetId))
+        {
+            dbObjectRelease(newSetValue);
+            free(newSetValue);
+            fprintf(f, "ERROR.\r\n");
+            return;
+        }
+    }
+    else
+    {
+        size_t pos = 0;
+        if (NULL == (newSetValue = eval(expr, &pos)))
+        {
+            fprintf(f, "ERROR.\r\n");
+            return;
+        }
+
+        // Power sets, cartesian products and relations are lazy, members are built only when stored.
+        if (objectPowerSet == newSetValue->objectType ||
+            objectCartProd == newSetValue->objectType ||
+            objectRelation == newSetValue->objectType)
+        {
+            valType newSetId;
+            set *members = NULL;
+
+            if (NULL == (members = dbObjectMaterialize(newSetValue)))
+            {
+                fprintf(f, "ERROR.\r\n");
+                return;
+            }
+
+            if (NULL == (newSetValue = (dbObject *) calloc(1, sizeof(dbObject))))
+            {
+                setDestroy(members);
+                fprintf(f, "ERROR.\r\n");
+                return;
+            }
+
+            newSetValue->objectType = objectSet;
+            newSetValue->objectPtr.setPtr = members;
+
+            if (0 != dbRegisterObject(&newSetValue, &newSetId))
+            {
+                dbObjectRelease(newSetValue);
+                free(newSetValue);
+                fprintf(f, "ERROR.\r\n");
+                return;
+            }
+        }
+    }
+
+    if (objectSet != newSetValue->objectType)
+    {
+        fprintf(f, "Wrong initializer type.\r\n");
+        return;
+    }
+
+    if (0 == dbSet(newSet, newSetValue->objectPtr.setPtr))
+    {
+        fprintf(f, "OK.\r\n");
+    }
+    else
+    {
+        fprintf(f, "ERROR.\r\n");
+    }
+}
+
+void delCommand(FILE *f, int argc, sds *argv)
+{
+    sds setName = NULL;
+
+    if (NULL == f || NULL == argv)
+        return;
+
+    if (1 != argc)
+    {
+        fprintf(f, "Expected 1 argument.\r\n");
+        return;
+    }
+
+    if (NULL == (setName = argv[0]) || 0 == strlen(setName))
+    {
+        fprintf(f, "Bad set name.\r\n");
+        return;
+    }
+
+    if (NULL == dbGet(setName))
+    {
+        fprintf(f, "ERROR.\r\n");
+        return;
+    }
+
+    if (DICT_OK != dbRemove(setName))
+    {
+        fprintf(f, "ERROR.\r\n");
+        return;
+    }
+
+    fprintf(f, "OK.\r\n");
+}
+
+void existsCommand(FILE *f, int argc, sds *argv)
+{
+    sds setName = NULL;
+
+    if (NULL == f || NULL == argv)
+        return;
+
+    if (1 != argc)
+    {
+        fprintf(f, "Expected 1 argument.\r\n");
+        return;
+    }
+
+    if (NULL == (setName = argv[0]) || 0 == strlen(setName))
+    {
+        fprintf(f, "Bad set name.\r\n");
+        return;
+    }
+
+    if (NULL == dbGet(setName))
+    {
+        fprintf(f, "0\r\n");
+        return;
+    }
+
+    fprintf(f, "1\r\n");
+}
+
+void containsCommand(FILE *f, int argc, sds *argv)
+{
+    sds setName = NULL, member = NULL;
+    valType memberId = 0;
+    const set *container = NULL;
+
+    if (NULL == f || NULL == argv)
+        return;
+
+    if (2 != argc)
+    {
+        fprintf(f, "Expected 2 arguments.\r\n");
+        return;
+    }
+
+    if (NULL == (setName = argv[0]) || 0 == strlen(setName))
+    {
+        fprintf(f, "Bad set name.\r\n");
+        return;
+    }
+
+    if (NULL == (member = argv[1]) || 0 == strlen(member))
+    {
+        fprintf(f, "Bad set member.\r\n");
+        return;
+    }
+
+    if (NULL == (container = dbGet(setName)))
+    {
+        fprintf(f, "0\r\n");
+        return;
+    }
+
+    lockRead(container);
+
+    if (NULL == dbObjectParse(member, &memberId))
+    {
+        unlockRead(container);
+        fprintf(f, "Bad set member.\r\n");
+        return;
+    }
+
+    if (!setIsMember(container, memberId))
+    {
+        unlockRead(container);
+        fprintf(f, "0\r\n");
+        return;
+    }
+
+    unlockRead(container);
+    fprintf(f, "1\r\n");
+}
+
+void whichCommand(FILE *f, int argc, sds *argv)
+{
+    sds member = NULL;
+    valType memberId = 0;
+
+    if (NULL == f || NULL == argv)
+        return;
+
+    if (1 != argc)
+    {
+        fprintf(f, "Expected 1 argument.\r\n");
+        return;
+    }
+
+    if (NULL == (member = argv[0]) || 0 == strlen(member))
+    {
+        fprintf(f, "Bad set member.\r\n");
+        return;
+    }
+
+    if (NULL == dbObjectParse(member, &memberId))
+    {
+        fprintf(f, "Bad set member.\r\n");
+        return;
+    }
+
+    printNames(f, dbWhich(memberId), "No sets contain member.");
+}
+
+void renameCommand(FILE *f, int argc, sds *argv)
+{
+    sds oldSetName = NULL, newSetName = NULL;
+
+    if (NULL == f || NULL == argv)
+        return;
+
+    if (2 != argc)
+    {
+        fprintf(f, "Expected 2 arguments.\r\n");
+        return;
+    }
+
+    if (NULL == (oldSetName = argv[0]) || 0 == strlen(oldSetName) ||
+        NULL == (newSetName = argv[1]) || 0 == strlen(newSetName))
+    {
+        fprintf(f, "Bad set name.\r\n");
+        return;
+    }
+
+    if (NULL == dbGet(oldSetName))
+    {
+        fprintf(f, "Set doesn't exist.\r\n");
+        return;
+    }
+
+    if (NULL != dbGet(newSetName))
+    {
+        fprintf(f, "Set with desired new name already exists.\r\n");
+        return;
+    }
+
+    if (0 != dbRename(oldSetName, newSetName))
+    {
+        fprintf(f, "ERROR.\r\n");
+        return;
+    }
+
+    fprintf(f, "OK.\r\n");
+}
+
+void randsetCommand(FILE *f, int argc, sds *argv)
+{
+    sds randSetName = NULL;
+    set *randSet = NULL;
+    reply r;
+
+    if (NULL == f)
+        return;
+
+    if (NULL != (randSetName = dbGetRandSet()))
+    {
+        fprintf(f, "%s\r\n", randSetName);
+        randSet = (set *) dbGet(randSetName); 
+        replyInit(&r, f);
+        lockRead(randSet);
+        setPrint(randSet, &r, 1);
+        unlockRead(randSet);
+        replyWrite(&r, "\r\n", 2);
+        replyFlush(&r);
+    }
+    else
+    {
+        fprintf(f, "No any sets in db.\r\n");
+    }
+}
+
+void randCommand(FILE *f, int argc, sds *argv)
+{
+    sampleCommand(f, argc, argv, 0);
+}
+
+// Prints random member of named set, or count of them if count is given. Negative count
+// for rand allows repeated members. Popped members are removed from the set.
+static void sampleCommand(FILE *f, int argc, sds *argv, int pop)
+{
+    sds setName = NULL;
+    set *targetSet = NULL, *removed = NULL;
+    valType *ids = NULL;
+    const dbObject **objects = NULL;
+    long count = 1;
+    char *end = NULL;
+    int n, i, distinct = 1;
+    reply r;
+
+    if (NULL == f || NULL == argv)
+        return;
+
+    if (2 != argc)
+    {
+        fprintf(f, "Expected 1 or 2 arguments.\r\n");
+        return;
+    }
+
+    if (NULL == (setName = argv[0]) || 0 == strlen(setName))
+    {
+        fprintf(f, "Bad set name.\r\n");
+        return;
+    }
+
+    if (NULL != argv[1])
+    {
+        count = strtol(argv[1], &end, 10);
+
+        if (end == argv[1] || '\0' != *end || 0 == count || (pop && count < 0))
+        {
+            fprintf(f, "Bad count.\r\n");
+            return;
+        }
+
+        if (count < 0)
+        {
+            distinct = 0;
+            count = -count;
+        }
+
+        count = __min(count, SAMPLE_MAX_COUNT);
+    }
+
+    if (NULL == (targetSet = (set *) dbGet(setName)))
+    {
+        fprintf(f, "Set doesn't exist.\r\n");
+        return;
+    }
+
+    if (NULL == (ids = (valType *) malloc(count * sizeof(valType))) ||
+        NULL == (objects = (const dbObject **) malloc(count * sizeof(const dbObject *))))
+    {
+        free(ids);
+        fprintf(f, "ERROR.\r\n");
+        return;
+    }
+
+    if (pop)
+        lockWrite(targetSet);
+    else
+        lockRead(targetSet);
+
+    n = setGetRandMany(targetSet, ids, count, distinct);
+
+    if (pop && 1 == n)
+    {
+        if (0 == setRemove(targetSet, ids[0]))
+            dbMemberRemoved(setName, ids[0]);
+    }
+    else if (pop && n > 1)
+    {
+        if (NULL == (removed = setCreate()) || 0 != setAddMany(removed, ids, n))
+        {
+            n = -1;
+        }
+        else
+        {
+            setSubtract(targetSet, removed);
+            dbMembersRemoved(setName, removed);
+        }
+
+        setDestroy(removed);
+    }
+
+    if (pop)
+        unlockWrite(targetSet);
+    else
+        unlockRead(targetSet);
+
+    // A single member keeps the old reply, an empty set is an error there.
+    if (n < 0 || (NULL == argv[1] && 1 != n))
+    {
+        free(objects);
+        free(ids);
+        fprintf(f, "ERROR.\r\n");
+        return;
+    }
+
+    if (0 == n)
+    {
+        free(objects);
+        free(ids);
+        fprintf(f, "Set is empty.\r\n");
+        return;
+    }
+
+    dbGetObjects(ids, n, objects, 1);
+    replyInit(&r, f);
+
+    for (i = 0; i < n; i++)
+    {
+        if (0 != replyObject(&r, objects[i], 1))
+            replyStr(&r, "ERROR.");
+
+        replyWrite(&r, "\r\n", 2);
+    }
+
+    replyFlush(&r);
+    free(objects);
+    free(ids);
+}
+
+void evalCommand(FILE *f, int argc, sds *argv)
+{
+    sds expr = NULL;
+    size_t pos = 0;
+    dbObject *result = NULL;
+    reply r;
+
+    if (NULL == f || NULL == argv)
+        return;
+
+    if (1 != argc)
+    {
+        fprintf(f, "Expected 1 argument.\r\n");
+        return;
+    }
+
+    if (NULL == (expr = argv[0]) || 0 == strlen(expr))
+    {
+        fprintf(f, "Bad expression.\r\n");
+        return;
+    }
+
+    if (NULL == (result = eval(expr, &pos)))
+    {
+        fprintf(f, "ERROR.\r\n");
+        return;
+    }
+
+    replyInit(&r, f);
+    if (0 != dbObjectPrint(result, &r, 1))
+    {
+        replyFlush(&r);
+        fprintf(f, "ERROR.\r\n");
+        return;
+    }
+
+    replyWrite(&r, "\r\n", 2);
+    replyFlush(&r);
+}
+
+void addCommand(FILE *f, int argc,  sds *argv)
+{
+    sds setName = NULL, member = NULL;
+    valType memberId = 0;
+    set *container = NULL;
+    int result;
+
+    if (NULL == f || NULL == argv)
+        return;
+
+    if (2 != argc)
+    {
+        fprintf(f, "Expected 2 arguments.\r\n");
+        return;
+    }
+
+    if (NULL == (setName = argv[0]) || 0 == strlen(setName))
+    {
+        fprintf(f, "Bad set name.\r\n");
+        return;
+    }
+
+    if (NULL == (member = argv[1]) || 0 == strlen(member))
+    {
+        fprintf(f, "Bad set member.\r\n");
+        return;
+    }
+
+    if (NULL == (container = (set *) dbGet(setName)))
+    {
+        fprintf(f, "Set doesn't exist.\r\n");
+        return;
+    }
+
+    if (NULL == dbObjectParse(member, &memberId))
+    {
+        fprintf(f, "Bad set member.\r\n");
+        return;
+    }
+
+    lockWrite(container);
+    if (-1 == (result = setAdd(container, memberId)) ||
+        (0 == result && -1 == dbMemberAdded(setName, memberId)))
+    {
+        unlockWrite(container);
+        fprintf(f, "ERROR.\r\n");
+        return;
+    }
+
+    unlockWrite(container);
+    fprintf(f, "OK.\r\n");
+}
+
+void remCommand(FILE *f, int argc, sds *argv)
+{
+    sds setName = NULL, member = NULL;
+    valType memberId = 0;
+    set *container = NULL;
+    int result;
+
+    if (NULL == f || NULL == argv)
+        return;
+
+    if (2 != argc)
+    {
+        fprintf(f, "Expected 2 arguments.\r\n");
+        return;
+    }
+
+    if (NULL == (setName = argv[0]) || 0 == strlen(setName))
+    {
+        fprintf(f, "Bad set name.\r\n");
+        return;
+    }
+
+    if (NULL == (member = argv[1]) || 0 == strlen(member))
+    {
+        fprintf(f, "Bad set member.\r\n");
+        return;
+    }
+
+    if (NULL == (container = (set *) dbGet(setName)))
+    {
+        fprintf(f, "Set doesn't exist.\r\n");
+        return;
+    }
+
+    if (NULL == dbObjectParse(member, &memberId))
+    {
+        fprintf(f, "Bad set member.\r\n");
+        return;
+    }
+
+    lockWrite(container);
+    if (-1 == (result = setRemove(container, memberId)) ||
+        (0 == result && -1 == dbMemberRemoved(setName, memberId)))
+    {
+        unlockWrite(container);
+        fprintf(f, "ERROR.\r\n");
+        return;
+    }
+
+    unlockWrite(container);
+    fprintf(f, "OK.\r\n");
+}
+
+void cardCommand(FILE *f, int argc, sds *argv)
+{
+    sds setName = NULL;
+    valType card = 0;
+
+    if (NULL == f || NULL == argv)
+        return;
+
+    if (1 != argc)
+    {
+        fprintf(f, "Expected 1 argument.\r\n");
+        return;
+    }
+
+    if (NULL == (setName = argv[0]) || 0 == strlen(setName))
+    {
+        fprintf(f, "Bad set name.\r\n");
+        return;
+    }
+
+    if (0 != evalCard(setName, &card))
+    {
+        fprintf(f, "Set doesn't exist.\r\n");
+        return;
+    }
+
+    fprintf(f, "%u\r\n", card);
+}
+
+void approxCardCommand(FILE *f, int argc, sds *argv)
+{
+    sds expr = NULL;
+    double card = 0, error = 0;
+
+    if (NULL == f || NULL == argv)
+        return;
+
+    if (1 != argc)
+    {
+        fprintf(f, "Expected 1 argument.\r\n");
+        return;
+    }
+
+    if (NULL == (expr = argv[0]) || 0 == strlen(expr))
+    {
+        fprintf(f, "Bad set name.\r\n");
+        return;
+    }
+
+    if (0 != evalApproxCard(expr, &card, &error))
+    {
+        fprintf(f, "Set doesn't exist.\r\n");
+        return;
+    }
+
+    fprintf(f, "%.0f +- %.0f\r\n", card, error);
+}
+
+void movCommand(FILE *f, int argc, sds *argv)
+{
+    sds fromSetName = NULL, toSetName = NULL, member = NULL;
+    set *fromSet = NULL, *toSet = NULL;
+    valType memberId = 0;
+    int added;
+
+    if (NULL == f || NULL == argv)
+        return;
+
+    if (3 != argc)
+    {
+        fprintf(f, "Expected 3 arguments.\r\n");
+        return;
+    }
+
+    if (NULL == (fromSetName = argv[0]) || 0 == strlen(fromSetName) ||
+        NULL == (toSetName = argv[1]) || 0 == strlen(toSetName))
+    {
+        fprintf(f, "Bad set name.\r\n");
+        return;
+    }
+
+    if (NULL == (member = argv[2]) || 0 == strlen(member))
+    {
+        fprintf(f, "Bad member.\r\n");
+        return;
+    }
+
+    if (NULL == (fromSet = (set *) dbGet(fromSetName)) ||
+        NULL == (toSet = (set *) dbGet(toSetName)))
+    {
+        fprintf(f, "Set doesn't exist.\r\n");
+        return;
+    }
+
+    if (NULL == dbObjectParse(member, &memberId))
+    {
+        fprintf(f, "Bad set member.\r\n");
+        return;
+    }
+
+    lockWrite(fromSet);
+    if (!setIsMember(fromSet, memberId))
+    {
+        unlockWrite(fromSet);
+        fprintf(f, "From set doesn't contain member.\r\n");
+        return;
+    }
+
+    lockWrite(toSet);
+    if (-1 == (added = setAdd(toSet, memberId)) ||
+        -1 == setRemove(fromSet, memberId) ||
+        (0 == added && -1 == dbMemberAdded(toSetName, memberId)) ||
+        -1 == dbMemberRemoved(fromSetName, memberId))
+    {
+        unlockWrite(fromSet);
+        unlockWrite(toSet);
+        fprintf(f, "ERROR.\r\n");
+        return;
+    }
+
+    unlockWrite(fromSet);
+    unlockWrite(toSet);
+    fprintf(f, "OK.\r\n");
+}
+
+void popCommand(FILE *f, int argc, sds *argv)
+{
+    sampleCommand(f, argc, argv, 1);
+}
+
+void lockCommand(FILE *f, int argc, sds *argv)
+{
+    sds setName = NULL;
+    set *targetSet = NULL;
+
+    if (NULL == f || NULL == argv)
+        return;
+
+    if (1 != argc)
+    {
+        fprintf(f, "Expected 1 argument.\r\n");
+        return;
+    }
+
+    if (NULL == (setName = argv[0]) || 0 == strlen(setName))
+    {
+        fprintf(f, "Bad set name.\r\n");
+        return;
+    }
+
+    if (NULL == (targetSet = (set *) dbGet(setName)))
+    {
+        fprintf(f, "Set doesn't exist.\r\n");
+        return;
+    }
+
+    lockWrite(targetSet);
+    fprintf(f, "OK.\r\n");
+}
+
+void unlockCommand(FILE *f, int argc, sds *argv)
+{
+    sds setName = NULL;
+    set *targetSet = NULL;
+
+    if (NULL == f || NULL == argv)
+        return;
+
+    if (1 != argc)
+    {
+        fprintf(f, "Expected 1 argument.\r\n");
+        return;
+    }
+
+    if (NULL == (setName = argv[0]) || 0 == strlen(setName))
+    {
+        fprintf(f, "Bad set name.\r\n");
+        return;
+    }
+
+    if (NULL == (targetSet = (set *) dbGet(setName)))
+    {
+        fprintf(f, "Set doesn't exist.\r\n");
+        return;
+    }
+
+    unlockWrite(targetSet);
+    fprintf(f, "OK.\r\n");
+}
+
+void pingCommand(FILE *f, int argc, sds *argv)
+{
+    if (NULL == f)
+        return;
+
+    fprintf(f, "PONG.\r\n");
+}
+
+void flushallCommand(FILE *f, int argc, sds *argv)
+{
+    if (NULL == f)
+        return;
+
+    if (0 != dbFlushAll())
+    {
+        fprintf(f, "ERROR.\r\n");
+    }
+
+    fprintf(f, "OK.\r\n");
+}
+
+void gcCommand(FILE *f, int argc, sds *argv)
+{
+    valType result = 0;
+
+    if (NULL == f)
+        return;
+
+    result = dbGC();
+    fprintf(f, "Collected %u.\r\n", result);
+}
+
+void truncCommand(FILE *f, int argc, sds *argv)
+{
+    valType freed = 0;
+
+    if (NULL == f)
+        return;
+
+    freed = dbSetTrunc();
+    fprintf(f, "Freed %u.\r\n", freed);
+}
+
+void indexCommand(FILE *f, int argc, sds *argv)
+{
+    valType cursor = 0, to = (valType) -1;
+    unsigned types = 0;
+    size_t count = INDEX_DEFAULT_COUNT, n, i;
+    dbIndexEntry entries[INDEX_MAX_COUNT];
+    reply r;
+
+    if (NULL == f || NULL == argv)
+        return;
+
+    if (1 != argc || (NULL != argv[0] && 0 != parseIndexArgs(argv[0], &cursor, &to, &types, &count)))
+    {
+        fprintf(f, "Expected: [from n] [to n] [type t] [count n].\r\n");
+        return;
+    }
+
+    n = dbIndexPage(&cursor, to, 0 != types ? types : (unsigned) -1, entries, count);
+
+    // Objects are summarized under the read lock, the page is written after it's released.
+    replyInit(&r, f);
+    replyStr(&r, "Objects: ");
+    replyVal(&r, dbIndexCount());
+    replyStr(&r, ", next: ");
+    replyVal(&r, cursor);
+    replyWrite(&r, "\r\n", 2);
+
+    for (i = 0; i < n; i++)
+    {
+        replyVal(&r, entries[i].id);
+        replyStr(&r, ": ");
+        replyStr(&r, dbObjectTypeName(entries[i].type));
+
+        if (objectVal == entries[i].type)
+        {
+            replyStr(&r, " = ");
+            replyVal(&r, entries[i].card);
+        }
+        else
+        {
+            replyStr(&r, ", card ");
+            replyVal(&r, entries[i].card);
+        }
+
+        replyStr(&r, ", ");
+        replyVal(&r, entries[i].bytes);
+        replyStr(&r, " bytes\r\n");
+    }
+
+    replyFlush(&r);
+}
+
+// Parses "[from n] [to n] [type t] [count n]", type may be repeated. Returns -1 on error.
+static int parseIndexArgs(const char *s, valType *from, valType *to, unsigned *types, size_t *count)
+{
+    const char *word = NULL;
+    size_t len;
+    valType val;
+    dbObjectType type;
+
+    while ('\0' != *s)
+    {
+        while (isspace((unsigned char) *s))
+            s++;
+
+        if ('\0' == *s)
+            break;
+
+        for (word = s; '\0' != *s && !isspace((unsigned char) *s); s++);
+        len = s - word;
+
+        if (4 == len && 0 == strncmp(word, "type", 4))
+        {
+            while (isspace((unsigned char) *s))
+                s++;
+
+            for (word = s; '\0' != *s && !isspace((unsigned char) *s); s++);
+
+            if (0 != dbObjectTypeParse(word, s - word, &type))
+                return -1;
+
+            *types |= 1 << type;
+            continue;
+        }
+
+        if (0 != parseOptionVal(&s, &val))
+            return -1;
+
+        if (4 == len && 0 == strncmp(word, "from", 4))
+            *from = val;
+        else if (2 == len && 0 == strncmp(word, "to", 2))
+            *to = val;
+        else if (5 == len && 0 == strncmp(word, "count", 5) && 0 != val)
+            *count = __min(val, INDEX_MAX_COUNT);
+        else
+            return -1;
+    }
+
+    return *from <= *to ? 0 : -1;
+}
+
+// Parses value following an option name at *s and moves *s past it. Returns -1 on error.
+static int parseOptionVal(const char **s, valType *val)
+{
+    const char *p = *s;
+
+    while (isspace((unsigned char) *p))
+        p++;
+
+    if (!isdigit((unsigned char) *p))
+        return -1;
+
+    for (*s = p; isdigit((unsigned char) **s); (*s)++);
+
+    *val = tokenToVal(p, *s - p);
+    return 0;
+}
+
+void setsCommand(FILE *f, int argc, sds *argv)
+{
+    if (NULL == f)
+        return;
+
+    dbPrintSets(f);
+}
+
+void scanCommand(FILE *f, int argc, sds *argv)
+{
+    unsigned long cursor;
+    size_t count;
+    list *names = NULL;
+    listNode *node = NULL;
+    reply r;
+
+    if (NULL == f || NULL == argv)
+        return;
+
+    if (1 != argc || 0 != parseScanArgs(argv[0], &cursor, &count))
+    {
+        fprintf(f, "Expected: cursor [count n].\r\n");
+        return;
+    }
+
+    if (NULL == (names = dbScanSets(&cursor, count)))
+    {
+        fprintf(f, "ERROR.\r\n");
+        return;
+    }
+
+    // Lock is already released, the batch is written in one go.
+    replyInit(&r, f);
+    replyVal(&r, cursor);
+    replyWrite(&r, "\r\n", 2);
+
+    for (node = listFirst(names); NULL != node; node = listNextNode(node))
+    {
+        replyWrite(&r, (sds) listNodeValue(node), sdslen((sds) listNodeValue(node)));
+        replyWrite(&r, "\r\n", 2);
+    }
+
+    replyFlush(&r);
+    listRelease(names);
+}
+
+void sscanCommand(FILE *f, int argc, sds *argv)
+{
+    unsigned long cursor;
+    valType member;
+    size_t count;
+    valType ids[SCAN_MAX_COUNT];
+    const dbObject *objects[SCAN_MAX_COUNT];
+    int n, i;
+    reply r;
+
+    if (NULL == f || NULL == argv)
+        return;
+
+    if (2 != argc || NULL == argv[0] || 0 == sdslen(argv[0]) || 0 != parseScanArgs(argv[1], &cursor, &count))
+    {
+        fprintf(f, "Expected: set cursor [count n].\r\n");
+        return;
+    }
+
+    member = cursor;
+
+    if (-1 == (n = dbScanMembers(argv[0], &member, ids, count)))
+    {
+        fprintf(f, "Set doesn't exist.\r\n");
+        return;
+    }
+
+    dbGetObjects(ids, n, objects, 1);
+
+    replyInit(&r, f);
+    replyVal(&r, member);
+    replyWrite(&r, "\r\n", 2);
+
+    for (i = 0; i < n; i++)
+    {
+        replyObject(&r, objects[i], 1);
+        replyWrite(&r, "\r\n", 2);
+    }
+
+    replyFlush(&r);
+}
+
+// Parses "cursor [count n]". Returns -1 on error.
+static int parseScanArgs(const char *s, unsigned long *cursor, size_t *count)
+{
+    char *end = NULL;
+
+    if (NULL == s || !isdigit((unsigned char) *s))
+        return -1;
+
+    *cursor = strtoul(s, &end, 10);
+    *count = SCAN_DEFAULT_COUNT;
+
+    while (isspace((unsigned char) *end))
+        end++;
+
+    if ('\0' == *end)
+        return 0;
+
+    if (0 != strncmp(end, "count", 5) && 0 != strncmp(end, "COUNT", 5))
+        return -1;
+
+    s = end + 5;
+
+    if (!isspace((unsigned char) *s))
+        return -1;
+
+    while (isspace((unsigned char) *s))
+        s++;
+
+    if (!isdigit((unsigned char) *s))
+        return -1;
+
+    *count = strtoul(s, &end, 10);
+
+    while (isspace((unsigned char) *end))
+        end++;
+
+    if ('\0' != *end || 0 == *count)
+        return -1;
+
+    *count = __min(*count, SCAN_MAX_COUNT);
+    return 0;
+}
+
+void eqCommand(FILE *f, int argc, sds *argv)
+{
+    predicateCommand(f, argc, argv, predicateEq, 0);
+}
+
+void subeCommand(FILE *f, int argc, sds *argv)
+{
+    predicateCommand(f, argc, argv, predicateSubsetOrEq, 0);
+}
+
+void subCommand(FILE *f, int argc, sds *argv)
+{
+    predicateCommand(f, argc, argv, predicateSubset, 0);
+}
+
+void intersectsCommand(FILE *f, int argc, sds *argv)
+{
+    predicateCommand(f, argc, argv, predicateIntersects, 0);
+}
+
+void disjointCommand(FILE *f, int argc, sds *argv)
+{
+    predicateCommand(f, argc, argv, predicateIntersects, 1);
+}
+
+// Evaluates predicate over two set expressions without registering their results
+// and prints 1 or 0, inverted if negate is set.
+static void predicateCommand(FILE *f, int argc, sds *argv, evalPredicate predicate, int negate)
+{
+    sds setNameA = NULL, setNameB = NULL;
+    int result = 0;
+
+    if (NULL == f || NULL == argv)
+        return;
+
+    if (2 != argc)
+    {
+        fprintf(f, "Expected 2 arguments.\r\n");
+        return;
+    }
+
+    if (NULL == (setNameA = argv[0]) || 0 == strlen(setNameA) ||
+        NULL == (setNameB = argv[1]) || 0 == strlen(setNameB))
+    {
+        fprintf(f, "Bad set name.\r\n");
+        return;
+    }
+
+    if (-1 == (result = evalTest(predicate, setNameA, setNameB)))
+    {
+        fprintf(f, "Set doesn't exist.\r\n");
+        return;
+    }
+
+    fprintf(f, "%d\r\n", negate ? !result : result);
+}
+
+void subsetsCommand(FILE *f, int argc, sds *argv)
+{
+    containmentCommand(f, argc, argv, 0);
+}
+
+void supersetsCommand(FILE *f, int argc, sds *argv)
+{
+    containmentCommand(f, argc, argv, 1);
+}
+
+// Prints names of named sets which are subsets or supersets of "of expr" argument.
+static void containmentCommand(FILE *f, int argc, sds *argv, int supersets)
+{
+    sds expr = NULL;
+    set *s = NULL;
+    int owned = 0;
+    list *names = NULL;
+
+    if (NULL == f || NULL == argv)
+        return;
+
+    if (2 != argc || NULL == argv[0] || 0 != strcmp(argv[0], "of"))
+    {
+        fprintf(f, "Expected: of expression.\r\n");
+        return;
+    }
+
+    if (NULL == (expr = argv[1]) || 0 == strlen(expr))
+    {
+        fprintf(f, "Bad expression.\r\n");
+        return;
+    }
+
+    if (NULL == (s = evalSet(expr, &owned)))
+    {
+        fprintf(f, "ERROR.\r\n");
+        return;
+    }
+
+    names = supersets ? dbSupersets(s) : dbSubsets(s);
+
+    if (owned)
+        setDestroy(s);
+
+    printNames(f, names, "No matching sets.");
+}
+
+// Prints every name in names, or none if there are no names, and releases names.
+static void printNames(FILE *f, list *names, const char *none)
+{
+    listNode *node = NULL;
+
+    if (NULL == names)
+    {
+        fprintf(f, "ERROR.\r\n");
+        return;
+    }
+
+    if (0 == listLength(names))
+        fprintf(f, "%s\r\n", none);
+
+    for (node = listFirst(names); NULL != node; node = listNextNode(node))
+        fprintf(f, "%s\r\n", (sds) listNodeValue(node));
+
+    listRelease(names);
+}
+
+void similarCommand(FILE *f, int argc, sds *argv)
+{
+    sds expr = NULL;
+    char *kPtr = NULL, *end = NULL;
+    size_t k;
+    set *s = NULL;
+    int owned = 0, count, i;
+    dbMatch *matches = NULL;
+
+    if (NULL == f || NULL == argv)
+        return;
+
+    if (1 != argc || NULL == argv[0] || NULL == (kPtr = strrchr(argv[0], ' ')))
+    {
+        fprintf(f, "Expected: expression k.\r\n");
+        return;
+    }
+
+    k = strtoul(kPtr + 1, &end, 10);
+
+    if (end == kPtr + 1 || '\0' != *end || 0 == k)
+    {
+        fprintf(f, "Bad k.\r\n");
+        return;
+    }
+
+    if (NULL == (expr = sdsnewlen(argv[0], kPtr - argv[0])))
+    {
+        fprintf(f, "ERROR.\r\n");
+        return;
+    }
+
+    s = evalSet(expr, &owned);
+    sdsfree(expr);
+
+    if (NULL == s)
+    {
+        fprintf(f, "ERROR.\r\n");
+        return;
+    }
+
+    if (NULL == (matches = (dbMatch *) calloc(k, sizeof(dbMatch))) ||
+        -1 == (count = dbSimilar(s, k, matches)))
+    {
+        if (owned)
+            setDestroy(s);
+        free(matches);
+        fprintf(f, "ERROR.\r\n");
+        return;
+    }
+
+    if (owned)
+        setDestroy(s);
+
+    if (0 == count)
+        fprintf(f, "No similar sets.\r\n");
+
+    for (i = 0; i < count; i++)
+    {
+        fprintf(f, "%s %.6f\r\n", matches[i].name, matches[i].score);
+        sdsfree(matches[i].name);
+    }
+
+    free(matches);
+}
+
+void jaccardCommand(FILE *f, int argc, sds *argv)
+{
+    set *a = NULL, *b = NULL;
+    int aOwned = 0, bOwned = 0;
+    valType inter, uni;
+
+    if (NULL == f || NULL == argv)
+        return;
+
+    if (2 != argc)
+    {
+        fprintf(f, "Expected 2 arguments.\r\n");
+        return;
+    }
+
+    if (NULL == argv[0] || 0 == strlen(argv[0]) ||
+        NULL == argv[1] || 0 == strlen(argv[1]))
+    {
+        fprintf(f, "Bad set name.\r\n");
+        return;
+    }
+
+    if (NULL == (a = evalSet(argv[0], &aOwned)))
+    {
+        fprintf(f, "Set doesn't exist.\r\n");
+        return;
+    }
+
+    if (NULL == (b = evalSet(argv[1], &bOwned)))
+    {
+        if (aOwned)
+            setDestroy(a);
+        fprintf(f, "Set doesn't exist.\r\n");
+        return;
+    }
+
+    lockRead(a);
+    if (b != a)
+        lockRead(b);
+
+    setInterUnionCard(a, b, &inter, &uni);
+
+    if (b != a)
+        unlockRead(b);
+    unlockRead(a);
+
+    if (aOwned)
+        setDestroy(a);
+    if (bOwned)
+        setDestroy(b);
+
+    // Two empty sets are equal.
+    fprintf(f, "%.6f\r\n", 0 == uni ? 1.0 : (double) inter / uni);
+}
+
+void maddCommand(FILE *f, int argc, sds *argv)
+{
+    batchMutateCommand(f, argc, argv, 1);
+}
+
+void mremCommand(FILE *f, int argc, sds *argv)
+{
+    batchMutateCommand(f, argc, argv, 0);
+}
+
+// Adds or removes every member of comma separated list argv[1] under one write lock of set argv[0].
+static void batchMutateCommand(FILE *f, int argc, sds *argv, int add)
+{
+    sds setName = NULL;
+    set *container = NULL, *members = NULL;
+    valType *ids = NULL;
+    size_t count = 0, i;
+    int result = 0;
+
+    if (NULL == f || NULL == argv)
+        return;
+
+    if (2 != argc)
+    {
+        fprintf(f, "Expected 2 arguments.\r\n");
+        return;
+    }
+
+    if (NULL == (setName = argv[0]) || 0 == strlen(setName))
+    {
+        fprintf(f, "Bad set name.\r\n");
+        return;
+    }
+
+    if (NULL == (container = (set *) dbGet(setName)))
+    {
+        fprintf(f, "Set doesn't exist.\r\n");
+        return;
+    }
+
+    if (NULL == argv[1] || NULL == (ids = evalList(argv[1], &count)))
+    {
+        fprintf(f, "Bad set member.\r\n");
+        return;
+    }
+
+    if (NULL == (members = setCreate()))
+    {
+        free(ids);
+        fprintf(f, "ERROR.\r\n");
+        return;
+    }
+
+    for (i = 0; i < count && -1 != result; i++)
+        result = setAdd(members, ids[i]);
+
+    free(ids);
+
+    if (-1 == result)
+    {
+        setDestroy(members);
+        fprintf(f, "ERROR.\r\n");
+        return;
+    }
+
+    lockWrite(container);
+    result = applyMembers(setName, container, members, add ? setWordOr : setWordAndNot);
+    unlockWrite(container);
+
+    setDestroy(members);
+
+    fprintf(f, -1 == result ? "ERROR.\r\n" : "OK.\r\n");
+}
+
+void unionStoreCommand(FILE *f, int argc, sds *argv)
+{
+    storeCommand(f, argc, argv, setWordOr);
+}
+
+void interStoreCommand(FILE *f, int argc, sds *argv)
+{
+    storeCommand(f, argc, argv, setWordAnd);
+}
+
+void diffStoreCommand(FILE *f, int argc, sds *argv)
+{
+    storeCommand(f, argc, argv, setWordAndNot);
+}
+
+// Replaces set argv[0] with argv[0] op argv[1] in place. Only the bitmap of argv[0] is touched,
+// it grows only if union adds members past its end.
+static void storeCommand(FILE *f, int argc, sds *argv, setWordOp op)
+{
+    sds setName = NULL;
+    set *target = NULL, *operand = NULL;
+    const set *s = NULL;
+    int owned = 0, result = 0;
+
+    if (NULL == f || NULL == argv)
+        return;
+
+    if (2 != argc)
+    {
+        fprintf(f, "Expected 2 arguments.\r\n");
+        return;
+    }
+
+    if (NULL == (setName = argv[0]) || 0 == strlen(setName))
+    {
+        fprintf(f, "Bad set name.\r\n");
+        return;
+    }
+
+    if (NULL == (target = (set *) dbGet(setName)))
+    {
+        fprintf(f, "Set doesn't exist.\r\n");
+        return;
+    }
+
+    if (NULL == argv[1] || NULL == (s = evalSet(argv[1], &owned)))
+    {
+        fprintf(f, "Bad expression.\r\n");
+        return;
+    }
+
+    // Operand which is another named set is copied first, so two stores into each other's
+    // operands can't deadlock on their write locks.
+    if (owned)
+    {
+        operand = (set *) s;
+    }
+    else
+    {
+        lockRead(s);
+        operand = setCopy(s);
+        unlockRead(s);
+
+        if (NULL == operand)
+        {
+            fprintf(f, "ERROR.\r\n");
+            return;
+        }
+    }
+
+    lockWrite(target);
+    result = applyMembers(setName, target, operand, op);
+    unlockWrite(target);
+
+    setDestroy(operand);
+
+    fprintf(f, -1 == result ? "ERROR.\r\n" : "OK.\r\n");
+}
+
+// Replaces container named setName with container op members in one pass, see setApply. Only the members
+// which really changed are reported to the membership index. Must be called with container locked for
+// writing. Returns -1 on error.
+static int applyMembers(const sds setName, set *container, const set *members, setWordOp op)
+{
+    set *changed = NULL;
+    int result = 0;
+
+    if (NULL == (changed = setCreate()))
+        return -1;
+
+    if (-1 == setApply(container, members, op, changed))
+        result = -1;
+    else if (0 != changed->card)
+        result = setWordOr == op ? dbMembersAdded(setName, changed) : dbMembersRemoved(setName, changed);
+
+    setDestroy(changed);
+    return result;
+}
+
+void mcontainsCommand(FILE *f, int argc, sds *argv)
+{
+    static const char hexDigits[] = "0123456789abcdef";
+    sds setName = NULL;
+    char *hex = NULL;
+    const set *container = NULL;
+    valType *ids = NULL;
+    size_t count = 0, i, len = 0;
+    unsigned nibble = 0;
+
+    if (NULL == f || NULL == argv)
+        return;
+
+    if (2 != argc)
+    {
+        fprintf(f, "Expected 2 arguments.\r\n");
+        return;
+    }
+
+    if (NULL == (setName = argv[0]) || 0 == strlen(setName))
+    {
+        fprintf(f, "Bad set name.\r\n");
+        return;
+    }
+
+    if (NULL == argv[1] || NULL == (ids = evalList(argv[1], &count)))
+    {
+        fprintf(f, "Bad set member.\r\n");
+        return;
+    }
+
+    if (NULL == (hex = (char *) malloc(count / 4 + 2)))
+    {
+        free(ids);
+        fprintf(f, "ERROR.\r\n");
+        return;
+    }
+
+    // Answers are packed four per hex digit, the first member is the high bit of the first digit.
+    container = dbGet(setName);
+
+    if (NULL != container)
+        lockRead(container);
+
+    for (i = 0; i < count; i++)
+    {
+        nibble = nibble << 1 | (NULL != container && setIsMember(container, ids[i]));
+
+        if (3 == i % 4 || i + 1 == count)
+        {
+            nibble <<= 3 - i % 4;
+            hex[len++] = hexDigits[nibble];
+            nibble = 0;
+        }
+    }
+
+    if (NULL != container)
+        unlockRead(container);
+
+    hex[len] = '\0';
+    fprintf(f, "%s\r\n", hex);
+
+    free(hex);
+    free(ids);
+}
+
+void loadCommand(client *c, const char *args)
+{
+    sds setName = NULL;
+    set *members = NULL;
+    dbObject *newSetValue = NULL;
+    valType newSetId;
+    int result;
+
+    if (NULL == c || NULL == c->rf || NULL == c->wf || NULL == args)
+        return;
+
+    if (NULL == (members = setCreate()))
+    {
+        fprintf(c->wf, "ERROR.\r\n");
+        return;
+    }
+
+    // Stream is consumed even if the command fails, so the client stays in sync.
+    result = loadStream(c->rf, members);
+
+    if (NULL == (setName = sdstrim(sdsnew(args), " \t\r")) || 0 == strlen(setName))
+    {
+        sdsfree(setName);
+        setDestroy(members);
+        fprintf(c->wf, "Bad set name.\r\n");
+        return;
+    }
+
+    if (0 != result || NULL == (newSetValue = (dbObject *) calloc(1, sizeof(dbObject))))
+    {
+        sdsfree(setName);
+        setDestroy(members);
+        fprintf(c->wf, "ERROR.\r\n");
+        return;
+    }
+
+    newSetValue->objectType = objectSet;
+    newSetValue->objectPtr.setPtr = members;
+
+    // Set becomes visible only now, as a whole. Bulk registration finds an equal set through the
+    // object hash index and doesn't echo the object.
+    if (0 != dbRegisterObjects(&newSetValue, 1, &newSetId))
+    {
+        sdsfree(setName);
+        fprintf(c->wf, "ERROR.\r\n");
+        return;
+    }
+
+    fprintf(c->wf, 0 == dbSet(setName, newSetValue->objectPtr.setPtr) ? "OK.\r\n" : "ERROR.\r\n");
+    sdsfree(setName);
+}
+
+// Reads blocks of comma or space separated values from rf and adds them to s. Every block is a line of
+// decimal digits with its length in bytes followed by that many bytes, block of length 0 ends the stream.
+// Values may span blocks. Returns -1 on error.
+static int loadStream(FILE *rf, set *s)
+{
+    char header[32], *chunk = NULL, *p = NULL;
+    valType *vals = NULL, *ids = NULL, val = 0;
+    size_t blockLen, n, i, count = 0;
+    int failed = 0, eof = 0, inVal = 0;
+
+    chunk = (char *) malloc(LOAD_CHUNK_SIZE);
+    vals = (valType *) malloc(LOAD_BATCH_SIZE * sizeof(valType));
+    ids = (valType *) malloc(LOAD_BATCH_SIZE * sizeof(valType));
+
+    if (NULL == chunk || NULL == vals || NULL == ids)
+    {
+        free(chunk);
+        free(vals);
+        free(ids);
+        return -1;
+    }
+
+    while (!eof)
+    {
+        if (NULL == fgets(header, sizeof(header), rf))
+        {
+            eof = 1;
+            break;
+        }
+
+        // Line break after block data isn't required, but is allowed.
+        if ('\n' == header[0] || ('\r' == header[0] && '\n' == header[1]))
+            continue;
+
+        // Header holds only digits of the length. Anything else can't be told from data, so the load fails.
+        for (p = header; isdigit((unsigned char) *p); p++);
+
+        if (p == header ||
+            ('\n' != p[0] && !('\r' == p[0] && '\n' == p[1]) && !('\0' == p[0] && feof(rf))))
+        {
+            failed = 1;
+            break;
+        }
+
+        if (0 == (blockLen = strtoul(header, NULL, 10)))
+            break;
+
+        while (0 != blockLen)
+        {
+            if (0 == (n = fread(chunk, 1, __min(blockLen, LOAD_CHUNK_SIZE), rf)))
+            {
+                eof = 1;
+                break;
+            }
+
+            blockLen -= n;
+
+            // After an error the rest of the stream is only drained.
+            for (i = 0; i < n && !failed; i++)
+            {
+                if (isdigit((unsigned char) chunk[i]))
+                {
+                    val = val * 10 + (chunk[i] - '0');
+                    inVal = 1;
+                }
+                else if (',' != chunk[i] && !isspace((unsigned char) chunk[i]))
+                {
+                    failed = 1;
+                }
+                else if (inVal)
+                {
+                    vals[count++] = val;
+                    val = 0;
+                    inVal = 0;
+
+                    if (LOAD_BATCH_SIZE == count)
+                    {
+                        failed = 0 != loadBatch(s, vals, ids, count);
+                        count = 0;
+                    }
+                }
+            }
+        }
+    }
+
+    if (inVal)
+        vals[count++] = val;
+
+    if (!failed && 0 != count)
+        failed = 0 != loadBatch(s, vals, ids, count);
+
+    free(chunk);
+    free(vals);
+    free(ids);
+    return failed || eof ? -1 : 0;
+}
+
+// Interns count values and adds their ids to s. Returns -1 on error.
+static int loadBatch(set *s, const valType *vals, valType *ids, size_t count)
+{
+    if (0 != dbInternVals(vals, count, ids))
+        return -1;
+
+    return setAddMany(s, ids, count);
+}
@@ -1,676 +1,1939 @@
-// dbengine.c - Database engine.
-
-#include <memory.h>
-#include <stdlib.h>
-
-#include "dict.h"
-#include "sds.h"
-
-#include "dbengine.h"
-#include "dbobject.h"
-#include "syncengine.h"
-#include "setutils.h"
-
-static dict *sets;
-static const dbObject **objectIndex;
-static valType objectIndexLength, objectIndexFreeId, objectIndexCount;
-
-static dictType dictSetType;
-
-int initDbEngine(void)
-{
-    objectIndexLength = 256;
-    objectIndexFreeId = 0;
-    objectIndexCount = 0;
-    if (NULL == (objectIndex = (const dbObject **) calloc(objectIndexLength, (sizeof(const dbObject *)))))
-        return -1;
-
-    if (NULL == (sets = dictCreate(&dictSetType, NULL)))
-    {
-        free((void *) objectIndex);
-        return -1;
-    }
-
-    if (0 != registerSyncObject(sets))
-    {
-        free((void *) objectIndex);
-        dictRelease(sets);
-        return -1;
-    }
-
-    if (0 != registerSyncObject(objectIndex))
-    {
-        unregisterSyncObject(sets);
-        free((void *) objectIndex);
-        dictRelease(sets);
-        return -1;
-    }
-
-    return 0;
-}
-
-void cleanupDbEngine(void)
-{
-    dictIterator *i = NULL;
-    dictEntry *de = NULL;
-    valType c;
-
-    unregisterSyncObject(sets);
-    unregisterSyncObject(objectIndex);
-
-    if (NULL == sets)
-        return;
-
-    i = dictGetIterator(sets);
-
-    if (NULL != i)
-    {
-        while (NULL != (de = dictNext(i)))
-        {
-            set *setToDelete = (set *) dictGetEntryVal(de);
-
-            if (!setToDelete->registered)
-                setDestroy(setToDelete);
-        }
-    }
-
-    dictReleaseIterator(i);
-    dictRelease(sets);
-
-    for (c = 0; c < objectIndexLength; c++)
-        if (NULL != objectIndex[c])
-        {
-            dbObjectRelease((dbObject *) objectIndex[c]);
-            free((void *) objectIndex[c]);
-        }
-
-    free((void *) objectIndex);
-}
-
-const set *dbGet(const sds setName)
-{
-    const set *result = NULL;
-    lockRead(sets);
-    result = (const set *) dictFetchValue(sets, setName);
-    unlockRead(sets);
-    return result;
-}
-
-const sds dbGetRandSet(void)
-{
-    dictEntry *entry = NULL;
-    sds result = NULL;
-    lockRead(sets);
-    if (NULL != (entry = dictGetRandomKey(sets)))
-    {
-        result = (sds) entry->key;
-    }
-    unlockRead(sets);
-    return result;
-}
-
-int dbRemove(const sds setName)
-{
-    int result = DICT_OK;
-    set *s = NULL;
-    lockWrite(sets);
-    s = (set *) dictFetchValue(sets, setName);
-    if (NULL != s)
-    {
-        unregisterSyncObject(s);
-        if (!s->registered)
-            setDestroy(s);
-        result = dictDelete(sets, setName);
-    }
-    unlockWrite(sets);
-    return result;
-}
-
-int dbFlushAll(void)
-{
-    dictIterator *iter = NULL;
-    dictEntry *entry = NULL;
-
-    lockWrite(sets);
-
-    if (NULL == (iter = dictGetIterator(sets)))
-    {
-        unlockWrite(sets);
-        return -1;
-    }
-
-    while (NULL != (entry = dictNext(iter)))
-    {
-        set *s = (set *) dictGetEntryVal(entry);
-        lockWrite(s);
-        if (!s->registered)
-            setDestroy(s);
-        unregisterSyncObject(s);
-    }
-
-    dictReleaseIterator(iter);
-    dictEmpty(sets);
-    unlockWrite(sets);
-    return 0;
-}
-
-int dbRename(const sds oldSetName, const sds newSetName)
-{
-    const set *oldSet = NULL;
-
-    if (NULL == oldSetName || NULL == newSetName ||
-        0 == strlen(oldSetName) || 0 == strlen(newSetName))
-    {
-        return -1;
-    }
-
-    if (NULL == (oldSet = dbGet(oldSetName)) ||
-        NULL != dbGet(newSetName))
-    {
-        return -1;
-    }
-
-    lockWrite(sets);
-    dictDelete(sets, oldSetName);
-    dictAdd(sets, newSetName, (void *) oldSet);
-    unlockWrite(sets);
-    return 0;
-}
-
-const set *dbCreate(const sds setName)
-{
-    set *newSet = NULL;
-
-    if (NULL == setName || 0 == strlen(setName))
-    {
-        return NULL;
-    }
-
-    if (NULL == (newSet = setCreate()))
-        return NULL;
-
-    lockWrite(sets);
-
-    if (DICT_OK != dictAdd(sets, setName, newSet))
-    {
-        unlockWrite(sets);
-        setDestroy(newSet);
-        return NULL;
-    }
-
-    if (0 != registerSyncObject(newSet) && 1 != syncObjectIsRegistered(newSet))
-    {
-        unlockWrite(sets);
-        dictDelete(sets, setName);
-        setDestroy(newSet);
-        return NULL;
-    }
-
-    unlockWrite(sets);
-    return newSet;
-}
-
-int dbSet(const sds setName, const set *s)
-{
-    set *prevSet = NULL;
-
-    if (NULL == setName || 0 == strlen(setName) || NULL == s)
-        return -1;
-
-    lockWrite(sets);
-    if (NULL != (prevSet = (set *) dictFetchValue(sets, setName)))
-    {
-        lockWrite(prevSet);
-        if (!prevSet->registered)
-            setDestroy(prevSet);
-        unregisterSyncObject(prevSet);
-    }
-
-    if (0 != registerSyncObject(s) && 1 != syncObjectIsRegistered(s))
-    {
-        unlockWrite(sets);
-        return -1;
-    }
-
-    dictReplace(sets, setName, (void *) s);
-    unlockWrite(sets);
-    return 0;
-}
-
-const dbObject *dbGetObject(valType id, int lock)
-{
-    const dbObject *result = NULL;
-
-    if (lock)
-        lockRead(objectIndex);
-
-    if (id >= objectIndexLength)
-    {
-        unlockRead(objectIndex);
-        return NULL;
-    }
-
-    result = objectIndex[id];
-
-    if (lock)
-        unlockRead(objectIndex);
-    return result;
-}
-
-int dbRegisterObject(dbObject **object, valType *id)
-{
-    valType prevObjectIndexFreeId = 0;
-
-    if (NULL == id || NULL == object || NULL == *object)
-    {
-        return -1;
-    }
-
-    lockWrite(objectIndex);
-
-    prevObjectIndexFreeId = objectIndexFreeId;
-
-    if (1 == dbFindObject(*object, id, 0))
-    {
-        dbObjectRelease(*object);
-        free(*object);
-        *object = (dbObject *) objectIndex[*id];
-        unlockWrite(objectIndex);
-        return 0;
-    }
-
-    while (objectIndexFreeId < objectIndexLength && NULL != objectIndex[objectIndexFreeId])
-        objectIndexFreeId++;
-
-    if (objectIndexFreeId < objectIndexLength)
-    {
-        objectIndex[objectIndexFreeId] = *object;
-        *id = objectIndexFreeId;
-        objectIndexFreeId++;
-        objectIndexCount++;
-        unlockWrite(objectIndex);
-
-        if (objectSet == (*object)->objectType)
-        {
-            (*object)->objectPtr.setPtr->registered = 1;
-        }
-
-        // Debug
-        printf("Registered object %u = ", *id);
-        dbObjectPrint(*object, stdout, 0);
-        printf("\r\n");
-
-        (*object)->id = *id;
-
-        return 0;
-    }
-
-    objectIndexLength += 256;
-    if (NULL == (objectIndex = (const dbObject **) realloc((void *) objectIndex, objectIndexLength * sizeof(dbObject *))))
-    {
-        objectIndexLength = prevObjectIndexFreeId;
-        unlockWrite(objectIndex);
-        return -1;
-    }
-
-    memset((void *) (objectIndex + prevObjectIndexFreeId), 0, 256);
-
-    objectIndex[objectIndexFreeId] = *object;
-    *id = objectIndexFreeId;
-    objectIndexFreeId++;
-    objectIndexCount++;
-    unlockWrite(objectIndex);
-
-    if (objectSet == (*object)->objectType)
-    {
-        (*object)->objectPtr.setPtr->registered = 1;
-    }
-
-    (*object)->id = *id;
-
-    return 0;
-}
-
-int dbFindObject(const dbObject *object, valType *index, int lock)
-{
-    valType i;
-
-    if (NULL == object)
-        return 0;
-
-    if (lock)
-        lockRead(objectIndex);
-
-    for (i = 0; i < objectIndexLength; i++)
-    {
-        if (NULL != objectIndex[i] &&
-            1 == dbObjectCompare(object, objectIndex[i]))
-        {
-            if (index)
-                *index = i;
-
-            if (lock)
-                unlockRead(objectIndex);
-            return 1;
-        }
-    }
-
-    if (lock)
-        unlockRead(objectIndex);
-    return 0;
-}
-
-int dbFindSet(const set *s, valType *index, int lock)
-{
-    valType i;
-
-    if (NULL == s)
-        return 0;
-
-    if (lock)
-        lockRead(objectIndex);
-
-    for (i = 0; i < objectIndexLength; i++)
-    {
-        if (NULL != objectIndex[i] &&
-            objectSet == objectIndex[i]->objectType &&
-            1 == setCmpE(s, objectIndex[i]->objectPtr.setPtr))
-        {
-            if (index)
-                *index = i;
-
-            if (lock)
-                unlockRead(objectIndex);
-            return 1;
-        }
-    }
-
-    if (lock)
-        unlockRead(objectIndex);
-    return 0;
-}
-
-valType dbSetTrunc(void)
-{
-    valType freed = 0, i;
-    dictIterator *iter = NULL;
-    dictEntry *entry = NULL;
-
-    lockWrite(objectIndex);
-    lockRead(sets);
-
-    if (NULL == (iter = dictGetIterator(sets)))
-    {
-        unlockRead(sets);
-        unlockWrite(objectIndex);
-        return 0;
-    }
-
-    while (NULL != (entry = dictNext(iter)))
-    {
-        lockWrite(entry);
-        freed += setTrunc((set *) dictGetEntryVal(entry));
-        unlockWrite(entry);
-    }
-
-    for (i = 0; i < objectIndexLength; i++)
-    {
-        if (NULL != objectIndex[i] &&
-            objectSet == objectIndex[i]->objectType)
-        {
-            freed += setTrunc(objectIndex[i]->objectPtr.setPtr);
-        }
-    }
-
-    dictReleaseIterator(iter);
-
-    unlockRead(sets);
-    unlockWrite(objectIndex);
-
-    return freed;
-}
-
-valType dbGC(void)
-{
-    valType collected = 0, i;
-    dictIterator *iter = NULL;
-    dictEntry *entry = NULL;
-    set *acc = NULL;
-
-    lockWrite(objectIndex);
-    lockRead(sets);
-
-    // Step 1. Union all sets in db.
-    if (NULL == (iter = dictGetIterator(sets)))
-    {
-        unlockRead(sets);
-        unlockWrite(objectIndex);
-        return 0;
-    }
-
-    if (NULL == (acc = setCreate()))
-    {
-        unlockRead(sets);
-        unlockWrite(objectIndex);
-        return 0;
-    }
-
-    while (NULL != (entry = dictNext(iter)))
-    {
-        valType currentSetId = 0;
-        set *tmp = NULL, *currentSet = (set *) dictGetEntryVal(entry);
-        set *flattened = setFlatten(currentSet, 0);
-
-        if (NULL == flattened)
-        {
-            continue;
-        }
-
-        if (1 == dbFindSet(currentSet, &currentSetId, 0))
-        {
-            if (-1 == setAdd(acc, currentSetId))
-            {
-                setDestroy(acc);
-                dictReleaseIterator(iter);
-                unlockRead(sets);
-                unlockWrite(objectIndex);
-                return 0;
-            }
-        }
-
-        if (NULL == (tmp = setUnion(acc, flattened)))
-        {
-            setDestroy(flattened);
-            setDestroy(acc);
-            dictReleaseIterator(iter);
-            unlockRead(sets);
-            unlockWrite(objectIndex);
-            return 0;
-        }
-
-        setDestroy(flattened);
-        setDestroy(acc);
-        acc = tmp;
-    }
-
-    dictReleaseIterator(iter);
-
-    // Step 2. Find objects not present in grand total union.
-    for (i = 0; i < objectIndexLength; i++)
-    {
-        if (NULL != objectIndex[i] && !setIsMember(acc, i))
-        {
-            dbObjectRelease((dbObject *) objectIndex[i]);
-            free((dbObject *) objectIndex[i]);
-            objectIndex[i] = NULL;
-
-            if (i < objectIndexFreeId)
-            {
-                objectIndexFreeId = i;
-            }
-
-            collected++;
-        }
-    }
-
-    setDestroy(acc);
-
-    unlockRead(sets);
-    unlockWrite(objectIndex);
-
-    return collected;
-}
-
-void dbPrintIndex(FILE *f)
-{
-    valType i;
-
-    if (NULL == f)
-        return;
-
-    fprintf(f, "Object index dump. Total: %u\r\n", objectIndexCount);
-
-    lockWrite(objectIndex);
-
-    for (i = 0; i < objectIndexLength; i++)
-    {
-        if (NULL != objectIndex[i])
-        {
-            const dbObject *obj = objectIndex[i];
-            fprintf(f, "%10u: ", i);
-
-            switch (obj->objectType)
-            {
-                case objectSet:
-                    fprintf(f, "set = ");
-                    break;
-
-                case objectTuple:
-                    fprintf(f, "tuple = ");
-                    break;
-
-                case objectVal:
-                    fprintf(f, "val = ");
-                    break;
-            }
-
-            dbObjectPrint(obj, f, 0);
-            fprintf(f, "\r\n");
-        }
-    }
-
-    unlockWrite(objectIndex);
-}
-
-void dbPrintSets(FILE *f)
-{
-    dictIterator *iter = NULL;
-    dictEntry *entry = NULL;
-
-    if (NULL == f)
-        return;
-
-    lockRead(sets);
-
-    if (0 == dictSize(sets))
-    {
-        unlockRead(sets);
-        fprintf(f, "No sets in db.\r\n");
-        return;
-    }
-
-    if (NULL == (iter = dictGetIterator(sets)))
-    {
-        unlockRead(sets);
-        return;
-    }
-
-    while (NULL != (entry = dictNext(iter)))
-    {
-        fprintf(f, "%s\r\n", dictGetEntryKey(entry));
-        lockRead(dictGetEntryVal(entry));
-        setPrint((set *) dictGetEntryVal(entry), f, 1);
-        unlockRead(dictGetEntryVal(entry));
-        fprintf(f, "\r\n");
-    }
-
-    dictReleaseIterator(iter);
-    unlockRead(sets);
-}
-
-void dbPrintStatus(void *serverPtr)
-{
-    server *s = (server *) serverPtr;
-
-    if (NULL == s)
-        return;
-
-    while (s->working)
-    {
-        printf("Sets: %u. Objects: %u. Clients: %u\n", dictSize(sets), objectIndexCount, listLength(s->clients));
-        Sleep(BG_STATUS_SLEEP);
-    }
-}
-
-int dbUnregisterObject(valType id)
-{
-    lockWrite(objectIndex);
-    if (id >= objectIndexLength || NULL == objectIndex[id])
-    {
-        unlockWrite(objectIndex);
-        return -1;
-    }
-
-    dbObjectRelease((dbObject *) objectIndex[id]);
-    free((void *) objectIndex[id]);
-    objectIndex[id] = NULL;
-    objectIndexCount++;
-    unlockWrite(objectIndex);
-
-    return 1;
-}
-
-// Private api.
-unsigned int dictSdsHash(const void *key);
-void *dictSdsKeyDup(void *privdata, const void *key);
-int dictSdsKeyCompare(void *privdata, const void *key1, const void *key2);
-void dictSdsDestructor(void *privdata, void *val);
-
-/* Db->dict, keys are sds strings, vals are Redis objects. */
-dictType dictSetType =
-{
-    dictSdsHash,                 /* hash function */
-    dictSdsKeyDup,               /* key dup */
-    NULL,                        /* val dup */
-    dictSdsKeyCompare,           /* key compare */
-    dictSdsDestructor,           /* key destructor */
-    NULL                         /* val destructor */
-};
-
-void *dictSdsKeyDup(void *privdata, const void *key)
-{
-    return (void *) sdsdup((sds) key);
-}
-
-int dictSdsKeyCompare(void *privdata, const void *key1, const void *key2)
-{
-    int l1,l2;
-    DICT_NOTUSED(privdata);
-
-    l1 = sdslen((sds) key1);
-    l2 = sdslen((sds) key2);
-    if (l1 != l2) return 0;
-    return memcmp(key1, key2, l1) == 0;
-}
-
-unsigned int dictSdsHash(const void *key)
-{
-    return dictGenHashFunction((unsigned char*)key, sdslen((char*)key));
-}
-
-void dictSdsDestructor(void *privdata, void *val)
-{
-    DICT_NOTUSED(privdata);
-
-    sdsfree((sds) val);
-}
+// dbengine.c - Database engine.
+
+#include <memory.h>
+#include <stdlib.h>
+
+#include "dict.h"
+#include "sds.h"
+
+#include "dbengine.h"
+#include "dbobject.h"
+#include "syncengine.h"
+#include "setutils.h"
+#include "plan.h"
+#include "relation.h"
+#include "minhash.h"
+#include "hll.h"
+#include "reply.h"
+
+static dict *sets;
+static const dbObject **objectIndex;
+static valType objectIndexLength, objectIndexFreeId, objectIndexCount;
+static relation *tupleIndex[TUPLE_INDEX_POSITIONS]; // Component id -> ids of tuples having it at the position.
+static dict *valIndex;                              // Value -> id of its value object.
+static dict *objectHashIndex;                       // Other registered objects by value, own lock taken last.
+
+// Superset search intersects membership rows of at most this many members.
+#define DB_CONTAINMENT_PROBES 8
+
+// Named set slot of reverse membership index.
+typedef struct setSlot
+{
+    sds name;           // Owned by setSlots, NULL for free slots.
+    const set *s;
+    valType min, max;   // Member id bounds, valid if set isn't empty.
+    minHash sig;
+    hll sketch;
+    int staleSig;       // Members holding signature minimums were removed, see dbRefreshSignatures.
+    int staleSketch;    // Members holding register maximums were removed, see dbGetSketch.
+} setSlot;
+
+// Reverse membership index. Every named set gets a slot, memberIndex maps object id to slots
+// of named sets holding it. Guarded by setSlots lock, which is taken after any set lock.
+static dict *setSlots;          // Set name -> slot.
+static setSlot *slots;
+static valType slotsLength;
+static relation *memberIndex;
+static lshIndex *similarIndex;  // Slots by MinHash signature bands, stale ones by their old signature.
+static valType staleSigs;       // Number of slots with staleSig set.
+
+static dictType dictSetType;
+static dictType dictObjectType;
+static dictType dictValType;
+
+static int dbIndexInsert(dbObject *object, valType *id);
+static int dbSecondaryIndexUpdate(const dbObject *object, int add);
+static void dbObjectRehash(const set *s, unsigned int delta);
+static int dbSlotFind(const sds setName, valType *slot);
+static int dbSlotAcquire(const sds setName, valType *slot);
+static void dbSlotRelease(valType slot);
+static int dbMembershipUpdate(const set *s, valType slot, int add);
+static list *dbContainment(const set *s, int supersets);
+static void dbScanCollect(void *privdata, const dictEntry *de);
+static set *dbContainmentCandidates(const set *s, int supersets);
+static int dbRefreshSignatures(const set *locked);
+static set *dbSlotsUsed(void);
+
+int initDbEngine(void)
+{
+    valType pos;
+
+    objectIndexLength = 256;
+    objectIndexFreeId = 0;
+    objectIndexCount = 0;
+    if (NULL == (objectIndex = (const dbObject **) calloc(objectIndexLength, (sizeof(const dbObject *)))))
+        return -1;
+
+    for (pos = 0; pos < TUPLE_INDEX_POSITIONS; pos++)
+    {
+        if (NULL == (tupleIndex[pos] = relationCreate()))
+        {
+            while (pos--)
+                relationDestroy(tupleIndex[pos]);
+            free((void *) objectIndex);
+            return -1;
+        }
+    }
+
+    if (NULL == (valIndex = dictCreate(&dictValType, NULL)) ||
+        NULL == (objectHashIndex = dictCreate(&dictObjectType, NULL)))
+    {
+        if (NULL != valIndex)
+            dictRelease(valIndex);
+        for (pos = 0; pos < TUPLE_INDEX_POSITIONS; pos++)
+            relationDestroy(tupleIndex[pos]);
+        free((void *) objectIndex);
+        return -1;
+    }
+
+    if (NULL == (sets = dictCreate(&dictSetType, NULL)))
+    {
+        free((void *) objectIndex);
+        return -1;
+    }
+
+    if (NULL == (setSlots = dictCreate(&dictSetType, NULL)) ||
+        NULL == (memberIndex = relationCreate()) ||
+        NULL == (similarIndex = lshCreate()) ||
+        0 != registerSyncObject(setSlots))
+    {
+        if (NULL != setSlots)
+            dictRelease(setSlots);
+        relationDestroy(memberIndex);
+        lshDestroy(similarIndex);
+        free((void *) objectIndex);
+        dictRelease(sets);
+        return -1;
+    }
+
+    if (0 != registerSyncObject(sets))
+    {
+        free((void *) objectIndex);
+        dictRelease(sets);
+        return -1;
+    }
+
+    if (0 != registerSyncObject(objectIndex))
+    {
+        unregisterSyncObject(sets);
+        free((void *) objectIndex);
+        dictRelease(sets);
+        return -1;
+    }
+
+    if (0 != registerSyncObject(objectHashIndex))
+    {
+        unregisterSyncObject(objectIndex);
+        unregisterSyncObject(sets);
+        free((void *) objectIndex);
+        dictRelease(sets);
+        return -1;
+    }
+
+    if (0 != initPlanCache())
+    {
+        unregisterSyncObject(objectHashIndex);
+        unregisterSyncObject(objectIndex);
+        unregisterSyncObject(sets);
+        free((void *) objectIndex);
+        dictRelease(sets);
+        return -1;
+    }
+
+    return 0;
+}
+
+void cleanupDbEngine(void)
+{
+    dictIterator *i = NULL;
+    dictEntry *de = NULL;
+    valType c;
+
+    cleanupPlanCache();
+    unregisterSyncObject(sets);
+    unregisterSyncObject(objectIndex);
+    unregisterSyncObject(objectHashIndex);
+    unregisterSyncObject(setSlots);
+
+    if (NULL != setSlots)
+        dictRelease(setSlots);
+    free(slots);
+    relationDestroy(memberIndex);
+    lshDestroy(similarIndex);
+
+    if (NULL == sets)
+        return;
+
+    i = dictGetIterator(sets);
+
+    if (NULL != i)
+    {
+        while (NULL != (de = dictNext(i)))
+        {
+            set *setToDelete = (set *) dictGetEntryVal(de);
+
+            if (!setToDelete->registered)
+                setDestroy(setToDelete);
+        }
+    }
+
+    dictReleaseIterator(i);
+    dictRelease(sets);
+
+    for (c = 0; c < objectIndexLength; c++)
+        if (NULL != objectIndex[c])
+        {
+            dbObjectRelease((dbObject *) objectIndex[c]);
+            free((void *) objectIndex[c]);
+        }
+
+    free((void *) objectIndex);
+
+    for (c = 0; c < TUPLE_INDEX_POSITIONS; c++)
+        relationDestroy(tupleIndex[c]);
+
+    dictRelease(valIndex);
+    dictRelease(objectHashIndex);
+}
+
+const set *dbGet(const sds setName)
+{
+    const set *result = NULL;
+    lockRead(sets);
+    result = (const set *) dictFetchValue(sets, setName);
+    unlockRead(sets);
+    return result;
+}
+
+const sds dbGetRandSet(void)
+{
+    dictEntry *entry = NULL;
+    sds result = NULL;
+    lockRead(sets);
+    if (NULL != (entry = dictGetRandomKey(sets)))
+    {
+        result = (sds) entry->key;
+    }
+    unlockRead(sets);
+    return result;
+}
+
+list *dbScanSets(unsigned long *cursor, size_t count)
+{
+    list *result = NULL;
+
+    if (NULL == cursor || NULL == (result = listCreate()))
+        return NULL;
+
+    listSetFreeMethod(result, (void (*)(void *)) sdsfree);
+
+    // One bucket per step, so a batch holds the lock for about count entries.
+    lockRead(sets);
+    do
+    {
+        *cursor = dictScan(sets, *cursor, dbScanCollect, result);
+    }
+    while (0 != *cursor && listLength(result) < count);
+    unlockRead(sets);
+
+    // Names which failed to copy are left out as NULL nodes.
+    if (NULL != listSearchKey(result, NULL))
+    {
+        listRelease(result);
+        return NULL;
+    }
+
+    return result;
+}
+
+int dbScanMembers(const sds setName, valType *cursor, valType *ids, size_t count)
+{
+    const set *s = NULL;
+    setIterator iter;
+    size_t n;
+
+    if (NULL == setName || NULL == cursor || NULL == ids)
+        return -1;
+
+    lockRead(sets);
+    if (NULL == (s = (const set *) dictFetchValue(sets, setName)))
+    {
+        unlockRead(sets);
+        return -1;
+    }
+
+    lockRead(s);
+    unlockRead(sets);
+
+    setIterSeek(&iter, s, *cursor);
+    n = setGetNextMany(&iter, ids, count);
+
+    // Bitmap position is the cursor, it stays valid however the set changes in between.
+    *cursor = n == count ? iter.i : 0;
+
+    unlockRead(s);
+    return (int) n;
+}
+
+int dbRemove(const sds setName)
+{
+    int result = DICT_OK;
+    set *s = NULL;
+    lockWrite(sets);
+    s = (set *) dictFetchValue(sets, setName);
+    if (NULL != s)
+    {
+        valType slot;
+
+        lockWrite(s);
+        lockWrite(setSlots);
+        if (1 == dbSlotFind(setName, &slot))
+        {
+            dbMembershipUpdate(s, slot, 0);
+            dbSlotRelease(slot);
+        }
+        unlockWrite(setSlots);
+
+        unregisterSyncObject(s);
+        if (!s->registered)
+            setDestroy(s);
+        result = dictDelete(sets, setName);
+    }
+    unlockWrite(sets);
+    return result;
+}
+
+int dbFlushAll(void)
+{
+    dictIterator *iter = NULL;
+    dictEntry *entry = NULL;
+
+    lockWrite(sets);
+
+    if (NULL == (iter = dictGetIterator(sets)))
+    {
+        unlockWrite(sets);
+        return -1;
+    }
+
+    while (NULL != (entry = dictNext(iter)))
+    {
+        set *s = (set *) dictGetEntryVal(entry);
+        lockWrite(s);
+        if (!s->registered)
+            setDestroy(s);
+        unregisterSyncObject(s);
+    }
+
+    dictReleaseIterator(iter);
+    dictEmpty(sets);
+
+    lockWrite(setSlots);
+    relationDestroy(memberIndex);
+    memberIndex = relationCreate();
+    lshDestroy(similarIndex);
+    similarIndex = lshCreate();
+    dictEmpty(setSlots);
+    free(slots);
+    slots = NULL;
+    slotsLength = 0;
+    staleSigs = 0;
+    unlockWrite(setSlots);
+
+    unlockWrite(sets);
+    return NULL != memberIndex && NULL != similarIndex ? 0 : -1;
+}
+
+int dbRename(const sds oldSetName, const sds newSetName)
+{
+    const set *oldSet = NULL;
+    valType slot;
+
+    if (NULL == oldSetName || NULL == newSetName ||
+        0 == strlen(oldSetName) || 0 == strlen(newSetName))
+    {
+        return -1;
+    }
+
+    if (NULL == (oldSet = dbGet(oldSetName)) ||
+        NULL != dbGet(newSetName))
+    {
+        return -1;
+    }
+
+    lockWrite(sets);
+    dictDelete(sets, oldSetName);
+    dictAdd(sets, newSetName, (void *) oldSet);
+
+    // Set keeps its slot under the new name.
+    lockWrite(setSlots);
+    if (1 == dbSlotFind(oldSetName, &slot))
+    {
+        dictDelete(setSlots, oldSetName);
+        dictAdd(setSlots, newSetName, (void *) slot);
+        slots[slot].name = (sds) dictGetEntryKey(dictFind(setSlots, newSetName));
+    }
+    unlockWrite(setSlots);
+
+    unlockWrite(sets);
+    return 0;
+}
+
+const set *dbCreate(const sds setName)
+{
+    set *newSet = NULL;
+    valType slot;
+
+    if (NULL == setName || 0 == strlen(setName))
+    {
+        return NULL;
+    }
+
+    if (NULL == (newSet = setCreate()))
+        return NULL;
+
+    lockWrite(sets);
+
+    if (DICT_OK != dictAdd(sets, setName, newSet))
+    {
+        unlockWrite(sets);
+        setDestroy(newSet);
+        return NULL;
+    }
+
+    if (0 != registerSyncObject(newSet) && 1 != syncObjectIsRegistered(newSet))
+    {
+        unlockWrite(sets);
+        dictDelete(sets, setName);
+        setDestroy(newSet);
+        return NULL;
+    }
+
+    lockWrite(setSlots);
+    if (0 == dbSlotAcquire(setName, &slot))
+        slots[slot].s = newSet;
+    unlockWrite(setSlots);
+
+    unlockWrite(sets);
+    return newSet;
+}
+
+int dbSet(const sds setName, const set *s)
+{
+    set *prevSet = NULL;
+    valType slot;
+    minHash sig;
+    hll sketch;
+    int result = 0;
+
+    if (NULL == setName || 0 == strlen(setName) || NULL == s)
+        return -1;
+
+    // Signature and sketch of the new set are built before global locks are taken.
+    minHashInit(&sig);
+    hllInit(&sketch);
+    lockRead(s);
+    if ((SET_SIGNATURES && 0 != minHashFromSet(&sig, s)) || (SET_SKETCHES && 0 != hllFromSet(&sketch, s)))
+    {
+        unlockRead(s);
+        return -1;
+    }
+    unlockRead(s);
+
+    lockWrite(sets);
+
+    // Set lock goes before setSlots lock, like in commands changing the set.
+    if (NULL != (prevSet = (set *) dictFetchValue(sets, setName)) && prevSet != s)
+        lockWrite(prevSet);
+    else
+        prevSet = NULL;
+
+    lockWrite(setSlots);
+
+    if (0 != dbSlotAcquire(setName, &slot))
+    {
+        unlockWrite(setSlots);
+        unlockWrite(prevSet);
+        unlockWrite(sets);
+        return -1;
+    }
+
+    if (0 != registerSyncObject(s) && 1 != syncObjectIsRegistered(s))
+    {
+        if (NULL == dictFind(sets, setName))
+            dbSlotRelease(slot);
+
+        unlockWrite(setSlots);
+        unlockWrite(prevSet);
+        unlockWrite(sets);
+        return -1;
+    }
+
+    // Readers see the new set from here on, only the membership index is still being updated.
+    dictReplace(sets, setName, (void *) s);
+    unlockWrite(sets);
+
+    if (NULL != prevSet)
+        dbMembershipUpdate(prevSet, slot, 0);
+
+    slots[slot].s = s;
+    setGetBounds(s, &slots[slot].min, &slots[slot].max);
+    result = dbMembershipUpdate(s, slot, 1);
+
+    lshRemove(similarIndex, &slots[slot].sig, slot);
+    slots[slot].sig = sig;
+    slots[slot].sketch = sketch;
+    slots[slot].staleSketch = 0;
+
+    if (slots[slot].staleSig)
+        staleSigs--;
+    slots[slot].staleSig = 0;
+
+    if (SET_SIGNATURES && 0 != lshInsert(similarIndex, &slots[slot].sig, slot))
+        result = -1;
+
+    unlockWrite(setSlots);
+
+    if (NULL != prevSet)
+    {
+        if (!prevSet->registered)
+            setDestroy(prevSet);
+        unregisterSyncObject(prevSet);
+    }
+
+    return result;
+}
+
+int dbMemberAdded(const sds setName, valType id)
+{
+    valType slot;
+    const set *s = NULL;
+    unsigned int delta = 0;
+    int result = 0;
+    minHash prevSig;
+
+    lockWrite(setSlots);
+    if (1 == dbSlotFind(setName, &slot))
+    {
+        s = slots[slot].s;
+        delta = dbObjectMemberHash(id);
+        result = -1 == relationAdd(memberIndex, id, slot) ? -1 : 0;
+
+        if (1 == slots[slot].s->card)
+        {
+            slots[slot].min = id;
+            slots[slot].max = id;
+        }
+        else
+        {
+            slots[slot].min = __min(slots[slot].min, id);
+            slots[slot].max = __max(slots[slot].max, id);
+        }
+
+        prevSig = slots[slot].sig;
+        if (SET_SIGNATURES && !slots[slot].staleSig && minHashAdd(&slots[slot].sig, id))
+        {
+            lshRemove(similarIndex, &prevSig, slot);
+            if (0 != lshInsert(similarIndex, &slots[slot].sig, slot))
+                result = -1;
+        }
+
+        if (SET_SKETCHES)
+            hllAdd(&slots[slot].sketch, id);
+    }
+    unlockWrite(setSlots);
+    dbObjectRehash(s, delta);
+
+    return result;
+}
+
+int dbMemberRemoved(const sds setName, valType id)
+{
+    valType slot;
+    const set *s = NULL;
+    unsigned int delta = 0;
+    int result = 0;
+
+    lockWrite(setSlots);
+    if (1 == dbSlotFind(setName, &slot))
+    {
+        s = slots[slot].s;
+        delta = dbObjectMemberHash(id);
+        result = -1 == relationRemove(memberIndex, id, slot) ? -1 : 0;
+
+        if (id == slots[slot].min || id == slots[slot].max)
+            setGetBounds(slots[slot].s, &slots[slot].min, &slots[slot].max);
+
+        // Minimum can't be taken back, signature is rebuilt when it's needed.
+        if (SET_SIGNATURES && !slots[slot].staleSig && minHashHolds(&slots[slot].sig, id))
+        {
+            slots[slot].staleSig = 1;
+            staleSigs++;
+        }
+
+        // Register maximum can't be taken back either, sketch is rebuilt when it's needed.
+        if (SET_SKETCHES && hllHolds(&slots[slot].sketch, id))
+            slots[slot].staleSketch = 1;
+    }
+    unlockWrite(setSlots);
+    dbObjectRehash(s, delta);
+
+    return result;
+}
+
+int dbMembersAdded(const sds setName, const set *ids)
+{
+    valType slot;
+    const set *s = NULL;
+    unsigned int delta = 0;
+    int result = 0;
+    minHash prevSig;
+    setIterator *iter = NULL;
+
+    if (NULL == ids)
+        return -1;
+
+    lockWrite(setSlots);
+    if (1 == dbSlotFind(setName, &slot))
+    {
+        s = slots[slot].s;
+        prevSig = slots[slot].sig;
+
+        if (0 != setGetIter(ids, &iter))
+            result = -1;
+
+        while (NULL != iter && 0 == setGetNext(iter))
+        {
+            if (-1 == relationAdd(memberIndex, iter->val, slot))
+                result = -1;
+
+            delta ^= dbObjectMemberHash(iter->val);
+
+            if (SET_SIGNATURES && !slots[slot].staleSig)
+                minHashAdd(&slots[slot].sig, iter->val);
+
+            if (SET_SKETCHES)
+                hllAdd(&slots[slot].sketch, iter->val);
+        }
+
+        setDestroyIter(iter);
+        setGetBounds(slots[slot].s, &slots[slot].min, &slots[slot].max);
+
+        if (SET_SIGNATURES && 0 != memcmp(&prevSig, &slots[slot].sig, sizeof(minHash)))
+        {
+            lshRemove(similarIndex, &prevSig, slot);
+            if (0 != lshInsert(similarIndex, &slots[slot].sig, slot))
+                result = -1;
+        }
+    }
+    unlockWrite(setSlots);
+    dbObjectRehash(s, delta);
+
+    return result;
+}
+
+int dbMembersRemoved(const sds setName, const set *ids)
+{
+    valType slot;
+    const set *s = NULL;
+    unsigned int delta = 0;
+    int result = 0;
+    setIterator *iter = NULL;
+
+    if (NULL == ids)
+        return -1;
+
+    lockWrite(setSlots);
+    if (1 == dbSlotFind(setName, &slot))
+    {
+        s = slots[slot].s;
+        if (0 != setGetIter(ids, &iter))
+            result = -1;
+
+        while (NULL != iter && 0 == setGetNext(iter))
+        {
+            if (-1 == relationRemove(memberIndex, iter->val, slot))
+                result = -1;
+
+            delta ^= dbObjectMemberHash(iter->val);
+
+            if (SET_SIGNATURES && !slots[slot].staleSig && minHashHolds(&slots[slot].sig, iter->val))
+            {
+                slots[slot].staleSig = 1;
+                staleSigs++;
+            }
+
+            if (SET_SKETCHES && !slots[slot].staleSketch && hllHolds(&slots[slot].sketch, iter->val))
+                slots[slot].staleSketch = 1;
+        }
+
+        setDestroyIter(iter);
+        setGetBounds(slots[slot].s, &slots[slot].min, &slots[slot].max);
+    }
+    unlockWrite(setSlots);
+    dbObjectRehash(s, delta);
+
+    return result;
+}
+
+list *dbWhich(valType id)
+{
+    list *result = NULL;
+    setIterator *iter = NULL;
+    sds name = NULL;
+
+    if (NULL == (result = listCreate()))
+        return NULL;
+
+    listSetFreeMethod(result, (void (*)(void *)) sdsfree);
+
+    lockRead(setSlots);
+
+    if (id >= memberIndex->rowsCount || NULL == memberIndex->rows[id])
+    {
+        unlockRead(setSlots);
+        return result;
+    }
+
+    if (0 != setGetIter(memberIndex->rows[id], &iter))
+    {
+        unlockRead(setSlots);
+        listRelease(result);
+        return NULL;
+    }
+
+    while (NULL != iter && 0 == setGetNext(iter))
+    {
+        if (NULL == (name = sdsdup(slots[iter->val].name)) ||
+            NULL == listAddNodeTail(result, name))
+        {
+            if (NULL != name)
+                sdsfree(name);
+
+            setDestroyIter(iter);
+            unlockRead(setSlots);
+            listRelease(result);
+            return NULL;
+        }
+    }
+
+    setDestroyIter(iter);
+    unlockRead(setSlots);
+    return result;
+}
+
+const dbObject *dbGetObject(valType id, int lock)
+{
+    const dbObject *result = NULL;
+
+    if (lock)
+        lockRead(objectIndex);
+
+    if (id >= objectIndexLength)
+    {
+        unlockRead(objectIndex);
+        return NULL;
+    }
+
+    result = objectIndex[id];
+
+    if (lock)
+        unlockRead(objectIndex);
+    return result;
+}
+
+void dbGetObjects(const valType *ids, size_t count, const dbObject **objects, int lock)
+{
+    size_t k;
+
+    if (lock)
+        lockRead(objectIndex);
+
+    for (k = 0; k < count; k++)
+        objects[k] = ids[k] < objectIndexLength ? objectIndex[ids[k]] : NULL;
+
+    if (lock)
+        unlockRead(objectIndex);
+}
+
+int dbRegisterObject(dbObject **object, valType *id)
+{
+    if (NULL == id || NULL == object || NULL == *object)
+    {
+        return -1;
+    }
+
+    lockWrite(objectIndex);
+
+    if (1 == dbFindObject(*object, id, 0))
+    {
+        dbObjectRelease(*object);
+        free(*object);
+        *object = (dbObject *) objectIndex[*id];
+        unlockWrite(objectIndex);
+        return 0;
+    }
+
+    if (0 != dbIndexInsert(*object, id))
+    {
+        unlockWrite(objectIndex);
+        return -1;
+    }
+
+    unlockWrite(objectIndex);
+
+    return 0;
+}
+
+int dbInternVals(const valType *vals, size_t count, valType *ids)
+{
+    dbObject *object = NULL;
+    dictEntry *entry = NULL;
+    size_t k;
+
+    if (NULL == vals || NULL == ids)
+        return -1;
+
+    lockWrite(objectIndex);
+
+    for (k = 0; k < count; k++)
+    {
+        if (NULL != (entry = dictFind(valIndex, (void *) vals[k])))
+        {
+            ids[k] = (valType) dictGetEntryVal(entry);
+            continue;
+        }
+
+        if (NULL == (object = (dbObject *) calloc(1, sizeof(dbObject))))
+            break;
+
+        object->objectType = objectVal;
+        object->objectPtr.val = vals[k];
+
+        if (0 != dbIndexInsert(object, &ids[k]))
+        {
+            free(object);
+            break;
+        }
+    }
+
+    unlockWrite(objectIndex);
+    return k < count ? -1 : 0;
+}
+
+int dbRegisterObjects(dbObject **objects, size_t count, valType *ids)
+{
+    size_t k;
+
+    if (NULL == objects || NULL == ids)
+        return -1;
+
+    if (0 == count)
+        return 0;
+
+    lockWrite(objectIndex);
+
+    // Objects inserted earlier in the batch are already indexed, later equal ones get their ids.
+    for (k = 0; k < count; k++)
+    {
+        if (1 == dbFindObject(objects[k], &ids[k], 0))
+        {
+            dbObjectRelease(objects[k]);
+            free(objects[k]);
+            objects[k] = (dbObject *) objectIndex[ids[k]];
+            continue;
+        }
+
+        if (0 != dbIndexInsert(objects[k], &ids[k]))
+            break;
+    }
+
+    unlockWrite(objectIndex);
+
+    if (k < count)
+    {
+        for (; k < count; k++)
+        {
+            dbObjectRelease(objects[k]);
+            free(objects[k]);
+            objects[k] = NULL;
+        }
+
+        return -1;
+    }
+
+    return 0;
+}
+
+list *dbSubsets(const set *s)
+{
+    return dbContainment(s, 0);
+}
+
+list *dbSupersets(const set *s)
+{
+    return dbContainment(s, 1);
+}
+
+int dbSimilar(const set *s, size_t k, dbMatch *matches)
+{
+    set *candidates = NULL;
+    setIterator *iter = NULL;
+    minHash sig;
+    valType inter, uni;
+    size_t count = 0, i;
+    double score;
+    const set *c = NULL;
+
+    if (NULL == s || NULL == matches)
+        return -1;
+
+    lockRead(sets);
+    lockRead(s);
+
+    if (SET_SIGNATURES && (0 != dbRefreshSignatures(s) || 0 != minHashFromSet(&sig, s)))
+    {
+        unlockRead(s);
+        unlockRead(sets);
+        return -1;
+    }
+
+    // Without signatures every named set is a candidate.
+    lockRead(setSlots);
+    candidates = SET_SIGNATURES ? lshCandidates(similarIndex, &sig) : dbSlotsUsed();
+    unlockRead(setSlots);
+
+    if (NULL == candidates || 0 != setGetIter(candidates, &iter))
+    {
+        setDestroy(candidates);
+        unlockRead(s);
+        unlockRead(sets);
+        return -1;
+    }
+
+    // Candidates are ranked by exact Jaccard similarity, top k are kept sorted in matches.
+    while (0 != k && NULL != iter && 0 == setGetNext(iter))
+    {
+        if (NULL == (c = slots[iter->val].s))
+            continue;
+
+        if (c != s)
+            lockRead(c);
+
+        setInterUnionCard(s, c, &inter, &uni);
+
+        if (c != s)
+            unlockRead(c);
+
+        // Scanning every set would list the disjoint ones too.
+        if (!SET_SIGNATURES && 0 == inter && 0 != uni)
+            continue;
+
+        score = 0 == uni ? 1.0 : (double) inter / uni;
+
+        if (count == k && score <= matches[k - 1].score)
+            continue;
+
+        for (i = count < k ? count++ : k - 1; i > 0 && matches[i - 1].score < score; i--)
+            matches[i] = matches[i - 1];
+
+        matches[i].name = slots[iter->val].name;
+        matches[i].score = score;
+    }
+
+    setDestroyIter(iter);
+    setDestroy(candidates);
+
+    for (i = 0; i < count; i++)
+    {
+        if (NULL == (matches[i].name = sdsdup(matches[i].name)))
+        {
+            while (i--)
+                sdsfree(matches[i].name);
+
+            count = (size_t) -1;
+            break;
+        }
+    }
+
+    unlockRead(s);
+    unlockRead(sets);
+    return (int) count;
+}
+
+int dbGetSketch(const sds setName, hll *h)
+{
+    valType slot;
+    const set *s = NULL;
+    int result = -1;
+
+    if (NULL == setName || NULL == h)
+        return -1;
+
+    lockRead(setSlots);
+    if (1 == dbSlotFind(setName, &slot) && NULL != (s = slots[slot].s))
+    {
+        *h = slots[slot].sketch;
+        result = !SET_SKETCHES || slots[slot].staleSketch ? 1 : 0;
+    }
+    unlockRead(setSlots);
+
+    if (1 != result)
+        return result;
+
+    // Stale sketch is rebuilt under the set read lock only, which also keeps it from changing
+    // until the new sketch is stored.
+    lockRead(s);
+    if (0 != hllFromSet(h, s))
+    {
+        unlockRead(s);
+        return -1;
+    }
+
+    if (SET_SKETCHES)
+    {
+        lockWrite(setSlots);
+        if (1 == dbSlotFind(setName, &slot) && s == slots[slot].s)
+        {
+            slots[slot].sketch = *h;
+            slots[slot].staleSketch = 0;
+        }
+        unlockWrite(setSlots);
+    }
+    unlockRead(s);
+
+    return 0;
+}
+
+set *dbValRangeInter(const set *s, valType from, valType to)
+{
+    set *result = NULL;
+    setIterator *iter = NULL;
+    const dbObject *obj = NULL;
+    int failed = 0;
+
+    if (NULL == s || NULL == (result = setCreate()))
+        return NULL;
+
+    if (0 != setGetIter(s, &iter))
+    {
+        setDestroy(result);
+        return NULL;
+    }
+
+    lockRead(objectIndex);
+
+    while (!failed && NULL != iter && 0 == setGetNext(iter))
+    {
+        obj = iter->val < objectIndexLength ? objectIndex[iter->val] : NULL;
+
+        if (NULL != obj && objectVal == obj->objectType &&
+            obj->objectPtr.val >= from && obj->objectPtr.val <= to)
+        {
+            failed = -1 == setAdd(result, iter->val);
+        }
+    }
+
+    unlockRead(objectIndex);
+    setDestroyIter(iter);
+
+    if (failed)
+    {
+        setDestroy(result);
+        return NULL;
+    }
+
+    return result;
+}
+
+set *dbTupleIndexInter(const set *s, valType pos, valType id, int lock)
+{
+    set *result = NULL;
+
+    if (NULL == s || pos >= TUPLE_INDEX_POSITIONS)
+        return NULL;
+
+    if (lock)
+        lockRead(objectIndex);
+
+    if (id < tupleIndex[pos]->rowsCount && NULL != tupleIndex[pos]->rows[id])
+        result = setInter(s, tupleIndex[pos]->rows[id]);
+    else
+        result = setCreate();
+
+    if (lock)
+        unlockRead(objectIndex);
+
+    return result;
+}
+
+int dbFindObject(const dbObject *object, valType *index, int lock)
+{
+    dictEntry *entry = NULL;
+
+    if (NULL == object)
+        return 0;
+
+    if (lock)
+        lockRead(objectIndex);
+
+    if (objectVal == object->objectType)
+    {
+        if (NULL != (entry = dictFind(valIndex, (void *) object->objectPtr.val)) && index)
+            *index = (valType) dictGetEntryVal(entry);
+    }
+    else
+    {
+        lockRead(objectHashIndex);
+        if (NULL != (entry = dictFind(objectHashIndex, object)) && index)
+            *index = ((const dbObject *) dictGetEntryKey(entry))->id;
+        unlockRead(objectHashIndex);
+    }
+
+    if (lock)
+        unlockRead(objectIndex);
+    return NULL != entry;
+}
+
+int dbFindSet(const set *s, valType *index, int lock)
+{
+    dbObject probe;
+
+    if (NULL == s)
+        return 0;
+
+    probe.objectType = objectSet;
+    probe.objectPtr.setPtr = (set *) s;
+
+    return dbFindObject(&probe, index, lock);
+}
+
+valType dbSetTrunc(void)
+{
+    valType freed = 0, i;
+    dictIterator *iter = NULL;
+    dictEntry *entry = NULL;
+    set *s = NULL;
+
+    // Named sets are shrunk one at a time under their own write lock, like a command growing them,
+    // so no global lock is held while bitmaps are moved.
+    lockRead(sets);
+    if (NULL != (iter = dictGetIterator(sets)))
+    {
+        while (NULL != (entry = dictNext(iter)))
+        {
+            s = (set *) dictGetEntryVal(entry);
+            lockWrite(s);
+            freed += setTrunc(s);
+            unlockWrite(s);
+        }
+
+        dictReleaseIterator(iter);
+    }
+    unlockRead(sets);
+
+    // Other registered sets have no lock of their own and never change, the index lock keeps them alive.
+    lockWrite(objectIndex);
+    for (i = 0; i < objectIndexLength; i++)
+    {
+        if (NULL != objectIndex[i] &&
+            objectSet == objectIndex[i]->objectType &&
+            1 != syncObjectIsRegistered(objectIndex[i]->objectPtr.setPtr))
+        {
+            freed += setTrunc(objectIndex[i]->objectPtr.setPtr);
+        }
+    }
+    unlockWrite(objectIndex);
+
+    return freed;
+}
+
+valType dbGC(void)
+{
+    valType collected = 0, i;
+    dictIterator *iter = NULL;
+    dictEntry *entry = NULL;
+    set *acc = NULL;
+
+    lockWrite(objectIndex);
+    lockRead(sets);
+
+    // Step 1. Union all sets in db.
+    if (NULL == (iter = dictGetIterator(sets)))
+    {
+        unlockRead(sets);
+        unlockWrite(objectIndex);
+        return 0;
+    }
+
+    if (NULL == (acc = setCreate()))
+    {
+        unlockRead(sets);
+        unlockWrite(objectIndex);
+        return 0;
+    }
+
+    while (NULL != (entry = dictNext(iter)))
+    {
+        valType currentSetId = 0;
+        set *tmp = NULL, *currentSet = (set *) dictGetEntryVal(entry);
+        set *flattened = setFlatten(currentSet, 0);
+
+        if (NULL == flattened)
+        {
+            continue;
+        }
+
+        if (1 == dbFindSet(currentSet, &currentSetId, 0))
+        {
+            if (-1 == setAdd(acc, currentSetId))
+            {
+                setDestroy(acc);
+                dictReleaseIterator(iter);
+                unlockRead(sets);
+                unlockWrite(objectIndex);
+                return 0;
+            }
+        }
+
+        if (NULL == (tmp = setUnion(acc, flattened)))
+        {
+            setDestroy(flattened);
+            setDestroy(acc);
+            dictReleaseIterator(iter);
+            unlockRead(sets);
+            unlockWrite(objectIndex);
+            return 0;
+        }
+
+        setDestroy(flattened);
+        setDestroy(acc);
+        acc = tmp;
+    }
+
+    dictReleaseIterator(iter);
+
+    // Step 2. Find objects not present in grand total union.
+    for (i = 0; i < objectIndexLength; i++)
+    {
+        if (NULL != objectIndex[i] && !setIsMember(acc, i))
+        {
+            dbSecondaryIndexUpdate(objectIndex[i], 0);
+            dbObjectRelease((dbObject *) objectIndex[i]);
+            free((dbObject *) objectIndex[i]);
+            objectIndex[i] = NULL;
+
+            if (i < objectIndexFreeId)
+            {
+                objectIndexFreeId = i;
+            }
+
+            collected++;
+        }
+    }
+
+    setDestroy(acc);
+
+    unlockRead(sets);
+    unlockWrite(objectIndex);
+
+    return collected;
+}
+
+size_t dbIndexPage(valType *cursor, valType to, unsigned types, dbIndexEntry *entries, size_t count)
+{
+    const dbObject *obj = NULL;
+    valType id, last;
+    size_t n = 0;
+
+    if (NULL == cursor || NULL == entries)
+        return 0;
+
+    lockRead(objectIndex);
+
+    last = __min(to, objectIndexLength - 1);
+    if (*cursor + DB_INDEX_PAGE_SCAN - 1 < last)
+        last = *cursor + DB_INDEX_PAGE_SCAN - 1;
+
+    for (id = *cursor; id <= last && n < count; id++)
+    {
+        if (NULL == (obj = objectIndex[id]) || 0 == (types & (1 << obj->objectType)))
+            continue;
+
+        entries[n].id = id;
+        entries[n].type = obj->objectType;
+        dbObjectSummarize(obj, &entries[n].card, &entries[n].bytes);
+        n++;
+    }
+
+    *cursor = id <= __min(to, objectIndexLength - 1) ? id : 0;
+
+    unlockRead(objectIndex);
+    return n;
+}
+
+valType dbIndexCount(void)
+{
+    valType result;
+
+    lockRead(objectIndex);
+    result = objectIndexCount;
+    unlockRead(objectIndex);
+
+    return result;
+}
+
+void dbPrintSets(FILE *f)
+{
+    dictIterator *iter = NULL;
+    dictEntry *entry = NULL;
+    reply r;
+
+    if (NULL == f)
+        return;
+
+    lockRead(sets);
+
+    if (0 == dictSize(sets))
+    {
+        unlockRead(sets);
+        fprintf(f, "No sets in db.\r\n");
+        return;
+    }
+
+    if (NULL == (iter = dictGetIterator(sets)))
+    {
+        unlockRead(sets);
+        return;
+    }
+
+    while (NULL != (entry = dictNext(iter)))
+    {
+        fprintf(f, "%s\r\n", dictGetEntryKey(entry));
+        replyInit(&r, f);
+        lockRead(dictGetEntryVal(entry));
+        setPrint((set *) dictGetEntryVal(entry), &r, 1);
+        unlockRead(dictGetEntryVal(entry));
+        replyWrite(&r, "\r\n", 2);
+        replyFlush(&r);
+    }
+
+    dictReleaseIterator(iter);
+    unlockRead(sets);
+}
+
+void dbPrintStatus(void *serverPtr)
+{
+    server *s = (server *) serverPtr;
+
+    if (NULL == s)
+        return;
+
+    while (s->working)
+    {
+        printf("Sets: %u. Objects: %u. Clients: %u\n", dictSize(sets), objectIndexCount, listLength(s->clients));
+        Sleep(BG_STATUS_SLEEP);
+    }
+}
+
+int dbUnregisterObject(valType id)
+{
+    lockWrite(objectIndex);
+    if (id >= objectIndexLength || NULL == objectIndex[id])
+    {
+        unlockWrite(objectIndex);
+        return -1;
+    }
+
+    dbSecondaryIndexUpdate(objectIndex[id], 0);
+    dbObjectRelease((dbObject *) objectIndex[id]);
+    free((void *) objectIndex[id]);
+    objectIndex[id] = NULL;
+    objectIndexCount++;
+    unlockWrite(objectIndex);
+
+    return 1;
+}
+
+// Private api.
+// Puts object into the first free index slot, growing the index if there is none.
+// Must be called with objectIndex locked for writing. Returns -1 on error.
+static int dbIndexInsert(dbObject *object, valType *id)
+{
+    const dbObject **t = NULL;
+    valType newLength;
+
+    while (objectIndexFreeId < objectIndexLength && NULL != objectIndex[objectIndexFreeId])
+        objectIndexFreeId++;
+
+    if (objectIndexFreeId >= objectIndexLength)
+    {
+        // Doubling keeps bulk registration linear.
+        newLength = __max(objectIndexLength * 2, 256);
+
+        if (NULL == (t = (const dbObject **) realloc((void *) objectIndex, newLength * sizeof(dbObject *))))
+            return -1;
+
+        memset((void *) (t + objectIndexLength), 0, (newLength - objectIndexLength) * sizeof(dbObject *));
+        objectIndex = t;
+        objectIndexLength = newLength;
+    }
+
+    object->id = objectIndexFreeId;
+
+    if (0 != dbSecondaryIndexUpdate(object, 1))
+    {
+        dbSecondaryIndexUpdate(object, 0);
+        return -1;
+    }
+
+    objectIndex[objectIndexFreeId] = object;
+    *id = objectIndexFreeId;
+    objectIndexFreeId++;
+    objectIndexCount++;
+
+    if (objectSet == object->objectType)
+    {
+        object->objectPtr.setPtr->registered = 1;
+    }
+
+    return 0;
+}
+
+// Adds object to or removes it from secondary indexes: values to value index, other objects to
+// object hash index and tuples also to positional indexes. Must be called with objectIndex locked
+// for writing. Returns -1 on error.
+static int dbSecondaryIndexUpdate(const dbObject *object, int add)
+{
+    listNode *node = NULL;
+    valType pos = 0;
+
+    if (objectVal == object->objectType)
+    {
+        if (!add)
+            dictDelete(valIndex, (void *) object->objectPtr.val);
+        else if (DICT_OK != dictAdd(valIndex, (void *) object->objectPtr.val, (void *) object->id))
+            return -1;
+
+        return 0;
+    }
+
+    lockWrite(objectHashIndex);
+
+    if (!add)
+    {
+        dictDelete(objectHashIndex, object);
+    }
+    else
+    {
+        if (objectSet == object->objectType)
+            object->objectPtr.setPtr->hash = dbObjectHash(object);
+
+        if (DICT_OK != dictAdd(objectHashIndex, (void *) object, NULL))
+        {
+            unlockWrite(objectHashIndex);
+            return -1;
+        }
+    }
+
+    unlockWrite(objectHashIndex);
+
+    if (objectTuple != object->objectType)
+        return 0;
+
+    for (node = listFirst(object->objectPtr.tuplePtr); NULL != node && pos < TUPLE_INDEX_POSITIONS;
+         node = listNextNode(node), pos++)
+    {
+        if (add)
+        {
+            if (-1 == relationAdd(tupleIndex[pos], (valType) listNodeValue(node), object->id))
+                return -1;
+        }
+        else
+        {
+            relationRemove(tupleIndex[pos], (valType) listNodeValue(node), object->id);
+        }
+    }
+
+    return 0;
+}
+
+// Moves registered set s, which was changed in place, to the hash index bucket of its current members.
+// delta is the xor of the hashes of members that changed, see dbObjectMemberHash.
+// Takes only the object hash index lock, so it can be called with set locks held.
+static void dbObjectRehash(const set *s, unsigned int delta)
+{
+    dbObject probe;
+    dictEntry *entry = NULL;
+    dbObject *object = NULL;
+
+    if (NULL == s || !s->registered || 0 == delta)
+        return;
+
+    probe.objectType = objectSet;
+    probe.objectPtr.setPtr = (set *) s;
+
+    lockWrite(objectHashIndex);
+    if (NULL != (entry = dictFind(objectHashIndex, &probe)))
+    {
+        object = (dbObject *) dictGetEntryKey(entry);
+        dictDelete(objectHashIndex, object);
+        object->objectPtr.setPtr->hash ^= delta;
+        dictAdd(objectHashIndex, object, NULL);
+    }
+    unlockWrite(objectHashIndex);
+}
+
+// Slot helpers must be called with setSlots locked for writing.
+// Returns 1 if setName has a slot, 0 otherwise.
+static int dbSlotFind(const sds setName, valType *slot)
+{
+    dictEntry *entry = dictFind(setSlots, setName);
+
+    if (NULL == entry)
+        return 0;
+
+    *slot = (valType) dictGetEntryVal(entry);
+    return 1;
+}
+
+// Finds slot of setName or gives it the first free one. Returns -1 on error.
+static int dbSlotAcquire(const sds setName, valType *slot)
+{
+    setSlot *t = NULL;
+    valType newLength;
+
+    if (1 == dbSlotFind(setName, slot))
+        return 0;
+
+    for (*slot = 0; *slot < slotsLength && NULL != slots[*slot].name; (*slot)++);
+
+    if (*slot == slotsLength)
+    {
+        newLength = __max(slotsLength * 2, 16);
+
+        if (NULL == (t = (setSlot *) realloc(slots, newLength * sizeof(setSlot))))
+            return -1;
+
+        memset(t + slotsLength, 0, (newLength - slotsLength) * sizeof(setSlot));
+        slots = t;
+        slotsLength = newLength;
+    }
+
+    if (DICT_OK != dictAdd(setSlots, setName, (void *) *slot))
+        return -1;
+
+    memset(&slots[*slot], 0, sizeof(setSlot));
+    minHashInit(&slots[*slot].sig);
+    slots[*slot].name = (sds) dictGetEntryKey(dictFind(setSlots, setName));
+    return 0;
+}
+
+static void dbSlotRelease(valType slot)
+{
+    sds name = slots[slot].name;
+
+    if (slots[slot].staleSig)
+        staleSigs--;
+
+    lshRemove(similarIndex, &slots[slot].sig, slot);
+    memset(&slots[slot], 0, sizeof(setSlot));
+    dictDelete(setSlots, name);
+}
+
+// Adds or removes slot for every member of s. Returns -1 on error.
+static int dbMembershipUpdate(const set *s, valType slot, int add)
+{
+    setIterator *iter = NULL;
+
+    if (0 != setGetIter(s, &iter))
+        return -1;
+
+    while (NULL != iter && 0 == setGetNext(iter))
+    {
+        if (add && -1 == relationAdd(memberIndex, iter->val, slot))
+        {
+            setDestroyIter(iter);
+            return -1;
+        }
+
+        if (!add)
+            relationRemove(memberIndex, iter->val, slot);
+    }
+
+    setDestroyIter(iter);
+    return 0;
+}
+
+// Appends copy of set name in de to list privdata.
+static void dbScanCollect(void *privdata, const dictEntry *de)
+{
+    list *names = (list *) privdata;
+    sds name = sdsdup((sds) dictGetEntryKey(de));
+
+    if (NULL == listAddNodeTail(names, name))
+        sdsfree(name);
+}
+
+// Returns names of named sets which are subsets (or supersets) of s or NULL on error. Candidates
+// are pruned by the membership index, cardinality and member id bounds before the word test.
+static list *dbContainment(const set *s, int supersets)
+{
+    list *result = NULL;
+    set *candidates = NULL;
+    valType *matches = NULL, count = 0, slot, min = 0, max = 0;
+    int empty, ok;
+    sds name = NULL;
+
+    if (NULL == s || NULL == (result = listCreate()))
+        return NULL;
+
+    listSetFreeMethod(result, (void (*)(void *)) sdsfree);
+
+    // Holding sets keeps names and slots in place, set locks are taken after it.
+    lockRead(sets);
+    lockRead(s);
+    lockRead(setSlots);
+
+    empty = 0 != setGetBounds(s, &min, &max);
+
+    if (NULL == (matches = (valType *) malloc(__max(slotsLength, 1) * sizeof(valType))) ||
+        (!empty && NULL == (candidates = dbContainmentCandidates(s, supersets))))
+    {
+        unlockRead(setSlots);
+        unlockRead(s);
+        unlockRead(sets);
+        free(matches);
+        listRelease(result);
+        return NULL;
+    }
+
+    for (slot = 0; slot < slotsLength; slot++)
+    {
+        const setSlot *c = &slots[slot];
+
+        if (NULL == c->name || NULL == c->s)
+            continue;
+
+        if (supersets)
+        {
+            // Empty s is a subset of every set.
+            ok = empty || (setIsMember(candidates, slot) && c->s->card >= s->card &&
+                           c->min <= min && c->max >= max);
+        }
+        else
+        {
+            // Empty named set is a subset of every set.
+            ok = 0 == c->s->card ||
+                 (!empty && setIsMember(candidates, slot) && c->s->card <= s->card &&
+                  c->min >= min && c->max <= max);
+        }
+
+        if (ok)
+            matches[count++] = slot;
+    }
+
+    unlockRead(setSlots);
+    setDestroy(candidates);
+
+    for (slot = 0; slot < count; slot++)
+    {
+        const set *c = slots[matches[slot]].s;
+
+        if (c != s)
+            lockRead(c);
+
+        ok = 1 == (supersets ? setCmpSubsetOrEq(s, c) : setCmpSubsetOrEq(c, s));
+
+        if (c != s)
+            unlockRead(c);
+
+        if (ok && (NULL == (name = sdsdup(slots[matches[slot]].name)) ||
+                   NULL == listAddNodeTail(result, name)))
+        {
+            if (NULL != name)
+                sdsfree(name);
+
+            unlockRead(s);
+            unlockRead(sets);
+            free(matches);
+            listRelease(result);
+            return NULL;
+        }
+    }
+
+    unlockRead(s);
+    unlockRead(sets);
+    free(matches);
+    return result;
+}
+
+// Returns slots of named sets which may hold every member of non-empty s (supersets) or
+// at least one of them (subsets). Must be called with setSlots locked. Returns NULL on error.
+static set *dbContainmentCandidates(const set *s, int supersets)
+{
+    set *result = NULL, *t = NULL;
+    setIterator *iter = NULL;
+    const set *row = NULL;
+    valType probes = 0, slot;
+
+    // Merging a row per member costs more than testing every slot.
+    if (!supersets && s->card > slotsLength * 8)
+    {
+        if (NULL == (result = setCreate()))
+            return NULL;
+
+        for (slot = 0; slot < slotsLength; slot++)
+        {
+            if (-1 == setAdd(result, slot))
+            {
+                setDestroy(result);
+                return NULL;
+            }
+        }
+
+        return result;
+    }
+
+    if (NULL == (result = setCreate()) || 0 != setGetIter(s, &iter))
+    {
+        setDestroy(result);
+        return NULL;
+    }
+
+    while (NULL != iter && 0 == setGetNext(iter))
+    {
+        row = iter->val < memberIndex->rowsCount ? memberIndex->rows[iter->val] : NULL;
+
+        if (!supersets)
+        {
+            if (NULL != row && -1 == setMerge(result, row))
+            {
+                setDestroyIter(iter);
+                setDestroy(result);
+                return NULL;
+            }
+
+            continue;
+        }
+
+        // Superset slot is in every member row. A few rows narrow candidates enough,
+        // the word test does the rest.
+        if (NULL == row)
+        {
+            setDestroyIter(iter);
+            return result;
+        }
+
+        t = 0 == probes ? setCopy(row) : setInter(result, row);
+        setDestroy(result);
+
+        if (NULL == (result = t) || 0 == result->card || ++probes == DB_CONTAINMENT_PROBES)
+        {
+            setDestroyIter(iter);
+            return result;
+        }
+    }
+
+    setDestroyIter(iter);
+    return result;
+}
+
+unsigned int dictSdsHash(const void *key);
+void *dictSdsKeyDup(void *privdata, const void *key);
+int dictSdsKeyCompare(void *privdata, const void *key1, const void *key2);
+void dictSdsDestructor(void *privdata, void *val);
+
+/* Db->dict, keys are sds strings, vals are Redis objects. */
+dictType dictSetType =
+{
+    dictSdsHash,                 /* hash function */
+    dictSdsKeyDup,               /* key dup */
+    NULL,                        /* val dup */
+    dictSdsKeyCompare,           /* key compare */
+    dictSdsDestructor,           /* key destructor */
+    NULL                         /* val destructor */
+};
+
+void *dictSdsKeyDup(void *privdata, const void *key)
+{
+    return (void *) sdsdup((sds) key);
+}
+
+int dictSdsKeyCompare(void *privdata, const void *key1, const void *key2)
+{
+    int l1,l2;
+    DICT_NOTUSED(privdata);
+
+    l1 = sdslen((sds) key1);
+    l2 = sdslen((sds) key2);
+    if (l1 != l2) return 0;
+    return memcmp(key1, key2, l1) == 0;
+}
+
+unsigned int dictSdsHash(const void *key)
+{
+    return dictGenHashFunction((unsigned char*)key, sdslen((char*)key));
+}
+
+void dictSdsDestructor(void *privdata, void *val)
+{
+    DICT_NOTUSED(privdata);
+
+    sdsfree((sds) val);
+}
+
+unsigned int dictValHash(const void *key);
+
+/* Value index, keys are values, vals are ids of their value objects. */
+static dictType dictValType =
+{
+    dictValHash,                 /* hash function */
+    NULL,                        /* key dup */
+    NULL,                        /* val dup */
+    NULL,                        /* key compare */
+    NULL,                        /* key destructor */
+    NULL                         /* val destructor */
+};
+
+unsigned int dictValHash(const void *key)
+{
+    return dictIntHashFunction((unsigned int) (size_t) key);
+}
+
+unsigned int dictObjectHash(const void *key);
+int dictObjectKeyCompare(void *privdata, const void *key1, const void *key2);
+
+/* Object hash index, keys are registered objects other than values. */
+static dictType dictObjectType =
+{
+    dictObjectHash,              /* hash function */
+    NULL,                        /* key dup */
+    NULL,                        /* val dup */
+    dictObjectKeyCompare,        /* key compare */
+    NULL,                        /* key destructor */
+    NULL                         /* val destructor */
+};
+
+// Registered sets keep the hash they were indexed with, see dbObjectRehash.
+unsigned int dictObjectHash(const void *key)
+{
+    const dbObject *obj = (const dbObject *) key;
+
+    if (objectSet == obj->objectType && obj->objectPtr.setPtr->registered)
+        return obj->objectPtr.setPtr->hash;
+
+    return dbObjectHash(obj);
+}
+
+// Registered sets change in place, they are equal only to themselves.
+int dictObjectKeyCompare(void *privdata, const void *key1, const void *key2)
+{
+    const dbObject *a = (const dbObject *) key1, *b = (const dbObject *) key2;
+    DICT_NOTUSED(privdata);
+
+    if (objectSet == a->objectType && objectSet == b->objectType &&
+        a->objectPtr.setPtr->registered && b->objectPtr.setPtr->registered)
+    {
+        return a->objectPtr.setPtr == b->objectPtr.setPtr;
+    }
+
+    return 1 == dbObjectCompare(a, b);
+}
+
+// Rebuilds signatures made stale by removals and moves their slots in the LSH index, so similarity
+// search sees current members. Must be called with sets locked for reading, which keeps slot sets alive.
+// locked is a set the caller holds read lock of. Returns -1 on error.
+static int dbRefreshSignatures(const set *locked)
+{
+    valType *stale = NULL, count = 0, slot, i;
+    const set **staleSets = NULL;
+    minHash sig;
+    int result = 0;
+
+    lockRead(setSlots);
+    if (0 != staleSigs)
+    {
+        stale = (valType *) malloc(staleSigs * sizeof(valType));
+        staleSets = (const set **) malloc(staleSigs * sizeof(const set *));
+
+        for (slot = 0; NULL != stale && NULL != staleSets && slot < slotsLength && count < staleSigs; slot++)
+        {
+            if (NULL != slots[slot].name && slots[slot].staleSig)
+            {
+                stale[count] = slot;
+                staleSets[count++] = slots[slot].s;
+            }
+        }
+
+        if (NULL == stale || NULL == staleSets)
+            result = -1;
+    }
+    unlockRead(setSlots);
+
+    // Signature is built under the set read lock only, which also keeps it from changing
+    // until the new signature is stored.
+    for (i = 0; i < count && 0 == result; i++)
+    {
+        if (staleSets[i] != locked)
+            lockRead(staleSets[i]);
+
+        if (0 != minHashFromSet(&sig, staleSets[i]))
+        {
+            result = -1;
+        }
+        else
+        {
+            lockWrite(setSlots);
+            if (staleSets[i] == slots[stale[i]].s && slots[stale[i]].staleSig)
+            {
+                lshRemove(similarIndex, &slots[stale[i]].sig, stale[i]);
+                slots[stale[i]].sig = sig;
+                slots[stale[i]].staleSig = 0;
+                staleSigs--;
+
+                if (0 != lshInsert(similarIndex, &slots[stale[i]].sig, stale[i]))
+                    result = -1;
+            }
+            unlockWrite(setSlots);
+        }
+
+        if (staleSets[i] != locked)
+            unlockRead(staleSets[i]);
+    }
+
+    free(stale);
+    free((void *) staleSets);
+    return result;
+}
+
+// Returns set of slots holding a named set or NULL on error. Must be called with setSlots locked.
+static set *dbSlotsUsed(void)
+{
+    set *result = NULL;
+    valType slot;
+
+    if (NULL == (result = setCreate()))
+        return NULL;
+
+    for (slot = 0; slot < slotsLength; slot++)
+    {
+        if (NULL != slots[slot].name && -1 == setAdd(result, slot))
+        {
+            setDestroy(result);
+            return NULL;
+        }
+    }
+
+    return result;
+}
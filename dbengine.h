@@ -1,65 +1,139 @@
-// dbengine.h - Database engine.
-
-#ifndef __DBENGINE_H__
-#define __DBENGINE_H__
-
-#include "adlist.h"
-#include "sds.h"
-
-#include "athena.h"
-#include "set.h"
-#include "dbobject.h"
-
-// Returns: 0 on ok, -1 on error.
-int initDbEngine(void);
-
-void cleanupDbEngine(void);
-
-// Returns pointer to set or NULL.
-const set *dbGet(const sds setName);
-
-// Returns pointer to set name or NULL.
-const sds dbGetRandSet(void);
-
-// Returns -1 on error.
-int dbSet(const sds setName, const set *s);
-
-// Returns DICT_OK or DICT_ERR.
-int dbRemove(const sds setName);
-
-// Return -1 on error.
-int dbFlushAll(void);
-
-// Returns -1 on error.
-int dbRename(const sds oldSetName, const sds newSetName);
-
-// Returns pointer to new set or NULL.
-const set *dbCreate(const sds setName);
-
-// Returns NULL on error.
-const dbObject *dbGetObject(valType id, int lock);
-
-// Returns 0 on ok, -1 on error.
-int dbRegisterObject(dbObject **object, valType *id);
-
-// Returns 0 on ok, -1 on error.
-int dbUnregisterObject(valType id);
-
-// Returns 1 if object is found, 0 otherwise.
-int dbFindObject(const dbObject *object, valType *index, int lock);
-
-// Retuns 1 if set is found, 0 otherwise.
-int dbFindSet(const set *s, valType *index, int lock);
-
-// Retutns number of collected objects.
-valType dbGC(void);
-
-// Returns bytes freed.
-valType dbSetTrunc(void);
-
-void dbPrintIndex(FILE *f);
-void dbPrintSets(FILE *f);
-
-void dbPrintStatus(void *serverPtr);
-
-#endif /* __DBENGINE_H__ */
+// dbengine.h - Database engine.
+
+#ifndef __DBENGINE_H__
+#define __DBENGINE_H__
+
+#include "adlist.h"
+#include "sds.h"
+
+#include "athena.h"
+#include "set.h"
+#include "dbobject.h"
+#include "hll.h"
+
+// Named set with its similarity score.
+typedef struct dbMatch
+{
+    sds name;
+    double score;
+} dbMatch;
+
+// Summary of registered object, see dbIndexPage.
+typedef struct dbIndexEntry
+{
+    valType id;
+    dbObjectType type;
+    valType card;
+    valType bytes;
+} dbIndexEntry;
+
+#define DB_INDEX_PAGE_SCAN 65536    // Index slots looked at by one dbIndexPage call.
+
+// Returns: 0 on ok, -1 on error.
+int initDbEngine(void);
+
+void cleanupDbEngine(void);
+
+// Returns pointer to set or NULL.
+const set *dbGet(const sds setName);
+
+// Returns pointer to set name or NULL.
+const sds dbGetRandSet(void);
+
+// Returns -1 on error.
+int dbSet(const sds setName, const set *s);
+
+// Returns DICT_OK or DICT_ERR.
+int dbRemove(const sds setName);
+
+// Return -1 on error.
+int dbFlushAll(void);
+
+// Returns -1 on error.
+int dbRename(const sds oldSetName, const sds newSetName);
+
+// Returns pointer to new set or NULL.
+const set *dbCreate(const sds setName);
+
+// Update reverse membership index after id was added to or removed from named set.
+// Must be called while the set is locked for writing. Return -1 on error.
+int dbMemberAdded(const sds setName, valType id);
+int dbMemberRemoved(const sds setName, valType id);
+// Same for every id in ids, the index lock is taken once per batch.
+int dbMembersAdded(const sds setName, const set *ids);
+int dbMembersRemoved(const sds setName, const set *ids);
+
+// Returns list of names of sets containing object id or NULL on error. List owns the names.
+list *dbWhich(valType id);
+// Return lists of names of sets which are subsets or supersets of s (equal sets included)
+// or NULL on error. s is locked for reading inside. Lists own the names.
+list *dbSubsets(const set *s);
+list *dbSupersets(const set *s);
+
+// Writes at most k named sets sharing a MinHash band with s, or any named sets if SET_SIGNATURES is off,
+// to matches, ordered by descending exact Jaccard similarity. Names are copies owned by caller. Returns number of matches or -1 on error.
+int dbSimilar(const set *s, size_t k, dbMatch *matches);
+
+// Copies HyperLogLog sketch of named set to h. The bitmap is read only if removals made the sketch stale,
+// then the rebuilt sketch is kept, or every time if SET_SKETCHES is off. Returns -1 if there is no such set.
+int dbGetSketch(const sds setName, hll *h);
+
+// Returns set of members of s which are values from from to to inclusive, without interning the range.
+// Returns NULL on error.
+set *dbValRangeInter(const set *s, valType from, valType to);
+
+// Returns list of names of about count sets starting from *cursor and sets *cursor to resume from,
+// 0 when every set was returned. Names are copies owned by list. Returns NULL on error.
+list *dbScanSets(unsigned long *cursor, size_t count);
+// Writes at most count members of named set not less than *cursor to ids and sets *cursor to resume from,
+// 0 when the set is exhausted. Returns number of members written or -1 if there is no such set.
+int dbScanMembers(const sds setName, valType *cursor, valType *ids, size_t count);
+
+// Returns NULL on error.
+const dbObject *dbGetObject(valType id, int lock);
+// Resolves count ids under one index lock, objects[k] receives object of ids[k] or NULL.
+void dbGetObjects(const valType *ids, size_t count, const dbObject **objects, int lock);
+
+// Returns 0 on ok, -1 on error.
+int dbRegisterObject(dbObject **object, valType *id);
+
+// Registers count objects under one index lock, ids[k] receives id of objects[k]. Objects equal to
+// already registered ones are released and replaced like in dbRegisterObject.
+// Returns 0 on ok, -1 on error. On error objects which didn't get an id are released and set to NULL.
+int dbRegisterObjects(dbObject **objects, size_t count, valType *ids);
+
+// Interns count values under one index lock, ids[k] receives id of value object of vals[k].
+// Existing values are found through value index. Returns 0 on ok, -1 on error.
+int dbInternVals(const valType *vals, size_t count, valType *ids);
+
+// Returns 0 on ok, -1 on error.
+int dbUnregisterObject(valType id);
+
+// Returns members of s which are tuples having object id at position pos, pos must be below
+// TUPLE_INDEX_POSITIONS. Returns NULL on error.
+set *dbTupleIndexInter(const set *s, valType pos, valType id, int lock);
+
+// Returns 1 if object is found, 0 otherwise.
+int dbFindObject(const dbObject *object, valType *index, int lock);
+
+// Retuns 1 if set is found, 0 otherwise.
+int dbFindSet(const set *s, valType *index, int lock);
+
+// Retutns number of collected objects.
+valType dbGC(void);
+
+// Returns bytes freed.
+valType dbSetTrunc(void);
+
+// Writes summaries of at most count objects with ids from *cursor to to inclusive whose type
+// bit (1 << objectType) is set in types. Looks at no more than DB_INDEX_PAGE_SCAN slots under
+// the index read lock. Sets *cursor to id to resume from, 0 when the range is done.
+// Returns number of entries written.
+size_t dbIndexPage(valType *cursor, valType to, unsigned types, dbIndexEntry *entries, size_t count);
+// Returns number of registered objects.
+valType dbIndexCount(void);
+void dbPrintSets(FILE *f);
+
+void dbPrintStatus(void *serverPtr);
+
+#endif /* __DBENGINE_H__ */
@@ -1,122 +1,350 @@
-// dbobject.c - Database object management.
-
-#include <stdlib.h>
-#include <malloc.h>
-#include <ctype.h>
-
-#include "set.h"
-#include "setutils.h"
-#include "tuple.h"
-#include "dbengine.h"
-#include "dbobject.h"
-#include "eval.h"
-
-int dbObjectCompare(const dbObject *a, const dbObject *b)
-{
-    if (NULL == a || NULL == b)
-        return 0;
-
-    if (a == b)
-        return 1;
-
-    if (a->objectType != b->objectType)
-        return 0;
-
-    switch (a->objectType)
-    {
-        case objectSet:
-            return setCmpE(a->objectPtr.setPtr, b->objectPtr.setPtr);
-
-        case objectTuple:
-            return tupleCmp(a->objectPtr.tuplePtr, b->objectPtr.tuplePtr);
-
-        case objectVal:
-            return a->objectPtr.val == b->objectPtr.val;
-    }
-
-    return 0;
-}
-
-void dbObjectRelease(dbObject *obj)
-{
-    if (NULL == obj)
-        return;
-
-    switch (obj->objectType)
-    {
-        case objectSet:
-            setDestroy(obj->objectPtr.setPtr);
-            break;
-
-        case objectTuple:
-            listRelease(obj->objectPtr.tuplePtr);
-            break;
-
-        case objectVal:
-            break;
-    }
-}
-
-int dbObjectPrint(const dbObject *obj, FILE *f, int lock)
-{
-    if (NULL == obj || NULL == f)
-        return -1;
-
-    switch (obj->objectType)
-    {
-        case objectSet:
-            return setPrint(obj->objectPtr.setPtr, f, lock);
-
-        case objectTuple:
-            return tuplePrint(obj->objectPtr.tuplePtr, f, lock);
-
-        case objectVal:
-            return 0 > fprintf(f, "%u", obj->objectPtr.val);
-    }
-
-    return -1;
-}
-
-dbObject *valParse(const char *tokenPtr, valType *id)
-{
-    valType newVal = 0;
-    dbObject *newValObject = NULL;
-
-    if (1 != sscanf(tokenPtr, "%u", &newVal))
-        return NULL;
-
-    if (NULL == (newValObject = (dbObject *) calloc(1, sizeof(dbObject))))
-        return NULL;
-
-    newValObject->objectType = objectVal;
-    newValObject->objectPtr.val = newVal;
-
-    if (0 != dbRegisterObject(&newValObject, id))
-    {
-        free(newValObject);
-        return NULL;
-    }
-
-    return newValObject;
-}
-
-dbObject *dbObjectParse(const sds s, valType *id)
-{
-    dbObject *result = NULL;
-    size_t pos = 0;
-
-    if (NULL == s || 0 == strlen(s) || NULL == id)
-        return NULL;
-
-    while (isspace(s[pos]))
-        pos++;
-
-    if (NULL == (result = eval(s, &pos)))
-    {
-        return NULL;
-    }
-
-    *id = result->id;
-
-    return result;
-}
+// dbobject.c - Database object management.
+
+#include <stdlib.h>
+#include <malloc.h>
+#include <ctype.h>
+#include <string.h>
+
+#include "dict.h"
+
+#include "set.h"
+#include "setutils.h"
+#include "tuple.h"
+#include "powerset.h"
+#include "cartprod.h"
+#include "relation.h"
+#include "dbengine.h"
+#include "dbobject.h"
+#include "eval.h"
+#include "tokenizer.h"
+#include "reply.h"
+
+int dbObjectCompare(const dbObject *a, const dbObject *b)
+{
+    if (NULL == a || NULL == b)
+        return 0;
+
+    if (a == b)
+        return 1;
+
+    if (a->objectType != b->objectType)
+        return 0;
+
+    switch (a->objectType)
+    {
+        case objectSet:
+            return setCmpE(a->objectPtr.setPtr, b->objectPtr.setPtr);
+
+        case objectTuple:
+            return tupleCmp(a->objectPtr.tuplePtr, b->objectPtr.tuplePtr);
+
+        case objectVal:
+            return a->objectPtr.val == b->objectPtr.val;
+
+        case objectPowerSet:
+            return powerSetCmp(a->objectPtr.powerSetPtr, b->objectPtr.powerSetPtr);
+
+        case objectCartProd:
+            return cartProdCmp(a->objectPtr.cartProdPtr, b->objectPtr.cartProdPtr);
+
+        case objectRelation:
+            return relationCmp(a->objectPtr.relationPtr, b->objectPtr.relationPtr);
+    }
+
+    return 0;
+}
+
+unsigned int dbObjectHash(const dbObject *obj)
+{
+    unsigned int hash = 0;
+    listIter iter;
+    listNode *node = NULL;
+    setIterator setIter;
+
+    if (NULL == obj)
+        return 0;
+
+    switch (obj->objectType)
+    {
+        case objectSet:
+            // Xor of member hashes, so a set changed in place can update its hash member by member.
+            setIterSeek(&setIter, obj->objectPtr.setPtr, 0);
+            while (0 == setGetNext(&setIter))
+                hash ^= dbObjectMemberHash(setIter.val);
+
+            return hash;
+
+        case objectTuple:
+            listRewind(obj->objectPtr.tuplePtr, &iter);
+            while (NULL != (node = listNext(&iter)))
+                hash = hash * 31 + (unsigned int) (valType) listNodeValue(node);
+
+            return dictIntHashFunction(hash);
+
+        case objectVal:
+            return dictIntHashFunction((unsigned int) obj->objectPtr.val);
+    }
+
+    // Lazy sets are rare, equal ones are told apart by dbObjectCompare.
+    return obj->objectType;
+}
+
+unsigned int dbObjectMemberHash(valType id)
+{
+    return dictIntHashFunction((unsigned int) id);
+}
+
+void dbObjectRelease(dbObject *obj)
+{
+    if (NULL == obj)
+        return;
+
+    switch (obj->objectType)
+    {
+        case objectSet:
+            setDestroy(obj->objectPtr.setPtr);
+            break;
+
+        case objectTuple:
+            listRelease(obj->objectPtr.tuplePtr);
+            break;
+
+        case objectVal:
+            break;
+
+        case objectPowerSet:
+            powerSetDestroy(obj->objectPtr.powerSetPtr);
+            break;
+
+        case objectCartProd:
+            cartProdDestroy(obj->objectPtr.cartProdPtr);
+            break;
+
+        case objectRelation:
+            relationDestroy(obj->objectPtr.relationPtr);
+            break;
+    }
+}
+
+int dbObjectPrint(const dbObject *obj, reply *r, int lock)
+{
+    if (NULL == obj || NULL == r)
+        return -1;
+
+    return replyObject(r, obj, lock);
+}
+
+int dbObjectPrintShort(const dbObject *obj, reply *r, int lock)
+{
+    if (NULL == obj || NULL == r)
+        return -1;
+
+    if (objectPowerSet == obj->objectType)
+    {
+        replyWrite(r, "^", 1);
+        return setPrint(obj->objectPtr.powerSetPtr->base, r, lock);
+    }
+
+    if (objectCartProd == obj->objectType)
+    {
+        if (0 != setPrint(obj->objectPtr.cartProdPtr->a, r, lock))
+            return -1;
+
+        replyWrite(r, " @ ", 3);
+        return setPrint(obj->objectPtr.cartProdPtr->b, r, lock);
+    }
+
+    return dbObjectPrint(obj, r, lock);
+}
+
+void dbObjectSummarize(const dbObject *obj, valType *card, valType *bytes)
+{
+    const relation *r = NULL;
+    valType x;
+
+    *card = 0;
+    *bytes = sizeof(dbObject);
+
+    if (NULL == obj)
+        return;
+
+    switch (obj->objectType)
+    {
+        case objectSet:
+            *card = obj->objectPtr.setPtr->card;
+            *bytes += sizeof(set) + obj->objectPtr.setPtr->capacity;
+            break;
+
+        case objectTuple:
+            *card = listLength(obj->objectPtr.tuplePtr);
+            *bytes += sizeof(list) + *card * sizeof(listNode);
+            break;
+
+        case objectVal:
+            *card = obj->objectPtr.val;
+            break;
+
+        case objectPowerSet:
+            // Saturates when the power set is too big to count.
+            if (0 != powerSetCard(obj->objectPtr.powerSetPtr->base->card, card))
+                *card = (valType) -1;
+
+            *bytes += sizeof(powerSet) + sizeof(set) + obj->objectPtr.powerSetPtr->base->capacity;
+            break;
+
+        case objectCartProd:
+            if (0 != cartProdCard(obj->objectPtr.cartProdPtr->a->card, obj->objectPtr.cartProdPtr->b->card, card))
+                *card = (valType) -1;
+
+            *bytes += sizeof(cartProd) + 2 * sizeof(set) +
+                      obj->objectPtr.cartProdPtr->a->capacity + obj->objectPtr.cartProdPtr->b->capacity;
+            break;
+
+        case objectRelation:
+            r = obj->objectPtr.relationPtr;
+            *card = r->card;
+            *bytes += sizeof(relation) + r->rowsCount * sizeof(set *);
+
+            for (x = 0; x < r->rowsCount; x++)
+                if (NULL != r->rows[x])
+                    *bytes += sizeof(set) + r->rows[x]->capacity;
+            break;
+    }
+}
+
+const char *dbObjectTypeName(dbObjectType type)
+{
+    switch (type)
+    {
+        case objectSet: return "set";
+        case objectTuple: return "tuple";
+        case objectVal: return "val";
+        case objectPowerSet: return "powerset";
+        case objectCartProd: return "cartprod";
+        case objectRelation: return "relation";
+    }
+
+    return "unknown";
+}
+
+int dbObjectTypeParse(const char *name, size_t len, dbObjectType *type)
+{
+    int t;
+
+    for (t = objectSet; t <= objectRelation; t++)
+    {
+        const char *typeName = dbObjectTypeName((dbObjectType) t);
+
+        if (0 == strncmp(name, typeName, len) && '\0' == typeName[len])
+        {
+            *type = (dbObjectType) t;
+            return 0;
+        }
+    }
+
+    return -1;
+}
+
+set *dbObjectMaterialize(const dbObject *obj)
+{
+    if (NULL == obj)
+        return NULL;
+
+    switch (obj->objectType)
+    {
+        case objectPowerSet:
+            return powerSetMaterialize(obj->objectPtr.powerSetPtr);
+
+        case objectCartProd:
+            return cartProdMaterialize(obj->objectPtr.cartProdPtr);
+
+        case objectRelation:
+            return relationMaterialize(obj->objectPtr.relationPtr);
+    }
+
+    return NULL;
+}
+
+set *dbObjectFlatten(const dbObject *obj, int lock)
+{
+    if (NULL == obj)
+        return NULL;
+
+    switch (obj->objectType)
+    {
+        case objectSet:
+            return setFlatten(obj->objectPtr.setPtr, lock);
+
+        case objectTuple:
+            return tupleFlatten(obj->objectPtr.tuplePtr, lock);
+
+        case objectPowerSet:
+            return powerSetFlatten(obj->objectPtr.powerSetPtr, lock);
+
+        case objectCartProd:
+            return cartProdFlatten(obj->objectPtr.cartProdPtr, lock);
+
+        case objectRelation:
+            return relationFlatten(obj->objectPtr.relationPtr, lock);
+    }
+
+    return NULL;
+}
+
+dbObject *valParse(const char *tokenPtr, valType *id)
+{
+    const char *end = NULL;
+
+    if (NULL == tokenPtr)
+        return NULL;
+
+    while (isspace(*tokenPtr))
+        tokenPtr++;
+
+    for (end = tokenPtr; isdigit(*end); end++);
+
+    if (end == tokenPtr)
+        return NULL;
+
+    return valCreate(tokenToVal(tokenPtr, end - tokenPtr), id);
+}
+
+dbObject *valCreate(valType newVal, valType *id)
+{
+    dbObject *newValObject = NULL;
+
+    if (NULL == (newValObject = (dbObject *) calloc(1, sizeof(dbObject))))
+        return NULL;
+
+    newValObject->objectType = objectVal;
+    newValObject->objectPtr.val = newVal;
+
+    if (0 != dbRegisterObject(&newValObject, id))
+    {
+        free(newValObject);
+        return NULL;
+    }
+
+    return newValObject;
+}
+
+dbObject *dbObjectParse(const sds s, valType *id)
+{
+    dbObject *result = NULL;
+    size_t pos = 0;
+
+    if (NULL == s || 0 == sdslen(s) || NULL == id)
+        return NULL;
+
+    while (isspace(s[pos]))
+        pos++;
+
+    if (NULL == (result = eval(s, &pos)))
+    {
+        return NULL;
+    }
+
+    *id = result->id;
+
+    return result;
+}
@@ -1,49 +1,78 @@
-// dbobject.h - Database object management.
-
-#ifndef __DBOBJECT_H__
-#define __DBOBJECT_H__
-
-#include <stdio.h>
-
-#include "adlist.h"
-
-#include "athena.h"
-#include "set.h"
-
-// Database object description.
-typedef enum dbObjectType
-{
-    objectSet, objectTuple, objectVal
-} dbObjectType;
-
-typedef struct dbObject
-{
-    dbObjectType objectType;
-
-    union objectPtr
-    {
-        set *setPtr;
-        list *tuplePtr;
-        valType val;
-    } objectPtr;
-
-    valType id;
-} dbObject;
-
-// Returns 1 if a equals b, 0 otherwise, -1 on error.
-int dbObjectCompare(const dbObject *a, const dbObject *b);
-
-// Returns -1 on error.
-int dbObjectPrint(const dbObject *obj, FILE *f, int lock);
-
-void dbObjectRelease(dbObject *obj);
-
-// Parses integer value from string s and registers it in object index.
-// Returns NULL on error.
-dbObject *valParse(const char *tokenPtr, valType *id);
-
-// Parses db object value (tuple, set, value) from string s and registers it in object index.
-// Returns NULL on error.
-dbObject *dbObjectParse(const sds s, valType *id);
-
-#endif /* __DBOBJECT_H__ */
+// dbobject.h - Database object management.
+
+#ifndef __DBOBJECT_H__
+#define __DBOBJECT_H__
+
+#include <stdio.h>
+
+#include "adlist.h"
+
+#include "athena.h"
+#include "set.h"
+#include "reply.h"
+#include "powerset.h"
+#include "cartprod.h"
+#include "relation.h"
+
+// Database object description.
+typedef enum dbObjectType
+{
+    objectSet, objectTuple, objectVal, objectPowerSet, objectCartProd, objectRelation
+} dbObjectType;
+
+typedef struct dbObject
+{
+    dbObjectType objectType;
+
+    union objectPtr
+    {
+        set *setPtr;
+        list *tuplePtr;
+        valType val;
+        powerSet *powerSetPtr;
+        cartProd *cartProdPtr;
+        relation *relationPtr;
+    } objectPtr;
+
+    valType id;
+} dbObject;
+
+// Returns 1 if a equals b, 0 otherwise, -1 on error.
+int dbObjectCompare(const dbObject *a, const dbObject *b);
+// Returns hash of object consistent with dbObjectCompare.
+unsigned int dbObjectHash(const dbObject *obj);
+// Returns hash of set member id, a set hashes to the xor of its member hashes.
+unsigned int dbObjectMemberHash(valType id);
+
+// Returns -1 on error.
+int dbObjectPrint(const dbObject *obj, reply *r, int lock);
+// Same as dbObjectPrint, but lazy sets are printed as ^base or a @ b instead of every member. Returns -1 on error.
+int dbObjectPrintShort(const dbObject *obj, reply *r, int lock);
+// Sets *card to number of members (value itself for values) and *bytes to memory held by obj, without expanding it.
+void dbObjectSummarize(const dbObject *obj, valType *card, valType *bytes);
+
+// Returns name of object type.
+const char *dbObjectTypeName(dbObjectType type);
+// Parses object type from len bytes at name. Returns -1 if there is no such type.
+int dbObjectTypeParse(const char *name, size_t len, dbObjectType *type);
+
+// Builds members of lazy set object (power set, cartesian product or relation). Returns NULL on error.
+set *dbObjectMaterialize(const dbObject *obj);
+// Returns flattened set, tuple or lazy set object or NULL on error.
+set *dbObjectFlatten(const dbObject *obj, int lock);
+
+void dbObjectRelease(dbObject *obj);
+
+// Parses integer value from string s and registers it in object index.
+// Returns NULL on error.
+dbObject *valParse(const char *tokenPtr, valType *id);
+
+// Creates integer value object and registers it in object index.
+// Returns NULL on error.
+dbObject *valCreate(valType newVal, valType *id);
+
+// Parses db object value (tuple, set, value) from string s and registers it in object index.
+// Returns NULL on error.
+dbObject *dbObjectParse(const sds s, valType *id);
+
+#endif /* __DBOBJECT_H__ */
@@ -1,605 +1,2114 @@
-// eval.c - Set expression evaluation.
-
-#include <stdlib.h>
-#include <malloc.h>
-
-#include "dbengine.h"
-#include "syncengine.h"
-#include "setutils.h"
-#include "tokenizer.h"
-#include "eval.h"
-#include "stack.h"
-
-static int compareOperatorsPriority(tokenType a, tokenType b);
-static int operatorIsLeftAssoc(tokenType oper);
-static int tokenIsOperator(tokenType tt);
-static dbObject *performSetOperation(tokenType oper, set *a, set *b);
-static dbObject *executeTopOperator(stack *operands, stack *operators);
-
-dbObject *eval(const sds s, size_t *pos)
-{
-    dbObject *result = NULL;
-    stack *operands = NULL, *operators = NULL, *container = NULL;
-
-    if (NULL == s || 0 == strlen(s) || NULL == pos ||
-        *pos >= strlen(s))
-    {
-        return NULL;
-    }
-
-    if (NULL == (operands = stackCreate()))
-    {
-        return NULL;
-    }
-
-    if (NULL == (operators = stackCreate()))
-    {
-        stackDestroy(operands);
-        return NULL;
-    }
-
-    if (NULL == (container = stackCreate()))
-    {
-        stackDestroy(operands);
-        stackDestroy(operators);
-        return NULL;
-    }
-
-    while (1)
-    {
-        char *tokenPtr = NULL;
-        size_t tokenLen = 0;
-        tokenType tt = fetchToken(s, pos, &tokenPtr, &tokenLen);
-
-        if (tokenIdentifier == tt)
-        {
-            sds operandKey = sdsnewlen(tokenPtr, tokenLen);
-            const set *operand = NULL;
-            valType objId;
-
-            if (NULL == operandKey)
-            {
-                stackDestroy(operators);
-                stackDestroy(operands);
-                stackDestroy(container);
-                return NULL;
-            }
-
-            if (NULL == (operand = dbGet(operandKey)))
-            {
-                sdsfree(operandKey);
-                stackDestroy(operators);
-                stackDestroy(operands);
-                stackDestroy(container);
-                return NULL;
-            }
-
-            sdsfree(operandKey);
-
-            if (1 != dbFindSet(operand, &objId, 1))
-            {
-                stackDestroy(operators);
-                stackDestroy(operands);
-                stackDestroy(container);
-                return NULL;
-            }
-
-            if (0 != stackPush(operands, (void *) dbGetObject(objId, 1)))
-            {
-                stackDestroy(operators);
-                stackDestroy(operands);
-                stackDestroy(container);
-                return NULL;
-            }
-        }
-        else if (tokenVal == tt)
-        {
-            valType valObjectId;
-            dbObject *valObject = valParse(tokenPtr, &valObjectId);
-
-            if (NULL == valObject)
-            {
-                stackDestroy(operators);
-                stackDestroy(operands);
-                stackDestroy(container);
-                return NULL;
-            }
-
-            if (0 != stackPush(operands, valObject))
-            {
-                dbObjectRelease(valObject);
-                free(valObject);
-                stackDestroy(operators);
-                stackDestroy(operands);
-                stackDestroy(container);
-                return NULL;
-            }
-        }
-        else if (tokenSetStart == tt)
-        {
-            valType setOperandId = 0;
-            dbObject *setOperand = NULL;
-            if (NULL == (setOperand = (dbObject *) calloc(1, sizeof(dbObject))))
-            {
-                stackDestroy(operators);
-                stackDestroy(operands);
-                stackDestroy(container);
-                return NULL;
-            }
-
-            if (NULL == (setOperand->objectPtr.setPtr = setCreate()))
-            {
-                free(setOperand);
-                stackDestroy(operators);
-                stackDestroy(operands);
-                stackDestroy(container);
-                return NULL;
-            }
-
-            setOperand->objectType = objectSet;
-
-            if (0 != stackPush(operands, setOperand))
-            {
-                stackDestroy(operators);
-                dbUnregisterObject(setOperandId);
-                dbObjectRelease(setOperand);
-                stackDestroy(operands);
-                stackDestroy(container);
-                return NULL;
-            }
-
-            if (0 != stackPush(container, (void *) stackSize(operands)))
-            {
-                stackDestroy(operators);
-                dbUnregisterObject(setOperandId);
-                dbObjectRelease(setOperand);
-                stackDestroy(operands);
-                stackDestroy(container);
-                return NULL;
-            }
-        }
-        else if (tokenTupleStart == tt)
-        {
-            valType tupleOperandId = 0;
-            dbObject *tupleOperand = NULL;
-            if (NULL == (tupleOperand = (dbObject *) calloc(1, sizeof(dbObject))))
-            {
-                stackDestroy(operators);
-                stackDestroy(operands);
-                stackDestroy(container);
-                return NULL;
-            }
-
-            if (NULL == (tupleOperand->objectPtr.tuplePtr = listCreate()))
-            {
-                free(tupleOperand);
-                stackDestroy(operators);
-                stackDestroy(operands);
-                stackDestroy(container);
-                return NULL;
-            }
-
-            tupleOperand->objectType = objectTuple;
-
-            if (0 != stackPush(operands, tupleOperand))
-            {
-                stackDestroy(operators);
-                dbUnregisterObject(tupleOperandId);
-                dbObjectRelease(tupleOperand);
-                stackDestroy(operands);
-                stackDestroy(container);
-                return NULL;
-            }
-
-            if (0 != stackPush(container, (void *) stackSize(operands)))
-            {
-                stackDestroy(operators);
-                dbUnregisterObject(tupleOperandId);
-                dbObjectRelease(tupleOperand);
-                stackDestroy(operands);
-                stackDestroy(container);
-                return NULL;
-            }
-        }
-        else if (tokenDelim == tt)
-        {
-            valType topContainerPosition;
-            dbObject *top = NULL, *topContainer = NULL;
-
-            if (0 == stackSize(container))
-            {
-                stackDestroy(operators);
-                stackDestroy(operands);
-                stackDestroy(container);
-                return NULL;
-            }
-
-            stackPeek(container, (void **) &topContainerPosition);
-
-            stackLookup(operands, topContainerPosition, (void **) &topContainer);
-
-            while (stackSize(operands) - topContainerPosition > 1)
-            {
-                if (NULL == executeTopOperator(operands, operators))
-                {
-                    stackDestroy(container);
-                    return NULL;
-                }
-            }
-
-            if (stackSize(operands) - 1 != topContainerPosition || 0 == stackSize(operands))
-            {
-                stackDestroy(operators);
-                stackDestroy(operands);
-                stackDestroy(container);
-                return NULL;
-            }
-
-            stackPop(operands, (void **) &top);
-
-            switch (topContainer->objectType)
-            {
-                case objectSet:
-                    setAdd(topContainer->objectPtr.setPtr, top->id);
-                    break;
-
-                case objectTuple:
-                    listAddNodeTail(topContainer->objectPtr.tuplePtr, (void *) top->id);
-                    break;
-            }
-        }
-        else if (tokenTupleEnd == tt ||
-                 tokenSetEnd == tt)
-        {
-            valType topContainerPosition;
-            dbObject *top = NULL, *topContainer = NULL;
-
-            if (0 == stackSize(container))
-            {
-                stackDestroy(operators);
-                stackDestroy(operands);
-                stackDestroy(container);
-                return NULL;
-            }
-
-            stackPeek(container, (void **) &topContainerPosition);
-
-            if (stackSize(operands) == topContainerPosition)
-            {
-                stackPop(container, (void **) &topContainerPosition);
-                break;
-            }
-
-            stackLookup(operands, topContainerPosition, (void **) &topContainer);
-
-            if ((tokenTupleEnd == tt && objectTuple != topContainer->objectType) ||
-                (tokenSetEnd == tt && objectSet != topContainer->objectType))
-            {
-                stackDestroy(operators);
-                stackDestroy(operands);
-                stackDestroy(container);
-                return NULL;
-            }
-
-            while (stackSize(operands) - topContainerPosition > 1)
-            {
-                if (NULL == executeTopOperator(operands, operators))
-                {
-                    stackDestroy(container);
-                    return NULL;
-                }
-            }
-
-            if (stackSize(operands) - 1 != topContainerPosition || 0 == stackSize(operands))
-            {
-                stackDestroy(operators);
-                stackDestroy(operands);
-                stackDestroy(container);
-                return NULL;
-            }
-
-            stackPop(operands, (void **) &top);
-
-            switch (topContainer->objectType)
-            {
-                case objectSet:
-                    setAdd(topContainer->objectPtr.setPtr, top->id);
-                    break;
-
-                case objectTuple:
-                    listAddNodeTail(topContainer->objectPtr.tuplePtr, (void *) top->id);
-                    break;
-            }
-
-            stackPop(container, (void **) &topContainerPosition);
-
-            {
-                valType topContainerId;
-                if (0 != dbRegisterObject(&topContainer, &topContainerId))
-                {
-                    dbObjectRelease(topContainer);
-                    stackDestroy(operators);
-                    stackDestroy(operands);
-                    stackDestroy(container);
-                    return NULL;
-                }
-
-                stackReplaceTop(operands, topContainer);
-            }
-        }
-        else if (tokenIsOperator(tt))
-        {
-            while (0 != stackSize(operators))
-            {
-                tokenType topOperator;
-
-                if (0 != stackPeek(operators, (void **) &topOperator))
-                {
-                    stackDestroy(operators);
-                    stackDestroy(operands);
-                    stackDestroy(container);
-                    return NULL;
-                }
-
-                if (!((operatorIsLeftAssoc(tt) && (-1 == compareOperatorsPriority(tt, topOperator) ||
-                                                  0 == compareOperatorsPriority(tt, topOperator))) ||
-                      (!operatorIsLeftAssoc(tt) && -1 == compareOperatorsPriority(tt, topOperator))))
-                {
-                    break;
-                }
-
-                // Perform operation.
-                if (NULL == executeTopOperator(operands, operators))
-                {
-                    stackDestroy(container);
-                    return NULL;
-                }
-            }
-
-            if (0 != stackPush(operators, (void *) tt))
-            {
-                stackDestroy(operators);
-                stackDestroy(operands);
-                stackDestroy(container);
-                return NULL;
-            }
-        }
-        else if (tokenLeftBrace == tt)
-        {
-            dbObject *subResult = eval(s, pos);
-            if (NULL == subResult)
-            {
-                stackDestroy(operators);
-                stackDestroy(operands);
-                stackDestroy(container);
-                return NULL;
-            }
-
-            if (0 != stackPush(operands, subResult))
-            {
-                stackDestroy(operators);
-                stackDestroy(operands);
-                stackDestroy(container);
-                return NULL;
-            }
-        }
-        else if (tokenRightBrace == tt ||
-                 tokenEnd == tt)
-        {
-            break;
-        }
-        else
-        {
-            stackDestroy(operators);
-            stackDestroy(operands);
-            stackDestroy(container);
-            return NULL;
-        }
-    }
-
-    // Unwind stacks.
-    while (0 != stackSize(operators))
-    {
-        // Perform operation.
-        if (NULL == executeTopOperator(operands, operators))
-        {
-            stackDestroy(container);
-            return NULL;
-        }
-    }
-
-    if (1 != stackSize(operands))
-    {
-        stackDestroy(operators);
-        stackDestroy(operands);
-        stackDestroy(container);
-        return NULL;
-    }
-
-    stackPop(operands, (void **) &result);
-
-    stackDestroy(operators);
-    stackDestroy(operands);
-    stackDestroy(container);
-    return result;
-}
-
-static dbObject *executeTopOperator(stack *operands, stack *operators)
-{
-    tokenType topOperator;
-    dbObject *op1 = NULL, *op2 = NULL, *subResult = NULL;
-
-    if (0 != stackPop(operators, (void **) &topOperator))
-    {
-        stackDestroy(operators);
-        stackDestroy(operands);
-        return NULL;
-    }
-
-    if (0 != stackPop(operands, (void **) &op1))
-    {
-        stackDestroy(operators);
-        stackDestroy(operands);
-        return NULL;
-    }
-
-    if (operatorIsLeftAssoc(topOperator))
-        stackPop(operands, (void **) &op2);
-
-    if (NULL == op2)
-    {
-        op2 = op1;
-        op1 = NULL;
-    }
-
-    if ((NULL != op1 && objectSet != op1->objectType) ||
-        (NULL != op2 && objectSet != op2->objectType))
-    {
-        stackDestroy(operators);
-        stackDestroy(operands);
-        return NULL;
-    }
-
-    if (NULL == (subResult = performSetOperation(topOperator, op2->objectPtr.setPtr, op1 ? op1->objectPtr.setPtr : NULL)))
-    {
-        stackDestroy(operators);
-        stackDestroy(operands);
-        return NULL;
-    }
-
-    if (0 != stackPush(operands, (void *) subResult))
-    {
-        dbUnregisterObject(subResult->id);
-        free(subResult);
-        stackDestroy(operators);
-        stackDestroy(operands);
-        return NULL;
-    }
-
-    return subResult;
-}
-
-// Returns NULL on error.
-static dbObject *performSetOperation(tokenType oper, set *a, set *b)
-{
-    set *result = NULL;
-    dbObject *resultObject = NULL;
-    valType resultObjectId;
-
-    if (NULL != a)
-        lockRead(a);
-
-    if (NULL != b)
-        lockRead(b);
-
-    switch (oper)
-    {
-        case tokenBoolean:
-            result = setBoolean(a);
-            break;
-
-        case tokenMultiply:
-            result = setInter(a, b);
-            break;
-
-        case tokenCartProd:
-            result = setCartProd(a, b);
-            break;
-
-        case tokenPlus:
-            result = setUnion(a, b);
-            break;
-
-        case tokenMinus:
-            result = setDiff(a, b);
-            break;
-
-        case tokenSymDiff:
-            result = setSymDiff(a, b);
-            break;
-    }
-
-    if (NULL != a)
-        unlockRead(a);
-
-    if (NULL != b)
-        unlockRead(b);
-
-    if (NULL == (resultObject = (dbObject *) calloc(1, sizeof(dbObject))))
-    {
-        setDestroy(result);
-        return NULL;
-    }
-
-    resultObject->objectType = objectSet;
-    resultObject->objectPtr.setPtr = result;
-
-    if (0 != dbRegisterObject(&resultObject, &resultObjectId))
-    {
-        setDestroy(result);
-        free(resultObject);
-        return NULL;
-    }
-
-    return resultObject;
-}
-
-// If token isn't an operator then the result is unpredictable.
-// Returns: 1 - a > b, 0 - a = b, -1 - a < b.
-static int compareOperatorsPriority(tokenType a, tokenType b)
-{
-    // Priority: ^ @ *, + - ~
-    switch (a)
-    {
-        case tokenBoolean:
-        case tokenMultiply:
-        case tokenCartProd:
-            if (tokenMultiply == b || tokenCartProd == b || tokenBoolean == b)
-            {
-                return 0;
-            }
-
-            return 1;
-
-        case tokenPlus:
-        case tokenMinus:
-        case tokenSymDiff:
-            if (tokenCartProd == b || tokenMultiply == b || tokenBoolean == b)
-            {
-                return -1;
-            }
-
-            return 0;
-    }
-
-    return 0;
-}
-
-static int tokenIsOperator(tokenType tt)
-{
-    return tokenBoolean == tt ||
-           tokenMultiply == tt ||
-           tokenCartProd == tt ||
-           tokenPlus == tt ||
-           tokenMinus == tt ||
-           tokenSymDiff == tt;
-}
-
-// Return -1 on error.
-static int operatorIsLeftAssoc(tokenType oper)
-{
-    switch (oper)
-    {
-        case tokenMultiply:
-        case tokenCartProd:
-        case tokenPlus:
-        case tokenMinus:
-        case tokenSymDiff:
-            return 1;
-
-        case tokenBoolean:
-            return 0;
-    }
-
-    return -1;
-}
+// eval.c - Set expression evaluation.
+
+#include <stdlib.h>
+#include <malloc.h>
+
+#include "dbengine.h"
+#include "syncengine.h"
+#include "setutils.h"
+#include "tokenizer.h"
+#include "eval.h"
+#include "plan.h"
+#include "optimizer.h"
+#include "powerset.h"
+#include "cartprod.h"
+#include "relation.h"
+#include "tuple.h"
+#include "stack.h"
+#include "hll.h"
+
+// Per-query execution state.
+typedef struct execContext
+{
+    set **memo; // Results of common subexpressions, indexed by exprNode::cseId.
+} execContext;
+
+// Operand arrays up to this size live on the stack in count and predicate mode.
+#define EVAL_INLINE_OPERANDS 16
+// Approximate intersections of up to this many operands use inclusion-exclusion over sketches.
+#define EVAL_APPROX_INTER_TERMS 4
+// Range literal values are interned this many at a time.
+#define EVAL_RANGE_BATCH 4096
+
+static plan *acquirePlan(const sds s, size_t pos);
+static int execContextInit(execContext *ctx, const plan *p);
+static void execContextFree(execContext *ctx, const plan *p);
+static int countNode(const exprNode *node, execContext *ctx, valType *card);
+static int collectOperands(const exprNode *node, int flattenInter, execContext *ctx,
+                           set **operands, int *owned, size_t *count, size_t capacity);
+static int approxNode(const exprNode *node, execContext *ctx, double *card, double *error);
+static int sketchNode(const exprNode *node, execContext *ctx, hll *h);
+static int compareOperatorsPriority(tokenType a, tokenType b);
+static int operatorIsLeftAssoc(tokenType oper);
+static int tokenIsOperator(tokenType tt);
+static int operatorIsLowPriority(tokenType oper);
+static int operatorIsRelation(tokenType oper);
+static exprNode *compileExpr(const sds s, size_t *pos, tokenType *terminator);
+static exprNode *compileContainer(const sds s, size_t *pos, tokenType startToken);
+static exprNode *compileRange(const sds s, size_t *pos, int *isRange);
+static int compileApplyOperator(stack *operands, stack *operators);
+static exprNode *compileAbort(stack *operands, stack *operators);
+static dbObject *execNode(const exprNode *node, execContext *ctx);
+static dbObject *execSetRef(const exprNode *node);
+static dbObject *execContainer(const exprNode *node, execContext *ctx);
+static dbObject *execRange(const exprNode *node);
+static dbObject *execOperator(const exprNode *node, execContext *ctx);
+static set *execSet(const exprNode *node, execContext *ctx, int *owned);
+static set *execChain(const exprNode *node, execContext *ctx);
+static set *execInter(const exprNode *node, execContext *ctx);
+static set *execInterWith(const exprNode *node, const set *acc, execContext *ctx);
+static set *execLazyInter(const exprNode *node, const set *acc, execContext *ctx);
+static dbObject *execLazySet(const exprNode *node, execContext *ctx);
+static int isLazySet(const exprNode *node);
+static int isRangeLiteral(const exprNode *node);
+static int hasRangeChild(const exprNode *node);
+static int isRelationOperator(const exprNode *node);
+static relation *execRelation(const exprNode *node, execContext *ctx);
+static set *execRelationSet(const exprNode *node, execContext *ctx);
+static set *execTupleOperator(const exprNode *node, execContext *ctx);
+static set *execSelect(const exprNode *node, execContext *ctx);
+static set *performSetOperation(tokenType oper, const set *a, const set *b);
+static dbObject *registerSet(set *s);
+static void releaseSet(set *s, int owned);
+static void lockSets(const set **sets, size_t count);
+static void unlockSets(const set **sets, size_t count);
+
+dbObject *eval(const sds s, size_t *pos)
+{
+    dbObject *result = NULL;
+    plan *p = NULL;
+    execContext ctx;
+
+    if (NULL == s || 0 == sdslen(s) || NULL == pos ||
+        *pos >= sdslen(s))
+    {
+        return NULL;
+    }
+
+    if (NULL == (p = acquirePlan(s, *pos)))
+    {
+        return NULL;
+    }
+
+    if (0 != execContextInit(&ctx, p))
+    {
+        planRelease(p);
+        return NULL;
+    }
+
+    result = execNode(p->root, &ctx);
+
+    execContextFree(&ctx, p);
+    planRelease(p);
+
+    if (NULL != result)
+        *pos = sdslen(s);
+
+    return result;
+}
+
+int evalCard(const sds s, valType *card)
+{
+    plan *p = NULL;
+    execContext ctx;
+    int result = 0;
+
+    if (NULL == s || 0 == sdslen(s) || NULL == card)
+        return -1;
+
+    if (NULL == (p = acquirePlan(s, 0)))
+        return -1;
+
+    if (0 != execContextInit(&ctx, p))
+    {
+        planRelease(p);
+        return -1;
+    }
+
+    result = countNode(p->root, &ctx, card);
+
+    execContextFree(&ctx, p);
+    planRelease(p);
+    return result;
+}
+
+set *evalSet(const sds s, int *owned)
+{
+    plan *p = NULL;
+    execContext ctx;
+    set *result = NULL;
+
+    if (NULL == s || 0 == sdslen(s) || NULL == owned)
+        return NULL;
+
+    if (NULL == (p = acquirePlan(s, 0)))
+        return NULL;
+
+    if (0 != execContextInit(&ctx, p))
+    {
+        planRelease(p);
+        return NULL;
+    }
+
+    result = execSet(p->root, &ctx, owned);
+
+    execContextFree(&ctx, p);
+    planRelease(p);
+    return result;
+}
+
+valType *evalList(const sds s, size_t *count)
+{
+    execContext ctx;
+    sds text = NULL;
+    exprNode *root = NULL;
+    tokenType terminator = tokenError;
+    dbObject *element = NULL;
+    valType *ids = NULL, *vals = NULL, *valIds = NULL;
+    size_t i, pos = 0, valCount = 0;
+    int failed = 0;
+
+    if (NULL == s || 0 == sdslen(s) || NULL == count)
+        return NULL;
+
+    // The list is compiled as one tuple literal, so it is parsed in one pass and keeps member order.
+    // Member lists rarely repeat, so they bypass the optimizer and the plan cache.
+    if (NULL == (text = sdsnewlen("[", 1)) ||
+        NULL == (text = sdscatlen(text, s, sdslen(s))) ||
+        NULL == (text = sdscatlen(text, "]", 1)))
+    {
+        return NULL;
+    }
+
+    root = compileExpr(text, &pos, &terminator);
+    sdsfree(text);
+
+    if (NULL == root || tokenEnd != terminator ||
+        exprTupleLiteral != root->nodeType || 0 == root->childrenCount)
+    {
+        exprNodeDestroy(root);
+        return NULL;
+    }
+
+    ctx.memo = NULL;
+
+    ids = (valType *) calloc(root->childrenCount, sizeof(valType));
+    valIds = (valType *) calloc(root->childrenCount, sizeof(valType));
+    vals = (valType *) calloc(root->childrenCount, sizeof(valType));
+
+    failed = NULL == ids || NULL == valIds || NULL == vals;
+
+    // Plain values are registered together under one index lock, other members one by one.
+    for (i = 0; !failed && i < root->childrenCount; i++)
+    {
+        if (exprVal == root->children[i]->nodeType)
+        {
+            vals[valCount++] = root->children[i]->val;
+        }
+        else if (NULL != (element = execNode(root->children[i], &ctx)))
+        {
+            ids[i] = element->id;
+        }
+        else
+        {
+            failed = 1;
+        }
+    }
+
+    if (!failed && 0 != dbInternVals(vals, valCount, valIds))
+        failed = 1;
+
+    for (i = 0, valCount = 0; !failed && i < root->childrenCount; i++)
+        if (exprVal == root->children[i]->nodeType)
+            ids[i] = valIds[valCount++];
+
+    if (!failed)
+        *count = root->childrenCount;
+
+    exprNodeDestroy(root);
+    free(vals);
+    free(valIds);
+
+    if (failed)
+    {
+        free(ids);
+        return NULL;
+    }
+
+    return ids;
+}
+
+int evalApproxCard(const sds s, double *card, double *error)
+{
+    plan *p = NULL;
+    execContext ctx;
+    int result = 0;
+
+    if (NULL == s || 0 == sdslen(s) || NULL == card || NULL == error)
+        return -1;
+
+    if (NULL == (p = acquirePlan(s, 0)))
+        return -1;
+
+    if (0 != execContextInit(&ctx, p))
+    {
+        planRelease(p);
+        return -1;
+    }
+
+    result = approxNode(p->root, &ctx, card, error);
+
+    execContextFree(&ctx, p);
+    planRelease(p);
+    return result;
+}
+
+int evalTest(evalPredicate predicate, const sds a, const sds b)
+{
+    plan *planA = NULL, *planB = NULL;
+    execContext ctxA, ctxB;
+    set *inlineOperands[EVAL_INLINE_OPERANDS];
+    int inlineOwned[EVAL_INLINE_OPERANDS];
+    set **operands = inlineOperands;
+    int *owned = inlineOwned, result = -1, flatten = predicateIntersects == predicate;
+    size_t i, count = 0, capacity = EVAL_INLINE_OPERANDS;
+
+    if (NULL == a || 0 == sdslen(a) || NULL == b || 0 == sdslen(b))
+        return -1;
+
+    if (NULL == (planA = acquirePlan(a, 0)))
+        return -1;
+
+    if (NULL == (planB = acquirePlan(b, 0)))
+    {
+        planRelease(planA);
+        return -1;
+    }
+
+    if (0 != execContextInit(&ctxA, planA))
+    {
+        planRelease(planA);
+        planRelease(planB);
+        return -1;
+    }
+
+    if (0 != execContextInit(&ctxB, planB))
+    {
+        execContextFree(&ctxA, planA);
+        planRelease(planA);
+        planRelease(planB);
+        return -1;
+    }
+
+    // Intersection operands are tested together, so A * B intersects C is decided in one pass.
+    if (flatten)
+        capacity = __max(capacity, (exprOperator == planA->root->nodeType ? planA->root->childrenCount : 1) +
+                                   (exprOperator == planB->root->nodeType ? planB->root->childrenCount : 1));
+
+    if (capacity > EVAL_INLINE_OPERANDS)
+    {
+        operands = (set **) calloc(capacity, sizeof(set *));
+        owned = (int *) calloc(capacity, sizeof(int));
+    }
+
+    if (NULL != operands && NULL != owned &&
+        0 == collectOperands(planA->root, flatten, &ctxA, operands, owned, &count, capacity) &&
+        0 == collectOperands(planB->root, flatten, &ctxB, operands, owned, &count, capacity))
+    {
+        lockSets((const set **) operands, count);
+
+        switch (predicate)
+        {
+            case predicateEq:
+                result = setCmpE(operands[0], operands[1]);
+                break;
+
+            case predicateSubset:
+                result = setCmpSubset(operands[0], operands[1]);
+                break;
+
+            case predicateSubsetOrEq:
+                result = setCmpSubsetOrEq(operands[0], operands[1]);
+                break;
+
+            case predicateIntersects:
+                result = setIntersectsN((const set **) operands, count);
+                break;
+        }
+
+        unlockSets((const set **) operands, count);
+    }
+
+    for (i = 0; i < count; i++)
+        releaseSet(operands[i], owned[i]);
+
+    if (inlineOperands != operands)
+    {
+        free(operands);
+        free(owned);
+    }
+
+    execContextFree(&ctxA, planA);
+    execContextFree(&ctxB, planB);
+    planRelease(planA);
+    planRelease(planB);
+    return result;
+}
+
+// Returns compiled plan of expression s starting at pos with a reference taken or NULL on error.
+// Compiles only on cache miss, repeated queries go straight to execution.
+static plan *acquirePlan(const sds s, size_t pos)
+{
+    plan *p = NULL;
+    sds key = NULL;
+
+    if (NULL == (key = planNormalize(s + pos, sdslen(s) - pos)))
+    {
+        return NULL;
+    }
+
+    if (NULL == (p = planCacheGet(key)))
+    {
+        size_t keyPos = 0, cseCount = 0;
+        tokenType terminator = tokenError;
+        exprNode *root = compileExpr(key, &keyPos, &terminator);
+
+        if (NULL == root || tokenEnd != terminator)
+        {
+            exprNodeDestroy(root);
+            sdsfree(key);
+            return NULL;
+        }
+
+        if (NULL == (root = optimizeExpr(root, &cseCount)))
+        {
+            sdsfree(key);
+            return NULL;
+        }
+
+        if (NULL == (p = planCacheAdd(key, root, cseCount)))
+        {
+            exprNodeDestroy(root);
+            sdsfree(key);
+            return NULL;
+        }
+    }
+
+    sdsfree(key);
+    return p;
+}
+
+// Returns -1 on error.
+static int execContextInit(execContext *ctx, const plan *p)
+{
+    ctx->memo = NULL;
+
+    if (0 != p->cseCount &&
+        NULL == (ctx->memo = (set **) calloc(p->cseCount + 1, sizeof(set *))))
+    {
+        return -1;
+    }
+
+    return 0;
+}
+
+static void execContextFree(execContext *ctx, const plan *p)
+{
+    size_t i;
+
+    if (NULL == ctx->memo)
+        return;
+
+    for (i = 0; i <= p->cseCount; i++)
+        setDestroy(ctx->memo[i]);
+
+    free(ctx->memo);
+    ctx->memo = NULL;
+}
+
+// Counts members of node result. Top level intersections, unions, differences and symmetric
+// differences are counted word by word over their operands without building the result.
+// Returns -1 on error.
+static int countNode(const exprNode *node, execContext *ctx, valType *card)
+{
+    set *inlineOperands[EVAL_INLINE_OPERANDS];
+    int inlineOwned[EVAL_INLINE_OPERANDS];
+    set **operands = inlineOperands, *result = NULL;
+    int *owned = inlineOwned, resultOwned = 0, failed = 0;
+    size_t i, count = 0;
+
+    if (isLazySet(node) && operatorIsRelation(node->oper))
+    {
+        relation *r = NULL;
+
+        if (NULL == (r = execRelation(node, ctx)))
+            return -1;
+
+        *card = r->card;
+        relationDestroy(r);
+        return 0;
+    }
+
+    // Power set and cartesian product cardinality follows from their operands.
+    if (isLazySet(node))
+    {
+        valType operandCards[2] = { 0, 0 };
+
+        for (count = 0; count < node->childrenCount; count++)
+        {
+            if (NULL == (result = execSet(node->children[count], ctx, &resultOwned)))
+                return -1;
+
+            lockRead(result);
+            operandCards[count] = result->card;
+            unlockRead(result);
+
+            releaseSet(result, resultOwned);
+        }
+
+        if (tokenBoolean == node->oper)
+            return powerSetCard(operandCards[0], card);
+
+        return cartProdCard(operandCards[0], operandCards[1], card);
+    }
+
+    // Intersections with ranges are counted on the filtered result instead of materializing the range.
+    if (!(exprOperator == node->nodeType &&
+          (tokenMultiply == node->oper || tokenPlus == node->oper ||
+           tokenMinus == node->oper || tokenSymDiff == node->oper)) ||
+        (tokenMultiply == node->oper && hasRangeChild(node)))
+    {
+        if (NULL == (result = execSet(node, ctx, &resultOwned)))
+            return -1;
+
+        lockRead(result);
+        *card = result->card;
+        unlockRead(result);
+
+        releaseSet(result, resultOwned);
+        return 0;
+    }
+
+    if (node->childrenCount > EVAL_INLINE_OPERANDS)
+    {
+        operands = (set **) calloc(node->childrenCount, sizeof(set *));
+        owned = (int *) calloc(node->childrenCount, sizeof(int));
+
+        if (NULL == operands || NULL == owned)
+        {
+            free(operands);
+            free(owned);
+            return -1;
+        }
+    }
+
+    for (count = 0; count < node->childrenCount; count++)
+    {
+        if (NULL == (operands[count] = execSet(node->children[count], ctx, &owned[count])))
+        {
+            failed = 1;
+            break;
+        }
+    }
+
+    if (!failed)
+    {
+        lockSets((const set **) operands, count);
+
+        switch (node->oper)
+        {
+            case tokenMultiply:
+                *card = setInterCardN((const set **) operands, count);
+                break;
+
+            case tokenPlus:
+                *card = setUnionCardN((const set **) operands, count);
+                break;
+
+            case tokenMinus:
+                *card = setDiffCardN((const set **) operands, count);
+                break;
+
+            case tokenSymDiff:
+                *card = 2 == count ? setSymDiffCard(operands[0], operands[1]) : 0;
+                break;
+        }
+
+        unlockSets((const set **) operands, count);
+    }
+
+    for (i = 0; i < count; i++)
+        releaseSet(operands[i], owned[i]);
+
+    if (inlineOperands != operands)
+    {
+        free(operands);
+        free(owned);
+    }
+
+    return failed ? -1 : 0;
+}
+
+// Appends sets node evaluates to operands. If flattenInter is set, children of intersection
+// are appended instead of the intersection itself. Returns -1 on error.
+static int collectOperands(const exprNode *node, int flattenInter, execContext *ctx,
+                           set **operands, int *owned, size_t *count, size_t capacity)
+{
+    size_t i;
+
+    if (flattenInter && exprOperator == node->nodeType && tokenMultiply == node->oper)
+    {
+        for (i = 0; i < node->childrenCount; i++)
+            if (0 != collectOperands(node->children[i], 0, ctx, operands, owned, count, capacity))
+                return -1;
+
+        return 0;
+    }
+
+    if (*count >= capacity ||
+        NULL == (operands[*count] = execSet(node, ctx, &owned[*count])))
+    {
+        return -1;
+    }
+
+    (*count)++;
+    return 0;
+}
+
+// Estimates cardinality of node result. Unions are estimated from merged sketches, small intersections
+// and differences by inclusion-exclusion over union estimates, anything else is counted exactly.
+// Sets *error to estimate's standard error. Returns -1 on error.
+static int approxNode(const exprNode *node, execContext *ctx, double *card, double *error)
+{
+    hll *sketches = NULL, acc;
+    size_t i, mask, terms, bits;
+    double c, bound;
+    valType exact;
+
+    *card = 0;
+    *error = 0;
+
+    if (exprOperator != node->nodeType || tokenPlus == node->oper)
+    {
+        if (exprSetRef != node->nodeType && exprSetLiteral != node->nodeType &&
+            exprOperator != node->nodeType)
+        {
+            return -1;
+        }
+
+        if (0 != sketchNode(node, ctx, &acc))
+            return -1;
+
+        *card = hllCount(&acc);
+        *error = *card * HLL_STD_ERROR;
+        return 0;
+    }
+
+    if (!((tokenMultiply == node->oper && node->childrenCount <= EVAL_APPROX_INTER_TERMS) ||
+          tokenMinus == node->oper))
+    {
+        if (0 != countNode(node, ctx, &exact))
+            return -1;
+
+        *card = (double) exact;
+        return 0;
+    }
+
+    if (NULL == (sketches = (hll *) calloc(node->childrenCount, sizeof(hll))))
+        return -1;
+
+    for (i = 0; i < node->childrenCount; i++)
+    {
+        if (0 != sketchNode(node->children[i], ctx, &sketches[i]))
+        {
+            free(sketches);
+            return -1;
+        }
+    }
+
+    // Result can't be larger than its first operand.
+    bound = hllCount(&sketches[0]);
+
+    if (tokenMinus == node->oper)
+    {
+        // |A - B - C| = |A + B + C| - |B + C|.
+        hllInit(&acc);
+        for (i = 1; i < node->childrenCount; i++)
+            hllMerge(&acc, &sketches[i]);
+
+        c = hllCount(&acc);
+        *card -= c;
+        *error += c * HLL_STD_ERROR;
+
+        hllMerge(&acc, &sketches[0]);
+        c = hllCount(&acc);
+        *card += c;
+        *error += c * HLL_STD_ERROR;
+    }
+    else
+    {
+        // |A * B| = |A| + |B| - |A + B|, generalized to every subset of operands.
+        terms = (size_t) 1 << node->childrenCount;
+        for (mask = 1; mask < terms; mask++)
+        {
+            hllInit(&acc);
+            for (i = 0, bits = 0; i < node->childrenCount; i++)
+            {
+                if (mask & ((size_t) 1 << i))
+                {
+                    hllMerge(&acc, &sketches[i]);
+                    bits++;
+                }
+            }
+
+            c = hllCount(&acc);
+            *card += bits & 1 ? c : -c;
+            *error += c * HLL_STD_ERROR;
+
+            if (1 == bits)
+                bound = __min(bound, c);
+        }
+    }
+
+    free(sketches);
+
+    *card = __max(0, __min(*card, bound));
+    return 0;
+}
+
+// Builds sketch of node result into h. Named sets and their unions use maintained sketches,
+// other operands are evaluated. Returns -1 on error.
+static int sketchNode(const exprNode *node, execContext *ctx, hll *h)
+{
+    hll child;
+    set *s = NULL;
+    int owned = 0, result;
+    size_t i;
+
+    if (exprSetRef == node->nodeType)
+        return dbGetSketch(node->name, h);
+
+    if (exprOperator == node->nodeType && tokenPlus == node->oper)
+    {
+        hllInit(h);
+
+        for (i = 0; i < node->childrenCount; i++)
+        {
+            if (0 != sketchNode(node->children[i], ctx, &child))
+                return -1;
+
+            hllMerge(h, &child);
+        }
+
+        return 0;
+    }
+
+    if (NULL == (s = execSet(node, ctx, &owned)))
+        return -1;
+
+    lockRead(s);
+    result = hllFromSet(h, s);
+    unlockRead(s);
+
+    releaseSet(s, owned);
+    return result;
+}
+
+// Compiles range literal "from..to}" following '{' at *pos. If s doesn't continue with a range,
+// sets *isRange to 0 and leaves *pos. Returns NULL if there is no range or on error.
+static exprNode *compileRange(const sds s, size_t *pos, int *isRange)
+{
+    exprNode *range = NULL, *bound = NULL;
+    char *fromPtr = NULL, *toPtr = NULL, *tokenPtr = NULL;
+    size_t fromLen = 0, toLen = 0, tokenLen = 0, peekPos = *pos, k;
+
+    *isRange = 0;
+
+    if (tokenVal != fetchToken(s, &peekPos, &fromPtr, &fromLen) ||
+        tokenDots != fetchToken(s, &peekPos, &tokenPtr, &tokenLen) ||
+        tokenVal != fetchToken(s, &peekPos, &toPtr, &toLen) ||
+        tokenSetEnd != fetchToken(s, &peekPos, &tokenPtr, &tokenLen))
+    {
+        return NULL;
+    }
+
+    *isRange = 1;
+    *pos = peekPos;
+
+    if (NULL == (range = exprNodeCreate(exprRangeLiteral)))
+        return NULL;
+
+    for (k = 0; k < 2; k++)
+    {
+        if (NULL == (bound = exprNodeCreate(exprVal)))
+        {
+            exprNodeDestroy(range);
+            return NULL;
+        }
+
+        bound->val = 0 == k ? tokenToVal(fromPtr, fromLen) : tokenToVal(toPtr, toLen);
+
+        if (0 != exprNodeAddChild(range, bound))
+        {
+            exprNodeDestroy(bound);
+            exprNodeDestroy(range);
+            return NULL;
+        }
+    }
+
+    return range;
+}
+
+// Compiles expression from s starting at *pos up to the first unmatched ')', ',', '}', ']' or end.
+// Sets *terminator to token that stopped compilation. Returns NULL on error.
+static exprNode *compileExpr(const sds s, size_t *pos, tokenType *terminator)
+{
+    exprNode *result = NULL;
+    stack *operands = NULL, *operators = NULL;
+
+    if (NULL == (operands = stackCreate()))
+    {
+        return NULL;
+    }
+
+    if (NULL == (operators = stackCreate()))
+    {
+        stackDestroy(operands);
+        return NULL;
+    }
+
+    while (1)
+    {
+        char *tokenPtr = NULL;
+        size_t tokenLen = 0;
+        exprNode *operand = NULL;
+        tokenType tt = fetchToken(s, pos, &tokenPtr, &tokenLen);
+
+        if (tokenIdentifier == tt)
+        {
+            if (NULL == (operand = exprNodeCreate(exprSetRef)))
+            {
+                return compileAbort(operands, operators);
+            }
+
+            if (NULL == (operand->name = sdsnewlen(tokenPtr, tokenLen)))
+            {
+                exprNodeDestroy(operand);
+                return compileAbort(operands, operators);
+            }
+        }
+        else if (tokenVal == tt)
+        {
+            if (NULL == (operand = exprNodeCreate(exprVal)))
+            {
+                return compileAbort(operands, operators);
+            }
+
+            operand->val = tokenToVal(tokenPtr, tokenLen);
+        }
+        else if (tokenSetStart == tt ||
+                 tokenTupleStart == tt)
+        {
+            if (NULL == (operand = compileContainer(s, pos, tt)))
+            {
+                return compileAbort(operands, operators);
+            }
+        }
+        else if (tokenLeftBrace == tt)
+        {
+            tokenType subTerminator = tokenError;
+
+            if (NULL == (operand = compileExpr(s, pos, &subTerminator)))
+            {
+                return compileAbort(operands, operators);
+            }
+
+            if (tokenRightBrace != subTerminator)
+            {
+                exprNodeDestroy(operand);
+                return compileAbort(operands, operators);
+            }
+        }
+        else if (tokenIsOperator(tt))
+        {
+            while (0 != stackSize(operators))
+            {
+                void *top = NULL;
+                tokenType topOperator;
+
+                stackPeek(operators, &top);
+                topOperator = (tokenType) (size_t) top;
+
+                if (!((operatorIsLeftAssoc(tt) && (-1 == compareOperatorsPriority(tt, topOperator) ||
+                                                  0 == compareOperatorsPriority(tt, topOperator))) ||
+                      (!operatorIsLeftAssoc(tt) && -1 == compareOperatorsPriority(tt, topOperator))))
+                {
+                    break;
+                }
+
+                if (0 != compileApplyOperator(operands, operators))
+                {
+                    return compileAbort(operands, operators);
+                }
+            }
+
+            if (0 != stackPush(operators, (void *) (size_t) tt))
+            {
+                return compileAbort(operands, operators);
+            }
+
+            // Join positions follow the operator: A $[i, j] B.
+            if (tokenJoin == tt &&
+                (tokenTupleStart != fetchToken(s, pos, &tokenPtr, &tokenLen) ||
+                 NULL == (operand = compileContainer(s, pos, tokenTupleStart))))
+            {
+                return compileAbort(operands, operators);
+            }
+        }
+        else if (tokenRightBrace == tt ||
+                 tokenDelim == tt ||
+                 tokenSetEnd == tt ||
+                 tokenTupleEnd == tt ||
+                 tokenEnd == tt)
+        {
+            *terminator = tt;
+            break;
+        }
+        else
+        {
+            return compileAbort(operands, operators);
+        }
+
+        if (NULL != operand && 0 != stackPush(operands, operand))
+        {
+            exprNodeDestroy(operand);
+            return compileAbort(operands, operators);
+        }
+    }
+
+    // Unwind stacks.
+    while (0 != stackSize(operators))
+    {
+        if (0 != compileApplyOperator(operands, operators))
+        {
+            return compileAbort(operands, operators);
+        }
+    }
+
+    if (1 != stackSize(operands))
+    {
+        return compileAbort(operands, operators);
+    }
+
+    stackPop(operands, (void **) &result);
+
+    stackDestroy(operators);
+    stackDestroy(operands);
+    return result;
+}
+
+// Compiles set or tuple literal. *pos must point right after the opening token.
+// Returns NULL on error.
+static exprNode *compileContainer(const sds s, size_t *pos, tokenType startToken)
+{
+    exprNode *container = NULL;
+    tokenType endToken = tokenSetStart == startToken ? tokenSetEnd : tokenTupleEnd;
+    char *tokenPtr = NULL;
+    size_t tokenLen = 0, peekPos = *pos;
+    int isRange = 0;
+
+    if (tokenSetStart == startToken)
+    {
+        container = compileRange(s, pos, &isRange);
+
+        if (isRange)
+            return container;
+    }
+
+    if (NULL == (container = exprNodeCreate(tokenSetStart == startToken ? exprSetLiteral : exprTupleLiteral)))
+    {
+        return NULL;
+    }
+
+    // Empty container.
+    if (endToken == fetchToken(s, &peekPos, &tokenPtr, &tokenLen))
+    {
+        *pos = peekPos;
+        return container;
+    }
+
+    while (1)
+    {
+        tokenType terminator = tokenError;
+        exprNode *element = compileExpr(s, pos, &terminator);
+
+        if (NULL == element)
+        {
+            exprNodeDestroy(container);
+            return NULL;
+        }
+
+        if (0 != exprNodeAddChild(container, element))
+        {
+            exprNodeDestroy(element);
+            exprNodeDestroy(container);
+            return NULL;
+        }
+
+        if (endToken == terminator)
+        {
+            return container;
+        }
+
+        if (tokenDelim != terminator)
+        {
+            exprNodeDestroy(container);
+            return NULL;
+        }
+    }
+}
+
+// Pops top operator and its operands and pushes resulting node. Join gets its positions
+// literal as the last child. Returns -1 on error.
+static int compileApplyOperator(stack *operands, stack *operators)
+{
+    void *top = NULL;
+    tokenType oper;
+    exprNode *node = NULL, *children[3] = { NULL, NULL, NULL };
+    size_t i;
+
+    if (0 != stackPop(operators, &top))
+        return -1;
+
+    oper = (tokenType) (size_t) top;
+
+    if (0 != stackPop(operands, (void **) &children[1]))
+        return -1;
+
+    if (tokenJoin == oper && 0 != stackPop(operands, (void **) &children[2]))
+    {
+        exprNodeDestroy(children[1]);
+        return -1;
+    }
+
+    if (operatorIsLeftAssoc(oper) && 0 != stackPop(operands, (void **) &children[0]))
+    {
+        exprNodeDestroy(children[1]);
+        exprNodeDestroy(children[2]);
+        return -1;
+    }
+
+    if (NULL == (node = exprNodeCreate(exprOperator)))
+    {
+        for (i = 0; i < 3; i++)
+            exprNodeDestroy(children[i]);
+        return -1;
+    }
+
+    node->oper = oper;
+
+    for (i = 0; i < 3; i++)
+    {
+        if (NULL != children[i] && 0 != exprNodeAddChild(node, children[i]))
+        {
+            // Children added so far go with node.
+            exprNodeDestroy(node);
+            for (; i < 3; i++)
+                exprNodeDestroy(children[i]);
+            return -1;
+        }
+    }
+
+    if (0 != stackPush(operands, node))
+    {
+        exprNodeDestroy(node);
+        return -1;
+    }
+
+    return 0;
+}
+
+// Destroys compilation stacks with all nodes left on them. Always returns NULL.
+static exprNode *compileAbort(stack *operands, stack *operators)
+{
+    exprNode *node = NULL;
+
+    while (0 == stackPop(operands, (void **) &node))
+        exprNodeDestroy(node);
+
+    stackDestroy(operators);
+    stackDestroy(operands);
+    return NULL;
+}
+
+// Executes compiled expression node. Returns registered object or NULL on error.
+static dbObject *execNode(const exprNode *node, execContext *ctx)
+{
+    valType valObjectId;
+
+    if (NULL == node)
+        return NULL;
+
+    switch (node->nodeType)
+    {
+        case exprSetRef:
+            return execSetRef(node);
+
+        case exprVal:
+            return valCreate(node->val, &valObjectId);
+
+        case exprSetLiteral:
+        case exprTupleLiteral:
+            return execContainer(node, ctx);
+
+        case exprRangeLiteral:
+            return execRange(node);
+
+        case exprOperator:
+            return execOperator(node, ctx);
+    }
+
+    return NULL;
+}
+
+static dbObject *execSetRef(const exprNode *node)
+{
+    const set *operand = NULL;
+    valType objId;
+
+    if (NULL == (operand = dbGet(node->name)))
+    {
+        return NULL;
+    }
+
+    if (1 != dbFindSet(operand, &objId, 1))
+    {
+        return NULL;
+    }
+
+    return (dbObject *) dbGetObject(objId, 1);
+}
+
+static dbObject *execContainer(const exprNode *node, execContext *ctx)
+{
+    dbObject *container = NULL;
+    valType containerId, i;
+
+    if (NULL == (container = (dbObject *) calloc(1, sizeof(dbObject))))
+    {
+        return NULL;
+    }
+
+    if (exprSetLiteral == node->nodeType)
+    {
+        container->objectType = objectSet;
+
+        if (NULL == (container->objectPtr.setPtr = setCreate()))
+        {
+            free(container);
+            return NULL;
+        }
+    }
+    else
+    {
+        container->objectType = objectTuple;
+
+        if (NULL == (container->objectPtr.tuplePtr = listCreate()))
+        {
+            free(container);
+            return NULL;
+        }
+    }
+
+    for (i = 0; i < node->childrenCount; i++)
+    {
+        dbObject *element = execNode(node->children[i], ctx);
+        int added = 0;
+
+        if (NULL != element)
+        {
+            if (objectSet == container->objectType)
+                added = -1 != setAdd(container->objectPtr.setPtr, element->id);
+            else
+                added = NULL != listAddNodeTail(container->objectPtr.tuplePtr, (void *) element->id);
+        }
+
+        if (!added)
+        {
+            dbObjectRelease(container);
+            free(container);
+            return NULL;
+        }
+    }
+
+    if (0 != dbRegisterObject(&container, &containerId))
+    {
+        dbObjectRelease(container);
+        free(container);
+        return NULL;
+    }
+
+    return container;
+}
+
+// Interns values of range literal in batches and fills the set run by run, fresh values get
+// consecutive ids, so a batch is usually one memset. Returns NULL on error.
+static dbObject *execRange(const exprNode *node)
+{
+    dbObject *container = NULL;
+    valType *vals = NULL, *ids = NULL, from = node->children[0]->val, to = node->children[1]->val, left, containerId;
+    size_t count, i;
+    int failed = 0;
+
+    if (NULL == (container = (dbObject *) calloc(1, sizeof(dbObject))))
+        return NULL;
+
+    container->objectType = objectSet;
+
+    if (NULL == (container->objectPtr.setPtr = setCreate()) ||
+        NULL == (vals = (valType *) calloc(EVAL_RANGE_BATCH, sizeof(valType))) ||
+        NULL == (ids = (valType *) calloc(EVAL_RANGE_BATCH, sizeof(valType))))
+    {
+        failed = 1;
+    }
+
+    for (left = from <= to ? to - from + 1 : 0; !failed && 0 != left; left -= count)
+    {
+        count = (size_t) __min(left, EVAL_RANGE_BATCH);
+
+        for (i = 0; i < count; i++)
+            vals[i] = to - left + 1 + i;
+
+        failed = 0 != dbInternVals(vals, count, ids) ||
+                 0 != setAddMany(container->objectPtr.setPtr, ids, count);
+    }
+
+    free(vals);
+    free(ids);
+
+    if (failed || 0 != dbRegisterObject(&container, &containerId))
+    {
+        dbObjectRelease(container);
+        free(container);
+        return NULL;
+    }
+
+    return container;
+}
+
+// Only the result of the whole operator chain gets registered, intermediate sets are temporary.
+static dbObject *execOperator(const exprNode *node, execContext *ctx)
+{
+    set *result = NULL, *t = NULL;
+    int owned = 0;
+
+    if (isLazySet(node))
+    {
+        return execLazySet(node, ctx);
+    }
+
+    if (NULL == (result = execSet(node, ctx, &owned)))
+    {
+        return NULL;
+    }
+
+    if (!owned)
+    {
+        lockRead(result);
+        t = setCopy(result);
+        unlockRead(result);
+
+        if (NULL == (result = t))
+            return NULL;
+    }
+
+    return registerSet(result);
+}
+
+// Evaluates node to a set. Sets *owned to 1 if caller must destroy the result.
+// Returns NULL on error.
+static set *execSet(const exprNode *node, execContext *ctx, int *owned)
+{
+    set *result = NULL, *a = NULL, *b = NULL;
+    int aOwned = 0, bOwned = 0;
+    dbObject *obj = NULL;
+
+    *owned = 0;
+
+    if (exprSetRef == node->nodeType)
+    {
+        return (set *) dbGet(node->name);
+    }
+
+    if (exprOperator != node->nodeType)
+    {
+        if (NULL == (obj = execNode(node, ctx)) || objectSet != obj->objectType)
+            return NULL;
+
+        return obj->objectPtr.setPtr;
+    }
+
+    if (0 != node->cseId && NULL != ctx->memo[node->cseId])
+    {
+        return ctx->memo[node->cseId];
+    }
+
+    if (tokenMultiply == node->oper)
+    {
+        result = execInter(node, ctx);
+    }
+    else if (tokenPlus == node->oper ||
+             tokenMinus == node->oper)
+    {
+        result = execChain(node, ctx);
+    }
+    else if (isRelationOperator(node))
+    {
+        result = execRelationSet(node, ctx);
+    }
+    else if (tokenProject == node->oper ||
+             tokenJoin == node->oper)
+    {
+        result = execTupleOperator(node, ctx);
+    }
+    else if (tokenSelect == node->oper)
+    {
+        result = execSelect(node, ctx);
+    }
+    else
+    {
+        if (0 == node->childrenCount ||
+            NULL == (a = execSet(node->children[0], ctx, &aOwned)))
+        {
+            return NULL;
+        }
+
+        if (1 < node->childrenCount &&
+            NULL == (b = execSet(node->children[1], ctx, &bOwned)))
+        {
+            releaseSet(a, aOwned);
+            return NULL;
+        }
+
+        result = performSetOperation(node->oper, a, b);
+        releaseSet(a, aOwned);
+        releaseSet(b, bOwned);
+    }
+
+    if (NULL == result)
+    {
+        return NULL;
+    }
+
+    if (0 != node->cseId)
+    {
+        ctx->memo[node->cseId] = result;
+        return result;
+    }
+
+    *owned = 1;
+    return result;
+}
+
+// Evaluates n-ary union or difference with one fused pass over all operands.
+// Returns NULL on error.
+static set *execChain(const exprNode *node, execContext *ctx)
+{
+    set **operands = NULL, *result = NULL;
+    int *owned = NULL, failed = 0;
+    size_t i, count = 0;
+
+    if (NULL == (operands = (set **) calloc(node->childrenCount, sizeof(set *))))
+    {
+        return NULL;
+    }
+
+    if (NULL == (owned = (int *) calloc(node->childrenCount, sizeof(int))))
+    {
+        free(operands);
+        return NULL;
+    }
+
+    while (count < node->childrenCount)
+    {
+        if (NULL == (operands[count] = execSet(node->children[count], ctx, &owned[count])))
+        {
+            failed = 1;
+            break;
+        }
+
+        count++;
+
+        // Nothing to subtract from.
+        if (tokenMinus == node->oper && 0 == operands[0]->card)
+            break;
+    }
+
+    if (!failed)
+    {
+        lockSets((const set **) operands, count);
+
+        if (tokenPlus == node->oper)
+            result = setUnionN((const set **) operands, count);
+        else
+            result = setDiffN((const set **) operands, count);
+
+        unlockSets((const set **) operands, count);
+    }
+
+    for (i = 0; i < count; i++)
+        releaseSet(operands[i], owned[i]);
+
+    free(operands);
+    free(owned);
+    return result;
+}
+
+// Intersects children of n-ary intersection node, smallest estimated operand first.
+// Operands which are cheaper to intersect by pushing the intersection into them are
+// handled last, the rest are intersected in one fused pass. Returns NULL on error.
+static set *execInter(const exprNode *node, execContext *ctx)
+{
+    size_t *order = NULL, i, j, plainCount = 0;
+    valType *cards = NULL, *lengths = NULL;
+    set **plain = NULL, *acc = NULL, *next = NULL;
+    int *owned = NULL, failed = 0, empty = 0;
+
+    order = (size_t *) malloc(node->childrenCount * sizeof(size_t));
+    cards = (valType *) malloc(node->childrenCount * sizeof(valType));
+    lengths = (valType *) malloc(node->childrenCount * sizeof(valType));
+    plain = (set **) calloc(node->childrenCount, sizeof(set *));
+    owned = (int *) calloc(node->childrenCount, sizeof(int));
+
+    if (NULL == order || NULL == cards || NULL == lengths || NULL == plain || NULL == owned)
+    {
+        free(order);
+        free(cards);
+        free(lengths);
+        free(plain);
+        free(owned);
+        return NULL;
+    }
+
+    for (i = 0; i < node->childrenCount; i++)
+    {
+        order[i] = i;
+        optimizerEstimate(node->children[i], &cards[i], &lengths[i]);
+
+        // Ranges filter the other operands, so they go last.
+        if (isRangeLiteral(node->children[i]))
+            cards[i] = (valType) -1;
+    }
+
+    // Insertion sort, chains are short.
+    for (i = 1; i < node->childrenCount; i++)
+    {
+        for (j = i; j > 0 && cards[order[j - 1]] > cards[order[j]]; j--)
+        {
+            size_t t = order[j];
+            order[j] = order[j - 1];
+            order[j - 1] = t;
+        }
+    }
+
+    for (i = 0; i < node->childrenCount && !failed && !empty; i++)
+    {
+        const exprNode *child = node->children[order[i]];
+
+        if (0 != i && 0 == child->cseId &&
+            (optimizerShouldPushInter(child, lengths[order[0]]) || isLazySet(child) || isRangeLiteral(child)))
+        {
+            continue;
+        }
+
+        if (NULL == (plain[plainCount] = execSet(child, ctx, &owned[plainCount])))
+        {
+            failed = 1;
+            break;
+        }
+
+        empty = 0 == plain[plainCount]->card;
+        plainCount++;
+    }
+
+    if (!failed)
+    {
+        lockSets((const set **) plain, plainCount);
+        acc = setInterN((const set **) plain, plainCount);
+        unlockSets((const set **) plain, plainCount);
+    }
+
+    for (i = 0; i < plainCount; i++)
+        releaseSet(plain[i], owned[i]);
+
+    // Pushed down operands, skipped above.
+    for (i = 1; i < node->childrenCount && NULL != acc && 0 != acc->card && !empty; i++)
+    {
+        const exprNode *child = node->children[order[i]];
+
+        if (!(0 == child->cseId &&
+              (optimizerShouldPushInter(child, lengths[order[0]]) || isLazySet(child) || isRangeLiteral(child))))
+        {
+            continue;
+        }
+
+        next = execInterWith(child, acc, ctx);
+        setDestroy(acc);
+        acc = next;
+    }
+
+    free(order);
+    free(cards);
+    free(lengths);
+    free(plain);
+    free(owned);
+    return acc;
+}
+
+// Returns node * acc, pushing the intersection below unions and differences
+// when that is cheaper than materializing node. Returns NULL on error.
+static set *execInterWith(const exprNode *node, const set *acc, execContext *ctx)
+{
+    set **operands = NULL, *result = NULL, *operand = NULL;
+    int *owned = NULL, operandOwned = 0;
+    size_t i, count = 0;
+
+    if (isLazySet(node))
+    {
+        return execLazyInter(node, acc, ctx);
+    }
+
+    if (isRangeLiteral(node))
+    {
+        return dbValRangeInter(acc, node->children[0]->val, node->children[1]->val);
+    }
+
+    if (!(exprOperator == node->nodeType && 0 == node->cseId &&
+          optimizerShouldPushInter(node, acc->length)))
+    {
+        if (NULL == (operand = execSet(node, ctx, &operandOwned)))
+            return NULL;
+
+        result = performSetOperation(tokenMultiply, operand, acc);
+        releaseSet(operand, operandOwned);
+        return result;
+    }
+
+    if (NULL == (operands = (set **) calloc(node->childrenCount, sizeof(set *))))
+    {
+        return NULL;
+    }
+
+    if (NULL == (owned = (int *) calloc(node->childrenCount, sizeof(int))))
+    {
+        free(operands);
+        return NULL;
+    }
+
+    // (A + B) * C = A * C + B * C, (A - B) * C = A * C - B.
+    for (count = 0; count < node->childrenCount; count++)
+    {
+        if (tokenPlus == node->oper || 0 == count)
+        {
+            operands[count] = execInterWith(node->children[count], acc, ctx);
+            owned[count] = 1;
+        }
+        else
+        {
+            operands[count] = execSet(node->children[count], ctx, &owned[count]);
+        }
+
+        if (NULL == operands[count])
+            break;
+    }
+
+    if (count == node->childrenCount)
+    {
+        lockSets((const set **) operands, count);
+
+        if (tokenPlus == node->oper)
+            result = setUnionN((const set **) operands, count);
+        else
+            result = setDiffN((const set **) operands, count);
+
+        unlockSets((const set **) operands, count);
+    }
+
+    for (i = 0; i < count; i++)
+        releaseSet(operands[i], owned[i]);
+
+    free(operands);
+    free(owned);
+    return result;
+}
+
+// Returns ^X * acc or (X @ Y) * acc by testing each member of acc against operands,
+// the power set or product itself is never built. Returns NULL on error.
+static set *execLazyInter(const exprNode *node, const set *acc, execContext *ctx)
+{
+    set *a = NULL, *b = NULL, *result = NULL;
+    relation *r = NULL;
+    int aOwned = 0, bOwned = 0;
+
+    if (operatorIsRelation(node->oper))
+    {
+        if (NULL == (r = execRelation(node, ctx)))
+            return NULL;
+
+        lockRead(acc);
+        result = relationInter(r, acc, 1);
+        unlockRead(acc);
+
+        relationDestroy(r);
+        return result;
+    }
+
+    if (NULL == (a = execSet(node->children[0], ctx, &aOwned)))
+        return NULL;
+
+    if (2 == node->childrenCount &&
+        NULL == (b = execSet(node->children[1], ctx, &bOwned)))
+    {
+        releaseSet(a, aOwned);
+        return NULL;
+    }
+
+    lockRead(a);
+    if (NULL != b && b != a)
+        lockRead(b);
+    lockRead(acc);
+
+    if (tokenBoolean == node->oper)
+        result = powerSetInter(a, acc, 1);
+    else
+        result = cartProdInter(a, b, acc, 1);
+
+    unlockRead(acc);
+    if (NULL != b && b != a)
+        unlockRead(b);
+    unlockRead(a);
+
+    releaseSet(a, aOwned);
+    releaseSet(b, bOwned);
+    return result;
+}
+
+// Registers lazy power set, cartesian product or relation of the operands. Members are built only
+// when the result is stored. Returns NULL on error.
+static dbObject *execLazySet(const exprNode *node, execContext *ctx)
+{
+    dbObject *result = NULL;
+    set *a = NULL, *b = NULL;
+    int aOwned = 0, bOwned = 0;
+    valType resultId;
+
+    if (operatorIsRelation(node->oper))
+    {
+        if (NULL == (result = (dbObject *) calloc(1, sizeof(dbObject))))
+            return NULL;
+
+        result->objectType = objectRelation;
+
+        if (NULL == (result->objectPtr.relationPtr = execRelation(node, ctx)))
+        {
+            free(result);
+            return NULL;
+        }
+
+        if (0 != dbRegisterObject(&result, &resultId))
+        {
+            dbObjectRelease(result);
+            free(result);
+            return NULL;
+        }
+
+        return result;
+    }
+
+    if (NULL == (a = execSet(node->children[0], ctx, &aOwned)))
+        return NULL;
+
+    if (2 == node->childrenCount &&
+        NULL == (b = execSet(node->children[1], ctx, &bOwned)))
+    {
+        releaseSet(a, aOwned);
+        return NULL;
+    }
+
+    if (NULL == (result = (dbObject *) calloc(1, sizeof(dbObject))))
+    {
+        releaseSet(a, aOwned);
+        releaseSet(b, bOwned);
+        return NULL;
+    }
+
+    lockRead(a);
+    if (NULL != b && b != a)
+        lockRead(b);
+
+    if (tokenBoolean == node->oper)
+    {
+        result->objectType = objectPowerSet;
+        result->objectPtr.powerSetPtr = powerSetCreate(a);
+    }
+    else
+    {
+        result->objectType = objectCartProd;
+        result->objectPtr.cartProdPtr = cartProdCreate(a, b);
+    }
+
+    if (NULL != b && b != a)
+        unlockRead(b);
+    unlockRead(a);
+
+    releaseSet(a, aOwned);
+    releaseSet(b, bOwned);
+
+    if ((objectPowerSet == result->objectType && NULL == result->objectPtr.powerSetPtr) ||
+        (objectCartProd == result->objectType && NULL == result->objectPtr.cartProdPtr))
+    {
+        free(result);
+        return NULL;
+    }
+
+    if (0 != dbRegisterObject(&result, &resultId))
+    {
+        dbObjectRelease(result);
+        free(result);
+        return NULL;
+    }
+
+    return result;
+}
+
+// Power sets, cartesian products and relations are kept lazy at the top of an expression
+// and act as membership filters in intersections.
+static int isRangeLiteral(const exprNode *node)
+{
+    return exprRangeLiteral == node->nodeType;
+}
+
+static int hasRangeChild(const exprNode *node)
+{
+    size_t i;
+
+    for (i = 0; i < node->childrenCount; i++)
+        if (isRangeLiteral(node->children[i]))
+            return 1;
+
+    return 0;
+}
+
+static int isLazySet(const exprNode *node)
+{
+    return exprOperator == node->nodeType && 0 == node->cseId &&
+           ((tokenBoolean == node->oper && 1 == node->childrenCount) ||
+            (tokenCartProd == node->oper && 2 == node->childrenCount) ||
+            ((tokenInverse == node->oper || tokenClosure == node->oper) && 1 == node->childrenCount) ||
+            (tokenCompose == node->oper && 2 == node->childrenCount));
+}
+
+static int isRelationOperator(const exprNode *node)
+{
+    return exprOperator == node->nodeType &&
+           ((tokenCompose == node->oper && 2 == node->childrenCount) ||
+            ((tokenInverse == node->oper || tokenClosure == node->oper ||
+              tokenDomain == node->oper || tokenRange == node->oper) &&
+             1 == node->childrenCount));
+}
+
+// Evaluates node to a relation. Cartesian products are built straight from operand bitmaps,
+// other sets are loaded from their pair tuples. Returns NULL on error.
+static relation *execRelation(const exprNode *node, execContext *ctx)
+{
+    relation *a = NULL, *b = NULL, *result = NULL;
+    set *s = NULL, *t = NULL;
+    int sOwned = 0, tOwned = 0;
+
+    if (exprOperator == node->nodeType && tokenCompose == node->oper && 2 == node->childrenCount)
+    {
+        if (NULL == (a = execRelation(node->children[0], ctx)))
+            return NULL;
+
+        if (NULL == (b = execRelation(node->children[1], ctx)))
+        {
+            relationDestroy(a);
+            return NULL;
+        }
+
+        result = relationCompose(a, b);
+        relationDestroy(a);
+        relationDestroy(b);
+        return result;
+    }
+
+    if (exprOperator == node->nodeType &&
+        (tokenInverse == node->oper || tokenClosure == node->oper) && 1 == node->childrenCount)
+    {
+        if (NULL == (a = execRelation(node->children[0], ctx)))
+            return NULL;
+
+        result = tokenInverse == node->oper ? relationInverse(a) : relationClosure(a);
+        relationDestroy(a);
+        return result;
+    }
+
+    if (exprOperator == node->nodeType && tokenCartProd == node->oper && 2 == node->childrenCount)
+    {
+        if (NULL == (s = execSet(node->children[0], ctx, &sOwned)))
+            return NULL;
+
+        if (NULL == (t = execSet(node->children[1], ctx, &tOwned)))
+        {
+            releaseSet(s, sOwned);
+            return NULL;
+        }
+
+        lockRead(s);
+        if (t != s)
+            lockRead(t);
+
+        result = relationFromCartProd(s, t);
+
+        if (t != s)
+            unlockRead(t);
+        unlockRead(s);
+
+        releaseSet(s, sOwned);
+        releaseSet(t, tOwned);
+        return result;
+    }
+
+    if (NULL == (s = execSet(node, ctx, &sOwned)))
+        return NULL;
+
+    lockRead(s);
+    result = relationFromTuples(s, 1);
+    unlockRead(s);
+
+    releaseSet(s, sOwned);
+    return result;
+}
+
+// Evaluates relation operator to a set: domain, range or pair tuples. Returns NULL on error.
+static set *execRelationSet(const exprNode *node, execContext *ctx)
+{
+    relation *r = NULL;
+    set *result = NULL;
+
+    if (tokenDomain == node->oper || tokenRange == node->oper)
+    {
+        if (NULL == (r = execRelation(node->children[0], ctx)))
+            return NULL;
+
+        result = tokenDomain == node->oper ? relationDomain(r) : relationRange(r);
+    }
+    else
+    {
+        if (NULL == (r = execRelation(node, ctx)))
+            return NULL;
+
+        result = relationMaterialize(r);
+    }
+
+    relationDestroy(r);
+    return result;
+}
+
+// Evaluates projection A # [p, ...] or join A $[i, j] B. Positions are read straight from
+// the literal, so it never gets registered. Returns NULL on error.
+static set *execTupleOperator(const exprNode *node, execContext *ctx)
+{
+    const exprNode *param = node->children[node->childrenCount - 1];
+    valType inlinePositions[EVAL_INLINE_OPERANDS], *positions = inlinePositions;
+    set *a = NULL, *b = NULL, *result = NULL;
+    int aOwned = 0, bOwned = 0;
+    size_t i;
+
+    if ((tokenJoin == node->oper ? 3 : 2) != node->childrenCount ||
+        exprTupleLiteral != param->nodeType || 0 == param->childrenCount ||
+        (tokenJoin == node->oper && 2 != param->childrenCount))
+    {
+        return NULL;
+    }
+
+    if (param->childrenCount > EVAL_INLINE_OPERANDS &&
+        NULL == (positions = (valType *) malloc(param->childrenCount * sizeof(valType))))
+    {
+        return NULL;
+    }
+
+    for (i = 0; i < param->childrenCount && exprVal == param->children[i]->nodeType; i++)
+        positions[i] = param->children[i]->val;
+
+    if (i < param->childrenCount ||
+        NULL == (a = execSet(node->children[0], ctx, &aOwned)))
+    {
+        if (inlinePositions != positions)
+            free(positions);
+        return NULL;
+    }
+
+    if (tokenJoin == node->oper &&
+        NULL == (b = execSet(node->children[1], ctx, &bOwned)))
+    {
+        releaseSet(a, aOwned);
+        if (inlinePositions != positions)
+            free(positions);
+        return NULL;
+    }
+
+    lockRead(a);
+    if (NULL != b && b != a)
+        lockRead(b);
+
+    if (tokenJoin == node->oper)
+        result = tupleJoin(a, positions[0], b, positions[1], 1);
+    else
+        result = tupleProject(a, positions, param->childrenCount, 1);
+
+    if (NULL != b && b != a)
+        unlockRead(b);
+    unlockRead(a);
+
+    releaseSet(a, aOwned);
+    releaseSet(b, bOwned);
+
+    if (inlinePositions != positions)
+        free(positions);
+
+    return result;
+}
+
+// Evaluates selection A | [p, X]: tuples of A having object X at position p. Returns NULL on error.
+static set *execSelect(const exprNode *node, execContext *ctx)
+{
+    const exprNode *param = node->children[node->childrenCount - 1];
+    dbObject *component = NULL;
+    set *a = NULL, *result = NULL;
+    int aOwned = 0;
+
+    if (2 != node->childrenCount ||
+        exprTupleLiteral != param->nodeType || 2 != param->childrenCount ||
+        exprVal != param->children[0]->nodeType)
+    {
+        return NULL;
+    }
+
+    if (NULL == (component = execNode(param->children[1], ctx)) ||
+        NULL == (a = execSet(node->children[0], ctx, &aOwned)))
+    {
+        return NULL;
+    }
+
+    lockRead(a);
+    result = tupleSelect(a, param->children[0]->val, component->id, 1);
+    unlockRead(a);
+
+    releaseSet(a, aOwned);
+    return result;
+}
+
+// Returns NULL on error.
+static set *performSetOperation(tokenType oper, const set *a, const set *b)
+{
+    set *result = NULL;
+
+    if (NULL != a)
+        lockRead(a);
+
+    if (NULL != b)
+        lockRead(b);
+
+    switch (oper)
+    {
+        case tokenBoolean:
+            result = setBoolean(a);
+            break;
+
+        case tokenMultiply:
+            result = setInter(a, b);
+            break;
+
+        case tokenCartProd:
+            result = cartProdPairs(a, b);
+            break;
+
+        case tokenPlus:
+            result = setUnion(a, b);
+            break;
+
+        case tokenMinus:
+            result = setDiff(a, b);
+            break;
+
+        case tokenSymDiff:
+            result = setSymDiff(a, b);
+            break;
+    }
+
+    if (NULL != a)
+        unlockRead(a);
+
+    if (NULL != b)
+        unlockRead(b);
+
+    return result;
+}
+
+// Registers s in object index, s is consumed. Returns NULL on error.
+static dbObject *registerSet(set *s)
+{
+    dbObject *resultObject = NULL;
+    valType resultObjectId;
+
+    if (NULL == (resultObject = (dbObject *) calloc(1, sizeof(dbObject))))
+    {
+        setDestroy(s);
+        return NULL;
+    }
+
+    resultObject->objectType = objectSet;
+    resultObject->objectPtr.setPtr = s;
+
+    if (0 != dbRegisterObject(&resultObject, &resultObjectId))
+    {
+        setDestroy(s);
+        free(resultObject);
+        return NULL;
+    }
+
+    return resultObject;
+}
+
+static void releaseSet(set *s, int owned)
+{
+    if (owned)
+        setDestroy(s);
+}
+
+// Read-locks every distinct set in sets.
+static void lockSets(const set **sets, size_t count)
+{
+    size_t i, j;
+
+    for (i = 0; i < count; i++)
+    {
+        for (j = 0; j < i && sets[j] != sets[i]; j++);
+
+        if (j == i)
+            lockRead(sets[i]);
+    }
+}
+
+static void unlockSets(const set **sets, size_t count)
+{
+    size_t i, j;
+
+    for (i = 0; i < count; i++)
+    {
+        for (j = 0; j < i && sets[j] != sets[i]; j++);
+
+        if (j == i)
+            unlockRead(sets[i]);
+    }
+}
+
+// If token isn't an operator then the result is unpredictable.
+// Returns: 1 - a > b, 0 - a = b, -1 - a < b.
+static int compareOperatorsPriority(tokenType a, tokenType b)
+{
+    // Priority: ^ ! < > & @ * ; # $ |, + - ~
+    switch (a)
+    {
+        case tokenBoolean:
+        case tokenMultiply:
+        case tokenCartProd:
+        case tokenCompose:
+        case tokenInverse:
+        case tokenDomain:
+        case tokenRange:
+        case tokenClosure:
+        case tokenProject:
+        case tokenJoin:
+        case tokenSelect:
+            if (!operatorIsLowPriority(b))
+            {
+                return 0;
+            }
+
+            return 1;
+
+        case tokenPlus:
+        case tokenMinus:
+        case tokenSymDiff:
+            if (!operatorIsLowPriority(b))
+            {
+                return -1;
+            }
+
+            return 0;
+    }
+
+    return 0;
+}
+
+static int tokenIsOperator(tokenType tt)
+{
+    return tokenBoolean == tt ||
+           tokenMultiply == tt ||
+           tokenCartProd == tt ||
+           tokenPlus == tt ||
+           tokenMinus == tt ||
+           tokenSymDiff == tt ||
+           tokenCompose == tt ||
+           tokenInverse == tt ||
+           tokenDomain == tt ||
+           tokenRange == tt ||
+           tokenClosure == tt ||
+           tokenProject == tt ||
+           tokenJoin == tt ||
+           tokenSelect == tt;
+}
+
+// Returns 1 if oper produces a relation.
+static int operatorIsRelation(tokenType oper)
+{
+    return tokenCompose == oper ||
+           tokenInverse == oper ||
+           tokenClosure == oper;
+}
+
+static int operatorIsLowPriority(tokenType oper)
+{
+    return tokenPlus == oper ||
+           tokenMinus == oper ||
+           tokenSymDiff == oper;
+}
+
+// Return -1 on error.
+static int operatorIsLeftAssoc(tokenType oper)
+{
+    switch (oper)
+    {
+        case tokenMultiply:
+        case tokenCartProd:
+        case tokenPlus:
+        case tokenMinus:
+        case tokenSymDiff:
+        case tokenCompose:
+        case tokenProject:
+        case tokenJoin:
+        case tokenSelect:
+            return 1;
+
+        case tokenBoolean:
+        case tokenInverse:
+        case tokenDomain:
+        case tokenRange:
+        case tokenClosure:
+            return 0;
+    }
+
+    return -1;
+}
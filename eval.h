@@ -1,13 +1,32 @@
-// eval.h - Set expression evaluation.
-
-#ifndef __EVAL_H__
-#define __EVAL_H__
-
-#include "sds.h"
-
-#include "set.h"
-
-// Return NULL on error.
-dbObject *eval(const sds s, size_t *pos);
-
-#endif /* __EVAL_H__ */
+// eval.h - Set expression evaluation.
+
+#ifndef __EVAL_H__
+#define __EVAL_H__
+
+#include "sds.h"
+
+#include "set.h"
+
+// Predicates over two set expressions.
+typedef enum evalPredicate
+{
+    predicateEq, predicateSubset, predicateSubsetOrEq, predicateIntersects
+} evalPredicate;
+
+// Return NULL on error.
+dbObject *eval(const sds s, size_t *pos);
+// Sets *card to cardinality of set expression s without registering the result. Returns -1 on error.
+int evalCard(const sds s, valType *card);
+// Evaluates comma separated list of expressions s. Returns array of object ids of its members in list order
+// and sets *count to their number, or returns NULL on error. Caller frees the array.
+valType *evalList(const sds s, size_t *count);
+// Estimates cardinality of set expression s, unions of named sets are estimated from their sketches without
+// reading bitmaps. Sets *error to standard error of the estimate, 0 if it is exact. Returns -1 on error.
+int evalApproxCard(const sds s, double *card, double *error);
+// Evaluates set expression s without registering the result. Sets *owned to 1 if caller must
+// destroy the result, otherwise it is a stored set and must be locked for reading. Returns NULL on error.
+set *evalSet(const sds s, int *owned);
+// Returns 1 if predicate holds for set expressions a and b, 0 if it doesn't, -1 on error.
+int evalTest(evalPredicate predicate, const sds a, const sds b);
+
+#endif /* __EVAL_H__ */
@@ -0,0 +1,107 @@
+// hll.c - HyperLogLog cardinality sketches.
+
+#include <memory.h>
+#include <math.h>
+
+#include "dict.h"
+
+#include "athena.h"
+#include "hll.h"
+
+static __inline void hllLocate(valType id, size_t *index, unsigned char *rank);
+
+void hllInit(hll *h)
+{
+    memset(h->regs, 0, sizeof(h->regs));
+}
+
+int hllAdd(hll *h, valType id)
+{
+    size_t index;
+    unsigned char rank;
+
+    hllLocate(id, &index, &rank);
+
+    if (rank <= h->regs[index])
+        return 0;
+
+    h->regs[index] = rank;
+    return 1;
+}
+
+int hllHolds(const hll *h, valType id)
+{
+    size_t index;
+    unsigned char rank;
+
+    hllLocate(id, &index, &rank);
+    return rank == h->regs[index];
+}
+
+int hllFromSet(hll *h, const set *s)
+{
+    setIterator *iter = NULL;
+
+    hllInit(h);
+
+    if (0 != setGetIter(s, &iter))
+        return -1;
+
+    while (NULL != iter && 0 == setGetNext(iter))
+        hllAdd(h, iter->val);
+
+    setDestroyIter(iter);
+    return 0;
+}
+
+void hllMerge(hll *h, const hll *src)
+{
+    size_t i;
+
+    for (i = 0; i < HLL_REGISTERS; i++)
+        h->regs[i] = __max(h->regs[i], src->regs[i]);
+}
+
+double hllCount(const hll *h)
+{
+    const double m = HLL_REGISTERS, two32 = 4294967296.0;
+    double sum = 0, estimate;
+    size_t i, zeros = 0;
+
+    for (i = 0; i < HLL_REGISTERS; i++)
+    {
+        sum += ldexp(1.0, -(int) h->regs[i]);
+
+        if (0 == h->regs[i])
+            zeros++;
+    }
+
+    estimate = 0.7213 / (1 + 1.079 / m) * m * m / sum;
+
+    // Linear counting is more accurate while many registers are still empty.
+    if (estimate <= 2.5 * m && 0 != zeros)
+        return m * log(m / zeros);
+
+    // Correction for collisions of 32-bit hashes.
+    if (estimate > two32 / 30)
+        return -two32 * log(1 - estimate / two32);
+
+    return estimate;
+}
+
+// Private api.
+// Top HLL_PRECISION bits of id hash select register, rank is position of first set bit in the rest.
+static __inline void hllLocate(valType id, size_t *index, unsigned char *rank)
+{
+    unsigned int hash = dictIntHashFunction((unsigned int) id ^ 0x5BD1E995u);
+    unsigned int rest = hash << HLL_PRECISION;
+
+    *index = hash >> (32 - HLL_PRECISION);
+    *rank = 1;
+
+    while (*rank <= 32 - HLL_PRECISION && 0 == (rest & 0x80000000u))
+    {
+        rest <<= 1;
+        (*rank)++;
+    }
+}
@@ -0,0 +1,32 @@
+// hll.h - HyperLogLog cardinality sketches.
+
+#ifndef __HLL_H__
+#define __HLL_H__
+
+#include "athena.h"
+#include "set.h"
+
+#define HLL_PRECISION 12                        // Register index bits.
+#define HLL_REGISTERS (1 << HLL_PRECISION)
+#define HLL_STD_ERROR (1.04 / 64)               // Relative standard error, 1.04 / sqrt(HLL_REGISTERS).
+
+// HyperLogLog sketch of a set of object ids. Zeroed sketch is a sketch of empty set.
+typedef struct hll
+{
+    unsigned char regs[HLL_REGISTERS];
+} hll;
+
+// Makes h a sketch of empty set.
+void hllInit(hll *h);
+// Adds id to sketch. Returns 1 if sketch changed, 0 otherwise.
+int hllAdd(hll *h, valType id);
+// Returns 1 if id sets its register, so removing it requires recomputing the sketch.
+int hllHolds(const hll *h, valType id);
+// Computes sketch of s. Returns -1 on error.
+int hllFromSet(hll *h, const set *s);
+// Merges src into h, so h becomes a sketch of union.
+void hllMerge(hll *h, const hll *src);
+// Returns estimated cardinality.
+double hllCount(const hll *h);
+
+#endif /* __HLL_H__ */
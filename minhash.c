@@ -0,0 +1,238 @@
+// minhash.c - MinHash signatures and LSH banding index.
+
+#include <stdlib.h>
+#include <limits.h>
+
+#include "dict.h"
+
+#include "athena.h"
+#include "minhash.h"
+
+#define MINHASH_ROWS (MINHASH_SIZE / MINHASH_BANDS)
+
+static dictType dictBucketType;
+
+static __inline unsigned int minHashValue(valType id, size_t k);
+static unsigned int minHashBand(const minHash *h, size_t band);
+
+void minHashInit(minHash *h)
+{
+    size_t k;
+
+    for (k = 0; k < MINHASH_SIZE; k++)
+        h->mins[k] = UINT_MAX;
+}
+
+int minHashAdd(minHash *h, valType id)
+{
+    unsigned int v;
+    int changed = 0;
+    size_t k;
+
+    for (k = 0; k < MINHASH_SIZE; k++)
+    {
+        if ((v = minHashValue(id, k)) < h->mins[k])
+        {
+            h->mins[k] = v;
+            changed = 1;
+        }
+    }
+
+    return changed;
+}
+
+int minHashHolds(const minHash *h, valType id)
+{
+    size_t k;
+
+    for (k = 0; k < MINHASH_SIZE; k++)
+        if (minHashValue(id, k) == h->mins[k])
+            return 1;
+
+    return 0;
+}
+
+int minHashFromSet(minHash *h, const set *s)
+{
+    setIterator *iter = NULL;
+
+    minHashInit(h);
+
+    if (0 != setGetIter(s, &iter))
+        return -1;
+
+    while (NULL != iter && 0 == setGetNext(iter))
+        minHashAdd(h, iter->val);
+
+    setDestroyIter(iter);
+    return 0;
+}
+
+int minHashIsEmpty(const minHash *h)
+{
+    size_t k;
+
+    for (k = 0; k < MINHASH_SIZE; k++)
+        if (UINT_MAX != h->mins[k])
+            return 0;
+
+    return 1;
+}
+
+lshIndex *lshCreate(void)
+{
+    lshIndex *idx = NULL;
+    size_t band;
+
+    if (NULL == (idx = (lshIndex *) calloc(1, sizeof(lshIndex))))
+        return NULL;
+
+    for (band = 0; band < MINHASH_BANDS; band++)
+    {
+        if (NULL == (idx->buckets[band] = dictCreate(&dictBucketType, NULL)))
+        {
+            lshDestroy(idx);
+            return NULL;
+        }
+    }
+
+    return idx;
+}
+
+void lshDestroy(lshIndex *idx)
+{
+    size_t band;
+
+    if (NULL == idx)
+        return;
+
+    for (band = 0; band < MINHASH_BANDS; band++)
+        if (NULL != idx->buckets[band])
+            dictRelease(idx->buckets[band]);
+
+    free(idx);
+}
+
+int lshInsert(lshIndex *idx, const minHash *h, valType id)
+{
+    size_t band;
+    set *bucket = NULL;
+    void *key = NULL;
+
+    if (NULL == idx || NULL == h)
+        return -1;
+
+    if (minHashIsEmpty(h))
+        return 0;
+
+    for (band = 0; band < MINHASH_BANDS; band++)
+    {
+        key = (void *) (size_t) minHashBand(h, band);
+
+        if (NULL == (bucket = (set *) dictFetchValue(idx->buckets[band], key)))
+        {
+            if (NULL == (bucket = setCreate()))
+                return -1;
+
+            if (DICT_OK != dictAdd(idx->buckets[band], key, bucket))
+            {
+                setDestroy(bucket);
+                return -1;
+            }
+        }
+
+        if (-1 == setAdd(bucket, id))
+            return -1;
+    }
+
+    return 0;
+}
+
+void lshRemove(lshIndex *idx, const minHash *h, valType id)
+{
+    size_t band;
+    set *bucket = NULL;
+    void *key = NULL;
+
+    if (NULL == idx || NULL == h || minHashIsEmpty(h))
+        return;
+
+    for (band = 0; band < MINHASH_BANDS; band++)
+    {
+        key = (void *) (size_t) minHashBand(h, band);
+
+        if (NULL == (bucket = (set *) dictFetchValue(idx->buckets[band], key)))
+            continue;
+
+        setRemove(bucket, id);
+
+        if (0 == bucket->card)
+            dictDelete(idx->buckets[band], key);
+    }
+}
+
+set *lshCandidates(lshIndex *idx, const minHash *h)
+{
+    set *result = NULL;
+    const set *bucket = NULL;
+    size_t band;
+
+    if (NULL == idx || NULL == h || NULL == (result = setCreate()))
+        return NULL;
+
+    if (minHashIsEmpty(h))
+        return result;
+
+    for (band = 0; band < MINHASH_BANDS; band++)
+    {
+        bucket = (const set *) dictFetchValue(idx->buckets[band], (void *) (size_t) minHashBand(h, band));
+
+        if (NULL != bucket && -1 == setMerge(result, bucket))
+        {
+            setDestroy(result);
+            return NULL;
+        }
+    }
+
+    return result;
+}
+
+// Private api.
+// Returns value of k-th hash function for id.
+static __inline unsigned int minHashValue(valType id, size_t k)
+{
+    // Seeds are mixed from k, so hash functions don't need a table.
+    return dictIntHashFunction((unsigned int) id ^ dictIntHashFunction((unsigned int) k * 0x9E3779B9u + 1));
+}
+
+static unsigned int minHashBand(const minHash *h, size_t band)
+{
+    return dictGenHashFunction((const unsigned char *) &h->mins[band * MINHASH_ROWS],
+                               MINHASH_ROWS * sizeof(unsigned int));
+}
+
+unsigned int dictBucketKeyHash(const void *key);
+void dictBucketValDestructor(void *privdata, void *val);
+
+/* LSH band, keys are band hashes, vals are sets of ids. */
+static dictType dictBucketType =
+{
+    dictBucketKeyHash,           /* hash function */
+    NULL,                        /* key dup */
+    NULL,                        /* val dup */
+    NULL,                        /* key compare */
+    NULL,                        /* key destructor */
+    dictBucketValDestructor      /* val destructor */
+};
+
+unsigned int dictBucketKeyHash(const void *key)
+{
+    return (unsigned int) (size_t) key;
+}
+
+void dictBucketValDestructor(void *privdata, void *val)
+{
+    DICT_NOTUSED(privdata);
+
+    setDestroy((set *) val);
+}
@@ -0,0 +1,48 @@
+// minhash.h - MinHash signatures and LSH banding index.
+
+#ifndef __MINHASH_H__
+#define __MINHASH_H__
+
+#include "dict.h"
+
+#include "athena.h"
+#include "set.h"
+
+#define MINHASH_SIZE 64     // Hash functions per signature.
+#define MINHASH_BANDS 16    // LSH bands, each covers MINHASH_SIZE / MINHASH_BANDS minimums.
+
+// MinHash signature of a set of object ids. Empty set has every minimum at UINT_MAX.
+typedef struct minHash
+{
+    unsigned int mins[MINHASH_SIZE];
+} minHash;
+
+// LSH index. A set is a candidate for another one if they agree on every minimum of some band.
+typedef struct lshIndex
+{
+    dict *buckets[MINHASH_BANDS]; // Band hash -> set of ids.
+} lshIndex;
+
+// Makes h a signature of empty set.
+void minHashInit(minHash *h);
+// Adds id to signature. Returns 1 if signature changed, 0 otherwise.
+int minHashAdd(minHash *h, valType id);
+// Returns 1 if id holds one of the minimums, so removing it requires recomputing the signature.
+int minHashHolds(const minHash *h, valType id);
+// Computes signature of s. Returns -1 on error.
+int minHashFromSet(minHash *h, const set *s);
+// Returns 1 if h is a signature of empty set.
+int minHashIsEmpty(const minHash *h);
+
+// Creates new empty LSH index. Returns NULL on error.
+lshIndex *lshCreate(void);
+// Destroys LSH index.
+void lshDestroy(lshIndex *idx);
+// Adds id with signature h. Signatures of empty sets are not indexed. Returns -1 on error.
+int lshInsert(lshIndex *idx, const minHash *h, valType id);
+// Removes id which was added with signature h.
+void lshRemove(lshIndex *idx, const minHash *h, valType id);
+// Returns set of ids sharing at least one band with h or NULL on error.
+set *lshCandidates(lshIndex *idx, const minHash *h);
+
+#endif /* __MINHASH_H__ */
@@ -0,0 +1,514 @@
+// optimizer.c - Set expression optimizer.
+
+#include <stdlib.h>
+
+#include "adlist.h"
+
+#include "dbengine.h"
+#include "optimizer.h"
+
+static exprNode *optimizeNode(exprNode *node);
+static exprNode *flattenChain(exprNode *node);
+static int chainMergeable(const exprNode *node, size_t i);
+static exprNode *simplifyInter(exprNode *node);
+static exprNode *simplifyUnion(exprNode *node);
+static exprNode *simplifyDiff(exprNode *node);
+static exprNode *simplifySymDiff(exprNode *node);
+static int allChildrenAreSets(const exprNode *node);
+static void removeDuplicateChildren(exprNode *node, size_t from);
+static void removeEmptyChildren(exprNode *node, size_t from);
+static int markCommonSubexpressions(exprNode *root, size_t *cseCount);
+static int collectOperators(exprNode *node, list *operators);
+static int exprIsSet(const exprNode *node);
+static int exprIsEmptySet(const exprNode *node);
+static exprNode *replaceNode(exprNode *node, exprNode *replacement);
+static exprNode *replaceWithEmptySet(exprNode *node);
+static valType saturatingAdd(valType a, valType b);
+static valType saturatingMul(valType a, valType b);
+
+exprNode *optimizeExpr(exprNode *root, size_t *cseCount)
+{
+    exprNode *result = NULL;
+
+    if (NULL == root || NULL == cseCount)
+        return NULL;
+
+    *cseCount = 0;
+
+    if (NULL == (result = optimizeNode(root)))
+        return NULL;
+
+    if (0 != markCommonSubexpressions(result, cseCount))
+    {
+        exprNodeDestroy(result);
+        return NULL;
+    }
+
+    return result;
+}
+
+void optimizerEstimate(const exprNode *node, valType *card, valType *length)
+{
+    valType childCard = 0, childLength = 0;
+    size_t i;
+
+    *card = 0;
+    *length = 0;
+
+    if (NULL == node)
+        return;
+
+    switch (node->nodeType)
+    {
+        case exprSetRef:
+            {
+                const set *s = dbGet(node->name);
+
+                if (NULL != s)
+                {
+                    *card = s->card;
+                    *length = s->length;
+                }
+            }
+            return;
+
+        case exprSetLiteral:
+            *card = node->childrenCount;
+            *length = node->childrenCount;
+            return;
+
+        case exprRangeLiteral:
+            if (node->children[0]->val <= node->children[1]->val)
+                *card = saturatingAdd(node->children[1]->val - node->children[0]->val, 1);
+            *length = *card;
+            return;
+
+        case exprVal:
+        case exprTupleLiteral:
+            return;
+    }
+
+    if (0 == node->childrenCount)
+        return;
+
+    optimizerEstimate(node->children[0], card, length);
+
+    for (i = 1; i < node->childrenCount; i++)
+    {
+        optimizerEstimate(node->children[i], &childCard, &childLength);
+
+        switch (node->oper)
+        {
+            case tokenMultiply:
+                *card = __min(*card, childCard);
+                *length = __min(*length, childLength);
+                break;
+
+            case tokenPlus:
+            case tokenSymDiff:
+                *card = saturatingAdd(*card, childCard);
+                *length = __max(*length, childLength);
+                break;
+
+            case tokenCartProd:
+                *card = saturatingMul(*card, childCard);
+                *length = saturatingMul(*length, childLength);
+                break;
+
+            case tokenMinus:
+                break;
+        }
+    }
+
+    if (tokenBoolean == node->oper)
+    {
+        valType c = *card;
+
+        *card = 1;
+        while (c-- && *card < (valType) -1 / 2)
+            *card <<= 1;
+
+        *length = *card / 8 + 1;
+    }
+}
+
+int optimizerShouldPushInter(const exprNode *node, valType accLength)
+{
+    valType card, length, total = 0;
+    size_t i;
+
+    if (NULL == node || exprOperator != node->nodeType || 0 == node->childrenCount)
+        return 0;
+
+    switch (node->oper)
+    {
+        case tokenPlus:
+            // Materialized union touches every child bitmap, pushed down one reads at most accLength per child.
+            for (i = 0; i < node->childrenCount; i++)
+            {
+                optimizerEstimate(node->children[i], &card, &length);
+                total = saturatingAdd(total, length);
+            }
+
+            return total > saturatingMul(accLength, node->childrenCount);
+
+        case tokenMinus:
+            // Difference copies its minuend.
+            optimizerEstimate(node->children[0], &card, &length);
+            return length > accLength;
+    }
+
+    return 0;
+}
+
+// Private api.
+// Returns optimized node which replaces node or NULL on error.
+static exprNode *optimizeNode(exprNode *node)
+{
+    size_t i;
+
+    for (i = 0; i < node->childrenCount; i++)
+    {
+        exprNode *child = optimizeNode(node->children[i]);
+
+        if (NULL == child)
+        {
+            node->children[i] = NULL;
+            exprNodeDestroy(node);
+            return NULL;
+        }
+
+        node->children[i] = child;
+    }
+
+    if (exprOperator != node->nodeType)
+        return node;
+
+    switch (node->oper)
+    {
+        case tokenMultiply:
+            if (NULL == (node = flattenChain(node)))
+                return NULL;
+
+            return simplifyInter(node);
+
+        case tokenPlus:
+            if (NULL == (node = flattenChain(node)))
+                return NULL;
+
+            return simplifyUnion(node);
+
+        case tokenMinus:
+            if (NULL == (node = flattenChain(node)))
+                return NULL;
+
+            return simplifyDiff(node);
+
+        case tokenSymDiff:
+            return simplifySymDiff(node);
+    }
+
+    return node;
+}
+
+// Returns 1 if child i of node can be merged into node's chain.
+// A - B - C is (A - B) - C, so only the minuend of a difference is merged.
+static int chainMergeable(const exprNode *node, size_t i)
+{
+    return exprOperator == node->children[i]->nodeType &&
+           node->oper == node->children[i]->oper &&
+           (tokenMinus != node->oper || 0 == i);
+}
+
+// Merges children which continue the operator chain into node, so A * B * C
+// becomes one n-ary node. Returns NULL on error.
+static exprNode *flattenChain(exprNode *node)
+{
+    exprNode **children = NULL;
+    size_t count = 0, i, j;
+
+    for (i = 0; i < node->childrenCount; i++)
+    {
+        exprNode *child = node->children[i];
+
+        if (chainMergeable(node, i))
+            count += child->childrenCount;
+        else
+            count++;
+    }
+
+    if (count == node->childrenCount)
+        return node;
+
+    if (NULL == (children = (exprNode **) calloc(count, sizeof(exprNode *))))
+    {
+        exprNodeDestroy(node);
+        return NULL;
+    }
+
+    count = 0;
+    for (i = 0; i < node->childrenCount; i++)
+    {
+        exprNode *child = node->children[i];
+
+        if (chainMergeable(node, i))
+        {
+            for (j = 0; j < child->childrenCount; j++)
+                children[count++] = child->children[j];
+
+            child->childrenCount = 0;
+            exprNodeDestroy(child);
+        }
+        else
+        {
+            children[count++] = child;
+        }
+    }
+
+    free(node->children);
+    node->children = children;
+    node->childrenCount = count;
+    return node;
+}
+
+// X * X = X, X * {} = {}.
+static exprNode *simplifyInter(exprNode *node)
+{
+    size_t i;
+
+    if (!allChildrenAreSets(node))
+        return node;
+
+    for (i = 0; i < node->childrenCount; i++)
+        if (exprIsEmptySet(node->children[i]))
+            return replaceWithEmptySet(node);
+
+    removeDuplicateChildren(node, 0);
+
+    if (1 == node->childrenCount)
+        return replaceNode(node, node->children[0]);
+
+    return node;
+}
+
+// X + X = X, X + {} = X.
+static exprNode *simplifyUnion(exprNode *node)
+{
+    if (!allChildrenAreSets(node))
+        return node;
+
+    removeEmptyChildren(node, 0);
+    removeDuplicateChildren(node, 0);
+
+    if (0 == node->childrenCount)
+        return replaceWithEmptySet(node);
+
+    if (1 == node->childrenCount)
+        return replaceNode(node, node->children[0]);
+
+    return node;
+}
+
+// X - X = {}, {} - X = {}, X - {} = X, X - Y - Y = X - Y.
+static exprNode *simplifyDiff(exprNode *node)
+{
+    size_t i;
+
+    if (!allChildrenAreSets(node))
+        return node;
+
+    if (exprIsEmptySet(node->children[0]))
+        return replaceWithEmptySet(node);
+
+    for (i = 1; i < node->childrenCount; i++)
+        if (exprNodeEqual(node->children[0], node->children[i]))
+            return replaceWithEmptySet(node);
+
+    removeEmptyChildren(node, 1);
+    removeDuplicateChildren(node, 1);
+
+    if (1 == node->childrenCount)
+        return replaceNode(node, node->children[0]);
+
+    return node;
+}
+
+// X ~ X = {}, X ~ {} = X.
+static exprNode *simplifySymDiff(exprNode *node)
+{
+    exprNode *left = NULL, *right = NULL;
+
+    if (2 != node->childrenCount || !allChildrenAreSets(node))
+        return node;
+
+    left = node->children[0];
+    right = node->children[1];
+
+    if (exprNodeEqual(left, right))
+        return replaceWithEmptySet(node);
+
+    if (exprIsEmptySet(right))
+        return replaceNode(node, left);
+
+    if (exprIsEmptySet(left))
+        return replaceNode(node, right);
+
+    return node;
+}
+
+static int allChildrenAreSets(const exprNode *node)
+{
+    size_t i;
+
+    for (i = 0; i < node->childrenCount; i++)
+        if (!exprIsSet(node->children[i]))
+            return 0;
+
+    return 1;
+}
+
+// Drops children starting from index from which repeat an earlier one. Order of children
+// past from isn't kept, all operators using this are commutative there.
+static void removeDuplicateChildren(exprNode *node, size_t from)
+{
+    size_t i, j;
+
+    for (i = from; i < node->childrenCount; i++)
+    {
+        j = i + 1;
+        while (j < node->childrenCount)
+        {
+            if (exprNodeEqual(node->children[i], node->children[j]))
+            {
+                exprNodeDestroy(node->children[j]);
+                node->children[j] = node->children[--node->childrenCount];
+            }
+            else
+            {
+                j++;
+            }
+        }
+    }
+}
+
+// Drops {} children starting from index from.
+static void removeEmptyChildren(exprNode *node, size_t from)
+{
+    size_t i = from;
+
+    while (i < node->childrenCount)
+    {
+        if (exprIsEmptySet(node->children[i]))
+        {
+            exprNodeDestroy(node->children[i]);
+            node->children[i] = node->children[--node->childrenCount];
+        }
+        else
+        {
+            i++;
+        }
+    }
+}
+
+// Gives equal operator subtrees the same non-zero cseId. Returns -1 on error.
+static int markCommonSubexpressions(exprNode *root, size_t *cseCount)
+{
+    list *operators = NULL;
+    listNode *i = NULL, *j = NULL;
+
+    if (NULL == (operators = listCreate()))
+        return -1;
+
+    if (0 != collectOperators(root, operators))
+    {
+        listRelease(operators);
+        return -1;
+    }
+
+    for (i = listFirst(operators); NULL != i; i = listNextNode(i))
+    {
+        exprNode *a = (exprNode *) listNodeValue(i);
+
+        if (0 != a->cseId)
+            continue;
+
+        for (j = listNextNode(i); NULL != j; j = listNextNode(j))
+        {
+            exprNode *b = (exprNode *) listNodeValue(j);
+
+            if (0 == b->cseId && exprNodeEqual(a, b))
+            {
+                if (0 == a->cseId)
+                    a->cseId = ++*cseCount;
+
+                b->cseId = a->cseId;
+            }
+        }
+    }
+
+    listRelease(operators);
+    return 0;
+}
+
+// Returns -1 on error.
+static int collectOperators(exprNode *node, list *operators)
+{
+    size_t i;
+
+    if (exprOperator == node->nodeType && NULL == listAddNodeTail(operators, node))
+        return -1;
+
+    for (i = 0; i < node->childrenCount; i++)
+        if (0 != collectOperators(node->children[i], operators))
+            return -1;
+
+    return 0;
+}
+
+// Named sets and every operator produce sets, so they are safe to fold.
+static int exprIsSet(const exprNode *node)
+{
+    return exprSetRef == node->nodeType ||
+           exprSetLiteral == node->nodeType ||
+           exprRangeLiteral == node->nodeType ||
+           exprOperator == node->nodeType;
+}
+
+static int exprIsEmptySet(const exprNode *node)
+{
+    return exprSetLiteral == node->nodeType && 0 == node->childrenCount;
+}
+
+// Destroys node except for replacement, which is one of its children. Returns replacement.
+static exprNode *replaceNode(exprNode *node, exprNode *replacement)
+{
+    size_t i;
+
+    for (i = 0; i < node->childrenCount; i++)
+        if (replacement != node->children[i])
+            exprNodeDestroy(node->children[i]);
+
+    node->childrenCount = 0;
+    exprNodeDestroy(node);
+    return replacement;
+}
+
+// Destroys node and returns empty set literal in its place or NULL on error.
+static exprNode *replaceWithEmptySet(exprNode *node)
+{
+    exprNodeDestroy(node);
+    return exprNodeCreate(exprSetLiteral);
+}
+
+static valType saturatingAdd(valType a, valType b)
+{
+    return a + b < a ? (valType) -1 : a + b;
+}
+
+static valType saturatingMul(valType a, valType b)
+{
+    if (0 != a && b > (valType) -1 / a)
+        return (valType) -1;
+
+    return a * b;
+}
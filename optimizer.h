@@ -0,0 +1,22 @@
+// optimizer.h - Set expression optimizer.
+
+#ifndef __OPTIMIZER_H__
+#define __OPTIMIZER_H__
+
+#include "athena.h"
+#include "plan.h"
+
+// Rewrites compiled expression: flattens *, + and - chains into n-ary nodes, drops no-op operations
+// (X * X, X + X, X - X, X ~ X, operations with {}) and marks common subexpressions.
+// Sets *cseCount to number of distinct common subexpressions.
+// Returns new root (root itself may be destroyed) or NULL on error.
+exprNode *optimizeExpr(exprNode *root, size_t *cseCount);
+
+// Estimates result cardinality and bitmap length in bytes of expression using current set sizes.
+void optimizerEstimate(const exprNode *node, valType *card, valType *length);
+
+// Returns 1 if pushing intersection with a set of acc bytes below node is cheaper than
+// materializing node first, 0 otherwise.
+int optimizerShouldPushInter(const exprNode *node, valType accLength);
+
+#endif /* __OPTIMIZER_H__ */
@@ -0,0 +1,357 @@
+// plan.c - Compiled expression plans and plan cache.
+
+#include <stdlib.h>
+#include <memory.h>
+#include <ctype.h>
+
+#include "adlist.h"
+#include "dict.h"
+#include "sds.h"
+
+#include "syncengine.h"
+#include "plan.h"
+
+static dict *planCache;
+static list *planLru; // Most recently used plans are at head.
+
+static dictType dictPlanType;
+
+static void planDestroy(plan *p);
+static void planLruTouch(listNode *node);
+static void planCacheEvict(void);
+
+exprNode *exprNodeCreate(exprNodeType nodeType)
+{
+    exprNode *node = (exprNode *) calloc(1, sizeof(exprNode));
+
+    if (node)
+    {
+        node->nodeType = nodeType;
+    }
+
+    return node;
+}
+
+int exprNodeAddChild(exprNode *parent, exprNode *child)
+{
+    exprNode **t = NULL;
+
+    if (NULL == parent || NULL == child)
+        return -1;
+
+    if (NULL == (t = (exprNode **) realloc(parent->children, (parent->childrenCount + 1) * sizeof(exprNode *))))
+        return -1;
+
+    t[parent->childrenCount++] = child;
+    parent->children = t;
+    return 0;
+}
+
+void exprNodeDestroy(exprNode *node)
+{
+    size_t i;
+
+    if (NULL == node)
+        return;
+
+    for (i = 0; i < node->childrenCount; i++)
+        exprNodeDestroy(node->children[i]);
+
+    if (NULL != node->name)
+        sdsfree(node->name);
+
+    free(node->children);
+    free(node);
+}
+
+int exprNodeEqual(const exprNode *a, const exprNode *b)
+{
+    size_t i;
+
+    if (NULL == a || NULL == b)
+        return 0;
+
+    if (a == b)
+        return 1;
+
+    if (a->nodeType != b->nodeType ||
+        a->childrenCount != b->childrenCount)
+    {
+        return 0;
+    }
+
+    switch (a->nodeType)
+    {
+        case exprSetRef:
+            if (sdslen(a->name) != sdslen(b->name) ||
+                0 != memcmp(a->name, b->name, sdslen(a->name)))
+            {
+                return 0;
+            }
+            break;
+
+        case exprVal:
+            if (a->val != b->val)
+                return 0;
+            break;
+
+        case exprOperator:
+            if (a->oper != b->oper)
+                return 0;
+            break;
+    }
+
+    for (i = 0; i < a->childrenCount; i++)
+        if (!exprNodeEqual(a->children[i], b->children[i]))
+            return 0;
+
+    return 1;
+}
+
+int initPlanCache(void)
+{
+    if (NULL == (planCache = dictCreate(&dictPlanType, NULL)))
+        return -1;
+
+    if (NULL == (planLru = listCreate()))
+    {
+        dictRelease(planCache);
+        return -1;
+    }
+
+    if (0 != registerSyncObject(planCache))
+    {
+        listRelease(planLru);
+        dictRelease(planCache);
+        return -1;
+    }
+
+    return 0;
+}
+
+void cleanupPlanCache(void)
+{
+    listIter *iter = NULL;
+    listNode *node = NULL;
+
+    if (NULL == planCache)
+        return;
+
+    unregisterSyncObject(planCache);
+
+    if (NULL != (iter = listGetIterator(planLru, AL_START_HEAD)))
+    {
+        while (NULL != (node = listNext(iter)))
+            planDestroy((plan *) listNodeValue(node));
+
+        listReleaseIterator(iter);
+    }
+
+    listRelease(planLru);
+    dictRelease(planCache);
+    planCache = NULL;
+    planLru = NULL;
+}
+
+sds planNormalize(const char *s, size_t len)
+{
+    sds result = NULL;
+    size_t i;
+    char prev = 0;
+    int pendingSpace = 0;
+
+    if (NULL == s || NULL == (result = sdsempty()))
+        return NULL;
+
+    for (i = 0; i < len && '\0' != s[i]; i++)
+    {
+        if (isspace((unsigned char) s[i]))
+        {
+            pendingSpace = 1;
+            continue;
+        }
+
+        // Keep single space only where dropping it would glue two tokens together.
+        if (pendingSpace && isalnum((unsigned char) prev) && isalnum((unsigned char) s[i]))
+            result = sdscatlen(result, " ", 1);
+
+        if (NULL == (result = sdscatlen(result, (void *) &s[i], 1)))
+            return NULL;
+
+        pendingSpace = 0;
+        prev = s[i];
+    }
+
+    return result;
+}
+
+plan *planCacheGet(const sds key)
+{
+    plan *result = NULL;
+
+    if (NULL == key || NULL == planCache)
+        return NULL;
+
+    lockWrite(planCache);
+    if (NULL != (result = (plan *) dictFetchValue(planCache, key)))
+    {
+        planLruTouch(result->lruNode);
+        result->refs++;
+    }
+    unlockWrite(planCache);
+
+    return result;
+}
+
+plan *planCacheAdd(const sds key, exprNode *root, size_t cseCount)
+{
+    plan *result = NULL;
+
+    if (NULL == key || NULL == root || NULL == planCache)
+        return NULL;
+
+    lockWrite(planCache);
+
+    if (NULL != (result = (plan *) dictFetchValue(planCache, key)))
+    {
+        planLruTouch(result->lruNode);
+        result->refs++;
+        unlockWrite(planCache);
+        exprNodeDestroy(root);
+        return result;
+    }
+
+    while (dictSize(planCache) >= PLAN_CACHE_SIZE)
+        planCacheEvict();
+
+    if (NULL == (result = (plan *) calloc(1, sizeof(plan))))
+    {
+        unlockWrite(planCache);
+        return NULL;
+    }
+
+    if (NULL == (result->key = sdsnewlen(key, sdslen(key))))
+    {
+        unlockWrite(planCache);
+        free(result);
+        return NULL;
+    }
+
+    if (NULL == listAddNodeHead(planLru, result))
+    {
+        unlockWrite(planCache);
+        sdsfree(result->key);
+        free(result);
+        return NULL;
+    }
+
+    if (DICT_OK != dictAdd(planCache, result->key, result))
+    {
+        listDelNode(planLru, listFirst(planLru));
+        unlockWrite(planCache);
+        sdsfree(result->key);
+        free(result);
+        return NULL;
+    }
+
+    result->root = root;
+    result->cseCount = cseCount;
+    result->lruNode = listFirst(planLru);
+    result->refs = 2; // One for cache, one for caller.
+
+    unlockWrite(planCache);
+    return result;
+}
+
+void planRelease(plan *p)
+{
+    unsigned refs;
+
+    if (NULL == p)
+        return;
+
+    lockWrite(planCache);
+    refs = --p->refs;
+    unlockWrite(planCache);
+
+    if (0 == refs)
+        planDestroy(p);
+}
+
+// Private api.
+// Must be called with planCache locked for writing.
+static void planCacheEvict(void)
+{
+    listNode *victimNode = listLast(planLru);
+    plan *victim = NULL;
+
+    if (NULL == victimNode)
+        return;
+
+    victim = (plan *) listNodeValue(victimNode);
+    dictDelete(planCache, victim->key);
+    listDelNode(planLru, victimNode);
+    victim->lruNode = NULL;
+
+    if (0 == --victim->refs)
+        planDestroy(victim);
+}
+
+// Moves node to the head of LRU list without reallocation.
+// Must be called with planCache locked for writing.
+static void planLruTouch(listNode *node)
+{
+    if (NULL == node || listFirst(planLru) == node)
+        return;
+
+    node->prev->next = node->next;
+    if (node->next)
+        node->next->prev = node->prev;
+    else
+        planLru->tail = node->prev;
+
+    node->prev = NULL;
+    node->next = planLru->head;
+    planLru->head->prev = node;
+    planLru->head = node;
+}
+
+static void planDestroy(plan *p)
+{
+    if (NULL == p)
+        return;
+
+    exprNodeDestroy(p->root);
+    sdsfree(p->key);
+    free(p);
+}
+
+unsigned int dictPlanKeyHash(const void *key);
+int dictPlanKeyCompare(void *privdata, const void *key1, const void *key2);
+
+/* Plan cache, keys are normalized expressions owned by plans. */
+static dictType dictPlanType =
+{
+    dictPlanKeyHash,             /* hash function */
+    NULL,                        /* key dup */
+    NULL,                        /* val dup */
+    dictPlanKeyCompare,          /* key compare */
+    NULL,                        /* key destructor */
+    NULL                         /* val destructor */
+};
+
+unsigned int dictPlanKeyHash(const void *key)
+{
+    return dictGenHashFunction((unsigned char *) key, sdslen((sds) key));
+}
+
+int dictPlanKeyCompare(void *privdata, const void *key1, const void *key2)
+{
+    size_t l1, l2;
+    DICT_NOTUSED(privdata);
+
+    l1 = sdslen((sds) key1);
+    l2 = sdslen((sds) key2);
+    if (l1 != l2) return 0;
+    return memcmp(key1, key2, l1) == 0;
+}
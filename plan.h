@@ -0,0 +1,67 @@
+// plan.h - Compiled expression plans and plan cache.
+
+#ifndef __PLAN_H__
+#define __PLAN_H__
+
+#include "adlist.h"
+#include "sds.h"
+
+#include "athena.h"
+#include "tokenizer.h"
+
+#define PLAN_CACHE_SIZE 1024
+
+// Expression tree node.
+typedef enum exprNodeType
+{
+    exprSetRef, exprVal, exprSetLiteral, exprTupleLiteral, exprOperator,
+    exprRangeLiteral    // {from..to}, children are the two bounds.
+} exprNodeType;
+
+typedef struct exprNode
+{
+    exprNodeType nodeType;
+    tokenType oper;     // Operator nodes only.
+    sds name;           // Set references only.
+    valType val;        // Values only.
+    struct exprNode **children;
+    size_t childrenCount;
+    size_t cseId;       // Non-zero if the same subexpression occurs more than once in the query.
+} exprNode;
+
+// Compiled expression plan. Plans are immutable once cached and shared between clients.
+typedef struct plan
+{
+    exprNode *root;
+    size_t cseCount;
+    sds key;
+    listNode *lruNode;
+    unsigned refs;
+} plan;
+
+// Creates new expression node. Returns NULL on error.
+exprNode *exprNodeCreate(exprNodeType nodeType);
+// Appends child to parent. Returns -1 on error.
+int exprNodeAddChild(exprNode *parent, exprNode *child);
+// Destroys node and all its children.
+void exprNodeDestroy(exprNode *node);
+// Returns 1 if a and b are structurally equal expressions, 0 otherwise.
+int exprNodeEqual(const exprNode *a, const exprNode *b);
+
+// Returns 0 on ok, -1 on error.
+int initPlanCache(void);
+void cleanupPlanCache(void);
+
+// Returns normalized expression text used as plan cache key or NULL on error.
+// Whitespace is dropped unless it separates two identifier or value characters.
+sds planNormalize(const char *s, size_t len);
+
+// Returns cached plan for key with a reference taken or NULL if there is no such plan.
+plan *planCacheGet(const sds key);
+// Caches root with cseCount common subexpressions under key. If plan for key is already cached, root is destroyed and cached plan is used.
+// Returns plan with a reference taken or NULL on error.
+plan *planCacheAdd(const sds key, exprNode *root, size_t cseCount);
+// Drops reference taken by planCacheGet or planCacheAdd.
+void planRelease(plan *p);
+
+#endif /* __PLAN_H__ */
@@ -0,0 +1,211 @@
+// powerset.c - Lazy power set.
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "athena.h"
+#include "dbengine.h"
+#include "dbobject.h"
+#include "powerset.h"
+
+powerSet *powerSetCreate(const set *base)
+{
+    powerSet *ps = NULL;
+
+    if (NULL == base)
+        return NULL;
+
+    if (NULL == (ps = (powerSet *) calloc(1, sizeof(powerSet))))
+        return NULL;
+
+    if (NULL == (ps->base = setCopy(base)))
+    {
+        free(ps);
+        return NULL;
+    }
+
+    return ps;
+}
+
+void powerSetDestroy(powerSet *ps)
+{
+    if (NULL == ps)
+        return;
+
+    setDestroy(ps->base);
+    free(ps);
+}
+
+int powerSetCmp(const powerSet *a, const powerSet *b)
+{
+    if (NULL == a || NULL == b)
+        return -1;
+
+    return setCmpE(a->base, b->base);
+}
+
+int powerSetCard(valType baseCard, valType *card)
+{
+    if (NULL == card || baseCard >= sizeof(valType) * 8)
+        return -1;
+
+    *card = (valType) 1 << baseCard;
+    return 0;
+}
+
+int powerSetIsMember(const set *base, const set *s)
+{
+    return setCmpSubset(s, base);
+}
+
+set *powerSetInter(const set *base, const set *s, int lock)
+{
+    setIterator *iter = NULL;
+    set *result = NULL;
+
+    if (NULL == base || NULL == s)
+        return NULL;
+
+    if (NULL == (result = setCreate()))
+        return NULL;
+
+    if (0 != setGetIter(s, &iter))
+    {
+        setDestroy(result);
+        return NULL;
+    }
+
+    if (NULL == iter)
+        return result;
+
+    while (0 == setGetNext(iter))
+    {
+        const dbObject *obj = dbGetObject(iter->val, lock);
+
+        if (NULL == obj || objectSet != obj->objectType ||
+            1 != powerSetIsMember(base, obj->objectPtr.setPtr))
+        {
+            continue;
+        }
+
+        if (-1 == setAdd(result, iter->val))
+        {
+            setDestroyIter(iter);
+            setDestroy(result);
+            return NULL;
+        }
+    }
+
+    setDestroyIter(iter);
+    return result;
+}
+
+set *powerSetFlatten(const powerSet *ps, int lock)
+{
+    if (NULL == ps)
+        return NULL;
+
+    return setFlatten(ps->base, lock);
+}
+
+set *powerSetMaterialize(const powerSet *ps)
+{
+    if (NULL == ps)
+        return NULL;
+
+    return setBoolean(ps->base);
+}
+
+int powerSetPrint(const powerSet *ps, reply *r, int lock)
+{
+    setIterator *iter = NULL;
+    valType *members = NULL, n = 0, card = 0, k, i;
+    const dbObject **objects = NULL;
+    char *included = NULL;
+    int result = 0;
+
+    if (NULL == ps || NULL == r || 0 != powerSetCard(ps->base->card, &card))
+        return -1;
+
+    if (NULL == (members = (valType *) calloc(ps->base->card + 1, sizeof(valType))))
+        return -1;
+
+    if (NULL == (included = (char *) calloc(ps->base->card + 1, sizeof(char))))
+    {
+        free(members);
+        return -1;
+    }
+
+    if (0 != setGetIter(ps->base, &iter))
+    {
+        free(included);
+        free(members);
+        return -1;
+    }
+
+    while (NULL != iter && 0 == setGetNext(iter))
+        members[n++] = iter->val;
+
+    setDestroyIter(iter);
+
+    // Members are resolved once, every subset prints them from this array.
+    if (NULL == (objects = (const dbObject **) calloc(n + 1, sizeof(const dbObject *))))
+    {
+        free(included);
+        free(members);
+        return -1;
+    }
+
+    dbGetObjects(members, n, objects, lock);
+
+    result = replyWrite(r, "{ ", 2);
+
+    // Subset k is gray(k) = k ^ (k >> 1), step k flips member number ctz(k).
+    // Stops at the first failed write, there is nobody left to read the rest.
+    for (k = 0; k < card && 0 == result; k++)
+    {
+        valType counter = 0, size = 0;
+
+        if (0 != k)
+        {
+            for (i = 0; 0 == (k >> i & 1); i++);
+            included[i] = !included[i];
+        }
+
+        for (i = 0; i < n; i++)
+            size += included[i];
+
+        result |= replyStr(r, "{ ");
+
+        for (i = 0; i < n && 0 == result; i++)
+        {
+            if (!included[i])
+                continue;
+
+            if (NULL != objects[i])
+                result |= replyObject(r, objects[i], lock);
+            else
+                result |= replyStr(r, "(null)");
+
+            counter++;
+            if (counter < size)
+                result |= replyStr(r, ",");
+
+            result |= replyStr(r, " ");
+        }
+
+        result |= replyStr(r, "}");
+
+        if (k + 1 < card)
+            result |= replyStr(r, ",");
+
+        result |= replyStr(r, " ");
+    }
+
+    result |= replyStr(r, "}");
+
+    free(objects);
+    free(included);
+    free(members);
+    return 0 == result ? 0 : -1;
+}
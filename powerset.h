@@ -0,0 +1,40 @@
+// powerset.h - Lazy power set.
+
+#ifndef __POWERSET_H__
+#define __POWERSET_H__
+
+#include <stdio.h>
+
+#include "athena.h"
+#include "set.h"
+#include "reply.h"
+
+// Power set of base. Subsets are never stored, they are enumerated on demand.
+typedef struct powerSet
+{
+    set *base;
+} powerSet;
+
+// Creates power set of a copy of base. Returns NULL on error.
+powerSet *powerSetCreate(const set *base);
+// Destroys power set.
+void powerSetDestroy(powerSet *ps);
+
+// Compares given power sets. Returns 1 on eq, 0 on not eq, -1 on error.
+int powerSetCmp(const powerSet *a, const powerSet *b);
+// Sets *card to cardinality of power set of a set with baseCard members. Returns -1 if it doesn't fit in valType.
+int powerSetCard(valType baseCard, valType *card);
+// Returns 1 if s is a member of power set of base, i.e. s is a subset of base, 0 otherwise, -1 on error.
+int powerSetIsMember(const set *base, const set *s);
+// Returns set of members of s which are members of power set of base or NULL on error.
+set *powerSetInter(const set *base, const set *s, int lock);
+// Returns flattened power set or NULL on error.
+set *powerSetFlatten(const powerSet *ps, int lock);
+// Builds and registers every subset. Returns set of subset ids or NULL on error.
+set *powerSetMaterialize(const powerSet *ps);
+
+// Prints subsets in Gray code order, each one differs from the previous by one member.
+// Stops at the first failed write. Returns -1 on error.
+int powerSetPrint(const powerSet *ps, reply *r, int lock);
+
+#endif /* __POWERSET_H__ */
@@ -0,0 +1,625 @@
+// relation.c - Binary relations as row-oriented bit matrices.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <memory.h>
+
+#include "adlist.h"
+
+#include "athena.h"
+#include "dbengine.h"
+#include "dbobject.h"
+#include "tuple.h"
+#include "relation.h"
+
+static set *relationRow(relation *r, valType x);
+static int relationSetRow(relation *r, valType x, set *row);
+
+relation *relationCreate(void)
+{
+    return (relation *) calloc(1, sizeof(relation));
+}
+
+relation *relationCopy(const relation *r)
+{
+    relation *result = NULL;
+    valType x;
+
+    if (NULL == r || NULL == (result = relationCreate()))
+        return NULL;
+
+    for (x = 0; x < r->rowsCount; x++)
+    {
+        set *row = NULL;
+
+        if (0 == setCard(r->rows[x]))
+            continue;
+
+        if (NULL == (row = setCopy(r->rows[x])) ||
+            0 != relationSetRow(result, x, row))
+        {
+            setDestroy(row);
+            relationDestroy(result);
+            return NULL;
+        }
+    }
+
+    return result;
+}
+
+void relationDestroy(relation *r)
+{
+    valType x;
+
+    if (NULL == r)
+        return;
+
+    for (x = 0; x < r->rowsCount; x++)
+        setDestroy(r->rows[x]);
+
+    free(r->rows);
+    free(r);
+}
+
+int relationAdd(relation *r, valType x, valType y)
+{
+    set *row = NULL;
+    int result;
+
+    if (NULL == r || NULL == (row = relationRow(r, x)))
+        return -1;
+
+    if (0 == (result = setAdd(row, y)))
+        r->card++;
+
+    return result;
+}
+
+int relationRemove(relation *r, valType x, valType y)
+{
+    int result;
+
+    if (NULL == r)
+        return -1;
+
+    if (x >= r->rowsCount || NULL == r->rows[x])
+        return 1;
+
+    if (0 == (result = setRemove(r->rows[x], y)))
+        r->card--;
+
+    return result;
+}
+
+int relationIsMember(const relation *r, valType x, valType y)
+{
+    if (NULL == r || x >= r->rowsCount || NULL == r->rows[x])
+        return 0;
+
+    return setIsMember(r->rows[x], y);
+}
+
+int relationCmp(const relation *a, const relation *b)
+{
+    valType x;
+
+    if (NULL == a || NULL == b)
+        return -1;
+
+    if (a->card != b->card)
+        return 0;
+
+    for (x = 0; x < __max(a->rowsCount, b->rowsCount); x++)
+    {
+        const set *rowA = x < a->rowsCount ? a->rows[x] : NULL;
+        const set *rowB = x < b->rowsCount ? b->rows[x] : NULL;
+
+        if (setCard(rowA) != setCard(rowB))
+            return 0;
+
+        if (0 != setCard(rowA) && 1 != setCmpE(rowA, rowB))
+            return 0;
+    }
+
+    return 1;
+}
+
+relation *relationFromCartProd(const set *a, const set *b)
+{
+    relation *result = NULL;
+    setIterator *iter = NULL;
+
+    if (NULL == a || NULL == b || NULL == (result = relationCreate()))
+        return NULL;
+
+    if (0 == b->card)
+        return result;
+
+    if (0 != setGetIter(a, &iter))
+    {
+        relationDestroy(result);
+        return NULL;
+    }
+
+    while (NULL != iter && 0 == setGetNext(iter))
+    {
+        if (NULL == relationRow(result, iter->val))
+        {
+            setDestroyIter(iter);
+            relationDestroy(result);
+            return NULL;
+        }
+
+        setDestroy(result->rows[iter->val]);
+
+        if (NULL == (result->rows[iter->val] = setCopy(b)))
+        {
+            setDestroyIter(iter);
+            relationDestroy(result);
+            return NULL;
+        }
+
+        result->card += b->card;
+    }
+
+    setDestroyIter(iter);
+    return result;
+}
+
+relation *relationFromTuples(const set *s, int lock)
+{
+    relation *result = NULL;
+    setIterator *iter = NULL;
+
+    if (NULL == s || NULL == (result = relationCreate()))
+        return NULL;
+
+    if (0 != setGetIter(s, &iter))
+    {
+        relationDestroy(result);
+        return NULL;
+    }
+
+    while (NULL != iter && 0 == setGetNext(iter))
+    {
+        const dbObject *obj = dbGetObject(iter->val, lock);
+        list *t = NULL;
+
+        if (NULL == obj || objectTuple != obj->objectType ||
+            2 != listLength(t = obj->objectPtr.tuplePtr))
+        {
+            continue;
+        }
+
+        if (-1 == relationAdd(result, (valType) listNodeValue(listFirst(t)), (valType) listNodeValue(listLast(t))))
+        {
+            setDestroyIter(iter);
+            relationDestroy(result);
+            return NULL;
+        }
+    }
+
+    setDestroyIter(iter);
+    return result;
+}
+
+relation *relationCompose(const relation *r, const relation *s)
+{
+    relation *result = NULL;
+    const set **rows = NULL, **t = NULL;
+    setIterator *iter = NULL;
+    valType x;
+    size_t count;
+
+    if (NULL == r || NULL == s || NULL == (result = relationCreate()))
+        return NULL;
+
+    // Row x of the result is the union of rows y of s for every y in row x of r.
+    for (x = 0; x < r->rowsCount; x++)
+    {
+        if (0 == setCard(r->rows[x]))
+            continue;
+
+        if (NULL == (t = (const set **) realloc((void *) rows, r->rows[x]->card * sizeof(set *))))
+        {
+            free((void *) rows);
+            relationDestroy(result);
+            return NULL;
+        }
+
+        rows = t;
+
+        if (0 != setGetIter(r->rows[x], &iter))
+        {
+            free((void *) rows);
+            relationDestroy(result);
+            return NULL;
+        }
+
+        count = 0;
+        while (NULL != iter && 0 == setGetNext(iter))
+        {
+            if (iter->val < s->rowsCount && 0 != setCard(s->rows[iter->val]))
+                rows[count++] = s->rows[iter->val];
+        }
+
+        setDestroyIter(iter);
+
+        if (0 == count)
+            continue;
+
+        if (NULL == relationRow(result, x))
+        {
+            free((void *) rows);
+            relationDestroy(result);
+            return NULL;
+        }
+
+        setDestroy(result->rows[x]);
+
+        if (NULL == (result->rows[x] = setUnionN(rows, count)))
+        {
+            free((void *) rows);
+            relationDestroy(result);
+            return NULL;
+        }
+
+        result->card += result->rows[x]->card;
+    }
+
+    free((void *) rows);
+    return result;
+}
+
+relation *relationClosure(const relation *r)
+{
+    relation *result = NULL, *delta = NULL, *next = NULL, *newDelta = NULL;
+    valType x;
+    int failed = 0;
+
+    if (NULL == r)
+        return NULL;
+
+    if (NULL == (result = relationCopy(r)))
+        return NULL;
+
+    if (NULL == (delta = relationCopy(r)))
+    {
+        relationDestroy(result);
+        return NULL;
+    }
+
+    while (0 != delta->card && !failed)
+    {
+        // Only paths extended by the last round can produce new pairs.
+        if (NULL == (next = relationCompose(delta, r)) ||
+            NULL == (newDelta = relationCreate()))
+        {
+            relationDestroy(next);
+            relationDestroy(delta);
+            relationDestroy(result);
+            return NULL;
+        }
+
+        // Pairs not seen before become the next delta, rows move there without copying.
+        for (x = 0; x < next->rowsCount; x++)
+        {
+            set *fresh = next->rows[x];
+
+            if (0 == setCard(fresh))
+                continue;
+
+            if (x < result->rowsCount && NULL != result->rows[x])
+                setSubtract(fresh, result->rows[x]);
+
+            if (0 == fresh->card)
+                continue;
+
+            if (NULL == relationRow(result, x) ||
+                0 != setMerge(result->rows[x], fresh))
+            {
+                failed = 1;
+                break;
+            }
+
+            result->card += fresh->card;
+            next->rows[x] = NULL;
+
+            if (0 != relationSetRow(newDelta, x, fresh))
+            {
+                setDestroy(fresh);
+                failed = 1;
+                break;
+            }
+        }
+
+        relationDestroy(next);
+        relationDestroy(delta);
+        delta = newDelta;
+    }
+
+    relationDestroy(delta);
+
+    if (failed)
+    {
+        relationDestroy(result);
+        return NULL;
+    }
+
+    return result;
+}
+
+relation *relationInverse(const relation *r)
+{
+    relation *result = NULL;
+    setIterator *iter = NULL;
+    valType x;
+
+    if (NULL == r || NULL == (result = relationCreate()))
+        return NULL;
+
+    for (x = 0; x < r->rowsCount; x++)
+    {
+        if (0 == setCard(r->rows[x]))
+            continue;
+
+        if (0 != setGetIter(r->rows[x], &iter))
+        {
+            relationDestroy(result);
+            return NULL;
+        }
+
+        while (NULL != iter && 0 == setGetNext(iter))
+        {
+            if (-1 == relationAdd(result, iter->val, x))
+            {
+                setDestroyIter(iter);
+                relationDestroy(result);
+                return NULL;
+            }
+        }
+
+        setDestroyIter(iter);
+    }
+
+    return result;
+}
+
+set *relationDomain(const relation *r)
+{
+    set *result = NULL;
+    valType x;
+
+    if (NULL == r || NULL == (result = setCreate()))
+        return NULL;
+
+    for (x = 0; x < r->rowsCount; x++)
+    {
+        if (0 != setCard(r->rows[x]) && -1 == setAdd(result, x))
+        {
+            setDestroy(result);
+            return NULL;
+        }
+    }
+
+    return result;
+}
+
+set *relationRange(const relation *r)
+{
+    const set **rows = NULL;
+    set *result = NULL;
+    valType x;
+    size_t count = 0;
+
+    if (NULL == r)
+        return NULL;
+
+    if (NULL == (rows = (const set **) calloc(r->rowsCount + 1, sizeof(set *))))
+        return NULL;
+
+    for (x = 0; x < r->rowsCount; x++)
+        if (0 != setCard(r->rows[x]))
+            rows[count++] = r->rows[x];
+
+    result = 0 != count ? setUnionN(rows, count) : setCreate();
+
+    free((void *) rows);
+    return result;
+}
+
+set *relationInter(const relation *r, const set *s, int lock)
+{
+    setIterator *iter = NULL;
+    set *result = NULL;
+
+    if (NULL == r || NULL == s || NULL == (result = setCreate()))
+        return NULL;
+
+    if (0 != setGetIter(s, &iter))
+    {
+        setDestroy(result);
+        return NULL;
+    }
+
+    while (NULL != iter && 0 == setGetNext(iter))
+    {
+        const dbObject *obj = dbGetObject(iter->val, lock);
+        list *t = NULL;
+
+        if (NULL == obj || objectTuple != obj->objectType ||
+            2 != listLength(t = obj->objectPtr.tuplePtr) ||
+            !relationIsMember(r, (valType) listNodeValue(listFirst(t)), (valType) listNodeValue(listLast(t))))
+        {
+            continue;
+        }
+
+        if (-1 == setAdd(result, iter->val))
+        {
+            setDestroyIter(iter);
+            setDestroy(result);
+            return NULL;
+        }
+    }
+
+    setDestroyIter(iter);
+    return result;
+}
+
+set *relationFlatten(const relation *r, int lock)
+{
+    set *domain = NULL, *range = NULL, *a = NULL, *b = NULL, *result = NULL;
+
+    if (NULL == (domain = relationDomain(r)))
+        return NULL;
+
+    if (NULL == (range = relationRange(r)))
+    {
+        setDestroy(domain);
+        return NULL;
+    }
+
+    a = setFlatten(domain, lock);
+    b = setFlatten(range, lock);
+
+    if (NULL != a && NULL != b)
+        result = setUnion(a, b);
+
+    setDestroy(a);
+    setDestroy(b);
+    setDestroy(domain);
+    setDestroy(range);
+    return result;
+}
+
+set *relationMaterialize(const relation *r)
+{
+    set *result = NULL;
+    setIterator *iter = NULL;
+    tupleBatch *batch = NULL;
+    valType x;
+    int failed = 0;
+
+    if (NULL == r || NULL == (result = setCreate()))
+        return NULL;
+
+    if (NULL == (batch = (tupleBatch *) calloc(1, sizeof(tupleBatch))))
+    {
+        setDestroy(result);
+        return NULL;
+    }
+
+    for (x = 0; x < r->rowsCount && !failed; x++)
+    {
+        if (0 == setCard(r->rows[x]))
+            continue;
+
+        if (0 != setGetIter(r->rows[x], &iter))
+        {
+            failed = 1;
+            break;
+        }
+
+        while (!failed && NULL != iter && 0 == setGetNext(iter))
+            failed = 0 != tupleBatchAddPair(batch, x, iter->val, result);
+
+        setDestroyIter(iter);
+    }
+
+    if (failed || 0 != tupleBatchFlush(batch, result))
+    {
+        tupleBatchDiscard(batch);
+        free(batch);
+        setDestroy(result);
+        return NULL;
+    }
+
+    free(batch);
+    return result;
+}
+
+int relationPrint(const relation *r, reply *out, int lock)
+{
+    setIterator *iter = NULL;
+    valType x, counter = 0;
+    const dbObject *row = NULL, *col = NULL;
+    int result = 0;
+
+    if (NULL == r || NULL == out)
+        return -1;
+
+    result |= replyStr(out, "{ ");
+
+    // Stops at the first failed write, like powerSetPrint.
+    for (x = 0; x < r->rowsCount && 0 == result; x++)
+    {
+        if (0 == setCard(r->rows[x]))
+            continue;
+
+        if (0 != setGetIter(r->rows[x], &iter))
+            return -1;
+
+        row = dbGetObject(x, lock);
+
+        while (0 == result && NULL != iter && 0 == setGetNext(iter))
+        {
+            col = dbGetObject(iter->val, lock);
+
+            result |= replyStr(out, "[ ");
+            result |= NULL != row ? replyObject(out, row, lock) : replyStr(out, "(null)");
+            result |= replyStr(out, ", ");
+            result |= NULL != col ? replyObject(out, col, lock) : replyStr(out, "(null)");
+            result |= replyStr(out, " ]");
+
+            counter++;
+            if (counter < r->card)
+                result |= replyStr(out, ",");
+
+            result |= replyStr(out, " ");
+        }
+
+        setDestroyIter(iter);
+    }
+
+    if (0 == result)
+        result |= replyStr(out, "}");
+
+    return 0 == result ? 0 : -1;
+}
+
+// Private api.
+// Returns row x of r, allocating it if needed, or NULL on error.
+static set *relationRow(relation *r, valType x)
+{
+    if (x >= r->rowsCount)
+    {
+        valType rowsCount = __max(x + 1, r->rowsCount * 2);
+        set **rows = (set **) realloc(r->rows, rowsCount * sizeof(set *));
+
+        if (NULL == rows)
+            return NULL;
+
+        memset(rows + r->rowsCount, 0, (rowsCount - r->rowsCount) * sizeof(set *));
+        r->rows = rows;
+        r->rowsCount = rowsCount;
+    }
+
+    if (NULL == r->rows[x])
+        r->rows[x] = setCreate();
+
+    return r->rows[x];
+}
+
+// Replaces row x of r with row, which is consumed. Returns -1 on error.
+static int relationSetRow(relation *r, valType x, set *row)
+{
+    if (NULL == relationRow(r, x))
+        return -1;
+
+    r->card -= r->rows[x]->card;
+    setDestroy(r->rows[x]);
+
+    r->rows[x] = row;
+    r->card += row->card;
+    return 0;
+}
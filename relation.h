@@ -0,0 +1,64 @@
+// relation.h - Binary relations as row-oriented bit matrices.
+
+#ifndef __RELATION_H__
+#define __RELATION_H__
+
+#include <stdio.h>
+
+#include "athena.h"
+#include "set.h"
+#include "reply.h"
+
+// Relation of pairs [ x, y ] of object ids. Row x is a bitmap of every y paired with x,
+// empty rows are not allocated.
+typedef struct relation
+{
+    set **rows;
+    valType rowsCount;  // Length of rows.
+    valType card;       // Number of pairs.
+} relation;
+
+// Creates new empty relation. Returns NULL on error.
+relation *relationCreate(void);
+// Creates copy of relation r. Returns NULL on error.
+relation *relationCopy(const relation *r);
+// Destroys relation.
+void relationDestroy(relation *r);
+
+// Adds pair [ x, y ]. Returns 0 on ok, 1 if pair already exists, -1 on error.
+int relationAdd(relation *r, valType x, valType y);
+// Removes pair [ x, y ]. Returns 0 on ok, 1 if there is no such pair, -1 on error.
+int relationRemove(relation *r, valType x, valType y);
+// Returns 1 if [ x, y ] is in r, 0 otherwise.
+int relationIsMember(const relation *r, valType x, valType y);
+// Compares given relations. Returns 1 on eq, 0 on not eq, -1 on error.
+int relationCmp(const relation *a, const relation *b);
+
+// Returns relation a x b or NULL on error. Every row is a copy of b.
+relation *relationFromCartProd(const set *a, const set *b);
+// Returns relation of every two element tuple in s, other members are skipped. Returns NULL on error.
+relation *relationFromTuples(const set *s, int lock);
+
+// Returns composition r ; s = { [ x, z ] : [ x, y ] in r, [ y, z ] in s } or NULL on error.
+relation *relationCompose(const relation *r, const relation *s);
+// Returns transitive closure of r or NULL on error. Each round joins only pairs found
+// in the previous round with r (semi-naive evaluation).
+relation *relationClosure(const relation *r);
+// Returns inverse relation { [ y, x ] : [ x, y ] in r } or NULL on error.
+relation *relationInverse(const relation *r);
+// Returns set of first components or NULL on error.
+set *relationDomain(const relation *r);
+// Returns set of second components or NULL on error.
+set *relationRange(const relation *r);
+
+// Returns set of members of s which are pairs in r or NULL on error.
+set *relationInter(const relation *r, const set *s, int lock);
+// Returns flattened relation or NULL on error.
+set *relationFlatten(const relation *r, int lock);
+// Builds every pair tuple and registers them in batches. Returns set of pair ids or NULL on error.
+set *relationMaterialize(const relation *r);
+
+// Returns -1 on error.
+int relationPrint(const relation *r, reply *out, int lock);
+
+#endif /* __RELATION_H__ */
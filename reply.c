@@ -0,0 +1,294 @@
+// reply.c - Buffered reply writer.
+
+#include <stdlib.h>
+#include <string.h>
+#include <memory.h>
+
+#include "adlist.h"
+
+#include "dbengine.h"
+#include "dbobject.h"
+#include "reply.h"
+
+// Set or tuple whose members are being printed.
+typedef struct replyFrame
+{
+    const set *s;                   // NULL for tuples.
+    setIterator iter;
+    listNode *node;                 // Next tuple member.
+    valType counter;
+    size_t batchLen, batchPos;
+    valType ids[REPLY_BATCH_SIZE];
+    const dbObject *objects[REPLY_BATCH_SIZE];
+} replyFrame;
+
+static const char digitPairs[] =
+    "00010203040506070809"
+    "10111213141516171819"
+    "20212223242526272829"
+    "30313233343536373839"
+    "40414243444546474849"
+    "50515253545556575859"
+    "60616263646566676869"
+    "70717273747576777879"
+    "80818283848586878889"
+    "90919293949596979899";
+
+static int replyWalk(reply *r, const set *s, list *t, int lock);
+static int replyOpen(reply *r, replyFrame *frame, const set *s, list *t);
+static void replyFill(replyFrame *frame, int lock);
+
+void replyInit(reply *r, FILE *f)
+{
+    r->f = f;
+    r->len = 0;
+    r->error = 0;
+}
+
+int replyWrite(reply *r, const char *s, size_t len)
+{
+    if (r->len + len > REPLY_BUF_SIZE)
+    {
+        replyFlush(r);
+
+        // Too big to buffer, goes straight to the client.
+        if (len >= REPLY_BUF_SIZE)
+        {
+            if (len != fwrite(s, 1, len, r->f))
+                r->error = 1;
+
+            return r->error ? -1 : 0;
+        }
+    }
+
+    memcpy(r->buf + r->len, s, len);
+    r->len += len;
+    return r->error ? -1 : 0;
+}
+
+int replyStr(reply *r, const char *s)
+{
+    return replyWrite(r, s, strlen(s));
+}
+
+int replyVal(reply *r, valType val)
+{
+    char digits[24];
+    char *p = digits + sizeof(digits);
+
+    // Two digits per division.
+    while (val >= 100)
+    {
+        p -= 2;
+        memcpy(p, &digitPairs[(val % 100) * 2], 2);
+        val /= 100;
+    }
+
+    if (val >= 10)
+    {
+        p -= 2;
+        memcpy(p, &digitPairs[val * 2], 2);
+    }
+    else
+    {
+        *--p = (char) ('0' + val);
+    }
+
+    return replyWrite(r, p, digits + sizeof(digits) - p);
+}
+
+int replyFlush(reply *r)
+{
+    if (0 != r->len && r->len != fwrite(r->buf, 1, r->len, r->f))
+        r->error = 1;
+
+    r->len = 0;
+    return r->error ? -1 : 0;
+}
+
+int replyObject(reply *r, const dbObject *obj, int lock)
+{
+    if (NULL == r || NULL == obj)
+        return -1;
+
+    switch (obj->objectType)
+    {
+        case objectSet:
+            return replyWalk(r, obj->objectPtr.setPtr, NULL, lock);
+
+        case objectTuple:
+            return replyWalk(r, NULL, obj->objectPtr.tuplePtr, lock);
+
+        case objectVal:
+            return replyVal(r, obj->objectPtr.val);
+
+        case objectPowerSet:
+            return powerSetPrint(obj->objectPtr.powerSetPtr, r, lock);
+
+        case objectCartProd:
+            return cartProdPrint(obj->objectPtr.cartProdPtr, r, lock);
+
+        case objectRelation:
+            return relationPrint(obj->objectPtr.relationPtr, r, lock);
+    }
+
+    return -1;
+}
+
+int replySet(reply *r, const set *s, int lock)
+{
+    if (NULL == r || NULL == s)
+        return -1;
+
+    return replyWalk(r, s, NULL, lock);
+}
+
+int replyTuple(reply *r, list *t, int lock)
+{
+    if (NULL == r || NULL == t)
+        return -1;
+
+    return replyWalk(r, NULL, t, lock);
+}
+
+// Private api.
+// Prints set s or tuple t. Nested sets and tuples are pushed on an explicit stack, which
+// spills to the heap only past REPLY_STACK_DEPTH levels. Returns -1 on error.
+static int replyWalk(reply *r, const set *s, list *t, int lock)
+{
+    replyFrame inlineFrames[REPLY_STACK_DEPTH];
+    replyFrame *frames = inlineFrames, *top = NULL, *grown = NULL;
+    size_t depth = 0, capacity = REPLY_STACK_DEPTH;
+    const dbObject *obj = NULL;
+    int result = 0;
+
+    if (0 != replyOpen(r, &frames[depth++], s, t))
+        return -1;
+
+    while (0 != depth && 0 == result)
+    {
+        top = &frames[depth - 1];
+
+        if (top->batchPos == top->batchLen)
+        {
+            replyFill(top, lock);
+
+            if (0 == top->batchLen)
+            {
+                if (NULL != top->s)
+                    result = replyStr(r, 0 != top->counter ? " }" : "}");
+                else
+                    result = replyStr(r, 0 != top->counter ? " ]" : "]");
+
+                depth--;
+                continue;
+            }
+        }
+
+        obj = top->objects[top->batchPos++];
+
+        if (0 != top->counter++)
+            result = replyWrite(r, ", ", 2);
+
+        if (NULL == obj)
+        {
+            result |= replyStr(r, "(null)");
+        }
+        else if (objectSet == obj->objectType || objectTuple == obj->objectType)
+        {
+            if (depth == capacity)
+            {
+                if (frames == inlineFrames)
+                {
+                    if (NULL != (grown = (replyFrame *) malloc(2 * capacity * sizeof(replyFrame))))
+                        memcpy(grown, inlineFrames, capacity * sizeof(replyFrame));
+                }
+                else
+                {
+                    grown = (replyFrame *) realloc(frames, 2 * capacity * sizeof(replyFrame));
+                }
+
+                if (NULL == grown)
+                {
+                    result = -1;
+                    break;
+                }
+
+                frames = grown;
+                capacity *= 2;
+            }
+
+            if (objectSet == obj->objectType)
+                result |= replyOpen(r, &frames[depth++], obj->objectPtr.setPtr, NULL);
+            else
+                result |= replyOpen(r, &frames[depth++], NULL, obj->objectPtr.tuplePtr);
+        }
+        else
+        {
+            result |= replyObject(r, obj, lock);
+        }
+    }
+
+    if (frames != inlineFrames)
+        free(frames);
+
+    return 0 == result ? 0 : -1;
+}
+
+// Starts printing set s or tuple t into frame. Returns -1 on error.
+static int replyOpen(reply *r, replyFrame *frame, const set *s, list *t)
+{
+    setIterator *iter = NULL;
+
+    frame->s = s;
+    frame->node = NULL;
+    frame->counter = 0;
+    frame->batchLen = 0;
+    frame->batchPos = 0;
+
+    if (NULL != s)
+    {
+        if (0 != setGetIter(s, &iter))
+            return -1;
+
+        // Iterator is kept in the frame, empty set gets one which is already at the end.
+        if (NULL != iter)
+        {
+            memcpy(&frame->iter, iter, sizeof(setIterator));
+            setDestroyIter(iter);
+        }
+        else
+        {
+            frame->iter.s = NULL;
+        }
+
+        return replyWrite(r, "{ ", 2);
+    }
+
+    frame->node = listFirst(t);
+    return replyWrite(r, "[ ", 2);
+}
+
+// Fetches next batch of members of frame and resolves them under one index lock.
+static void replyFill(replyFrame *frame, int lock)
+{
+    frame->batchLen = 0;
+    frame->batchPos = 0;
+
+    if (NULL != frame->s)
+    {
+        if (NULL != frame->iter.s)
+            frame->batchLen = setGetNextMany(&frame->iter, frame->ids, REPLY_BATCH_SIZE);
+    }
+    else
+    {
+        while (frame->batchLen < REPLY_BATCH_SIZE && NULL != frame->node)
+        {
+            frame->ids[frame->batchLen++] = (valType) listNodeValue(frame->node);
+            frame->node = listNextNode(frame->node);
+        }
+    }
+
+    if (0 != frame->batchLen)
+        dbGetObjects(frame->ids, frame->batchLen, frame->objects, lock);
+}
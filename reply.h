@@ -0,0 +1,46 @@
+// reply.h - Buffered reply writer.
+
+#ifndef __REPLY_H__
+#define __REPLY_H__
+
+#include <stdio.h>
+
+#include "adlist.h"
+
+#include "athena.h"
+#include "set.h"
+
+struct dbObject;
+
+#define REPLY_BUF_SIZE 16384        // Bytes buffered before a write to the client.
+#define REPLY_BATCH_SIZE 64         // Member ids resolved under one object index lock.
+#define REPLY_STACK_DEPTH 8         // Nesting levels printed without allocating.
+
+// Reply being built for f. Lives on the stack of the command writing it.
+typedef struct reply
+{
+    FILE *f;
+    size_t len;
+    int error;
+    char buf[REPLY_BUF_SIZE];
+} reply;
+
+// Starts empty reply to f.
+void replyInit(reply *r, FILE *f);
+// Appends len bytes at s. Returns -1 on error.
+int replyWrite(reply *r, const char *s, size_t len);
+// Appends zero terminated string s. Returns -1 on error.
+int replyStr(reply *r, const char *s);
+// Appends decimal val. Returns -1 on error.
+int replyVal(reply *r, valType val);
+// Writes buffered bytes to f. Returns -1 if this or any earlier write failed.
+int replyFlush(reply *r);
+
+// Appends obj, nested sets and tuples are walked without recursion. Returns -1 on error.
+int replyObject(reply *r, const struct dbObject *obj, int lock);
+// Appends members of s. Returns -1 on error.
+int replySet(reply *r, const set *s, int lock);
+// Appends members of tuple t. Returns -1 on error.
+int replyTuple(reply *r, list *t, int lock);
+
+#endif /* __REPLY_H__ */
@@ -1,776 +1,1422 @@
-// set.c - Set API and implementation.
-
-#include <malloc.h>
-#include <stdlib.h>
-#include <memory.h>
-#include <stdlib.h>
-
-#include "adlist.h"
-
-#include "dbengine.h"
-#include "syncengine.h"
-#include "dbobject.h"
-#include "set.h"
-#include "tuple.h"
-
-set *setCreate(void)
-{
-    set *s = (set *) malloc(sizeof(set));
-
-    if (s)
-    {
-        s->card = 0;
-        s->data = 0;
-        s->length = 0;
-        s->registered = 0;
-    }
-
-    return s;
-}
-
-set *setCopy(const set *s)
-{
-    set *result;
-
-    if (NULL == (result = setCreate()))
-        return NULL;
-
-    if (NULL == (result->data = (char *) malloc(s->length * sizeof(char))))
-    {
-        free(result);
-        return NULL;
-    }
-
-    result->length = s->length;
-    result->card = s->card;
-    memcpy(result->data, s->data, s->length);
-
-    return result;
-}
-
-void setDestroy(set *s)
-{
-    if (s)
-    {
-        if (s->data)
-            free(s->data);
-        free(s);
-    }
-}
-
-void setDestroyIter(setIterator *iter)
-{
-    if (NULL != iter)
-        free(iter);
-}
-
-int setAdd(set *s, valType val)
-{
-    if (NULL == s)
-        return -1;
-
-    if (!setCanHold(s, val))
-    {
-        if (0 != setGrow(s, val))
-            return -1;
-    }
-
-    if (1 == setGetBit(s, val))
-    {
-        return 1;
-    }
-    else if (-1 == setSetBit(s, val, 1))
-    {
-        return -1;
-    }
-
-    s->card++;
-
-    return 0;
-}
-
-int setRemove(set *s, valType val)
-{
-    if (NULL == s)
-        return -1;
-
-    if (!setCanHold(s, val) || 0 == setGetBit(s, val))
-        return 1;
-
-    if (-1 == setSetBit(s, val, 0))
-        return -1;
-
-    s->card--;
-
-    return 0;
-}
-
-valType setCard(const set *s)
-{
-    if (NULL == s)
-        return 0;
-
-    return s->card;
-}
-
-int setIsMember(const set *s, valType val)
-{
-    return 1 == setGetBit(s, val);
-}
-
-set *setDiff(const set *a, const set *b)
-{
-    set *result;
-    valType byte, bytesCount;
-
-    if (NULL == a || NULL == b || NULL == (result = setCopy(a)))
-        return NULL;
-
-    bytesCount = __min(a->length, b->length);
-    for (byte = 0; byte < bytesCount; byte++)
-    {
-        result->data[byte] &= ~b->data[byte];
-        result->card -= byteBitCount(a->data[byte] & b->data[byte]);
-    }
-
-    return result;
-}
-
-set *setSymDiff(const set *a, const set *b)
-{
-    return setUnion(setDiff(a, b), setDiff(b, a));
-}
-
-set *setInter(const set *a, const set *b)
-{
-    set *result;
-    valType byte;
-
-    if (NULL == a || NULL == b || NULL == (result = setCreate()))
-        return NULL;
-
-    result->length = __min(a->length, b->length);
-    result->card = 0;
-
-    if (0 == result->length ||
-        0 == a->card ||
-        0 == b->card)
-    {
-        return result;
-    }
-
-    if (NULL == (result->data = (char *) malloc(result->length * sizeof(char))))
-    {
-        setDestroy(result);
-        return NULL;
-    }
-
-    for (byte = 0; byte < result->length; byte++)
-    {
-        result->data[byte] = a->data[byte] & b->data[byte];
-        result->card += byteBitCount(result->data[byte]);
-    }
-
-    return result;
-}
-
-set *setUnion(const set *a, const set *b)
-{
-    set *result;
-    valType byte; 
-
-    if (NULL == a || NULL == b || NULL == (result = setCreate()))
-        return NULL;
-
-    result->length = __max(a->length, b->length);
-    result->card = 0;
-
-    if (0 == result->length ||
-        (0 == a->card && 0 == b->card))
-    {
-        return result;
-    }
-
-    if (NULL == (result->data = (char *) calloc(result->length, sizeof(char))))
-    {
-        setDestroy(result);
-        return NULL;
-    }
-
-    for (byte = 0; byte < a->length; byte++)
-    {
-        result->data[byte] = a->data[byte];
-    }
-
-    for (byte = 0; byte < b->length; byte++)
-    {
-        result->data[byte] |= b->data[byte];
-    }
-
-    for (byte = 0; byte < result->length; byte++)
-    {
-        result->card += byteBitCount(result->data[byte]);
-    }
-
-    return result;
-}
-
-set *setCartProd(const set *a, const set *b)
-{
-    set *result = NULL;
-    setIterator *aIter = NULL, *bIter = NULL, bIterStart;
-
-    if (NULL == a || NULL == b || NULL == (result = setCreate()))
-        return NULL;
-
-    if (0 != setGetIter(a, &aIter) || NULL == aIter)
-    {
-        setDestroy(result);
-        return NULL;
-    }
-
-    if (0 != setGetIter(b, &bIter) || NULL == bIter)
-    {
-        setDestroyIter(aIter);
-        setDestroy(result);
-        return NULL;
-    }
-
-    memcpy(&bIterStart, bIter, sizeof(setIterator));
-
-    while (0 == setGetNext(aIter))
-    {
-        memcpy(bIter, &bIterStart, sizeof(setIterator));
-
-        while (0 == setGetNext(bIter))
-        {
-            dbObject *newTuple = NULL;
-            valType newTupleId = 0;
-            list *tup = NULL;
-            const dbObject *aObject = NULL, *bObject = NULL;
-
-            if (NULL == (tup = listCreate()))
-            {
-                setDestroyIter(aIter);
-                setDestroyIter(bIter);
-                setDestroy(result);
-                return NULL;
-            }
-
-            aObject = dbGetObject(aIter->val, 1);
-            bObject = dbGetObject(bIter->val, 1);
-
-            if (NULL == aObject || NULL == bObject)
-            {
-                setDestroyIter(aIter);
-                setDestroyIter(bIter);
-                setDestroy(result);
-                listRelease(tup);
-                return NULL;
-            }
-
-            if (NULL == listAddNodeTail(tup, (void *) aObject->id) ||
-                NULL == listAddNodeTail(tup, (void *) bObject->id))
-            {
-                setDestroyIter(aIter);
-                setDestroyIter(bIter);
-                setDestroy(result);
-                listRelease(tup);
-                return NULL;
-            }
-
-            if (NULL == (newTuple = (dbObject *) calloc(1, sizeof(dbObject))))
-            {
-                setDestroyIter(aIter);
-                setDestroyIter(bIter);
-                setDestroy(result);
-                listRelease(tup);
-                return NULL;
-            }
-
-            newTuple->objectType = objectTuple;
-            newTuple->objectPtr.tuplePtr = tup;
-
-            if (0 != dbRegisterObject(&newTuple, &newTupleId))
-            {
-                setDestroyIter(aIter);
-                setDestroyIter(bIter);
-                setDestroy(result);
-                listRelease(tup);
-                free(newTuple);
-                return NULL;
-            }
-
-            if (-1 == setAdd(result, newTupleId))
-            {
-                setDestroyIter(aIter);
-                setDestroyIter(bIter);
-                setDestroy(result);
-                listRelease(tup);
-                dbUnregisterObject(newTupleId);
-                free(newTuple);
-                return NULL;
-            }
-        }
-    }
-
-    setDestroyIter(aIter);
-    setDestroyIter(bIter);
-    return result;
-}
-
-set *setBoolean(const set *a)
-{
-    valType *contents = NULL;
-    valType contentsIndex = 0;
-    valType booleanCard = 1;
-    valType i, step, pos;
-    setIterator *iter = NULL;
-    set **subsets = NULL;
-    set *result;
-
-    if (NULL == a || 0 != setGetIter(a, &iter))
-        return NULL;
-
-    if (NULL == (result = setCreate()))
-    {
-        setDestroyIter(iter);
-    }
-
-    // Calculate boolean cardinality.
-    for (i = 0; i < a->card; i++)
-        booleanCard <<= 1;
-
-    if (NULL == (subsets = (set **) calloc(booleanCard, sizeof(set *))))
-    {
-        setDestroyIter(iter);
-        setDestroy(result);
-        return NULL;
-    }
-
-    if (NULL == (contents = (valType *) calloc(a->card, sizeof(valType))))
-    {
-        free(subsets);
-        setDestroyIter(iter);
-        setDestroy(result);
-        return NULL;
-    }
-
-    // Create subsets.
-    for (i = 0; i < booleanCard; i++)
-    {
-        valType j;
-
-        if (NULL == (subsets[i] = setCreate()))
-        {
-            for (j = 0; j < i; j++)
-                setDestroy(subsets[i]);
-
-            free(subsets);
-            free(contents);
-            setDestroyIter(iter);
-            setDestroy(result);
-            return NULL;
-        }
-    }
-
-    // Fetch objects.
-    while (0 == setGetNext(iter))
-    {
-        contents[contentsIndex++] = iter->val;
-    }
-    setDestroyIter(iter);
-
-    // Fill sets.
-    step = booleanCard;
-    for (i = 0; i < a->card; i++) // a->card is contentsLength.
-    {
-        step >>= 1;
-        pos = 0;
-
-        while (pos < booleanCard)
-        {
-            valType j;
-
-            pos += step; // First part - don't include.
-
-            for (j = 0; j < step; j++)
-            {
-                setAdd(subsets[pos + j], contents[i]);
-            }
-
-            pos += step;
-        }
-    }
-
-    // Register sets.
-    for (i = 0; i < booleanCard; i++)
-    {
-        dbObject *newSetObject = NULL;
-        valType newObjectId;
-
-        if (NULL == (newSetObject = (dbObject *) calloc(1, sizeof(dbObject))))
-        {
-            valType j;
-            for (j = 0; j < i; j++)
-                setDestroy(subsets[i]);
-
-            free(subsets);
-            free(contents);
-            setDestroy(result);
-            return NULL;
-        }
-
-        newSetObject->objectType = objectSet;
-        newSetObject->objectPtr.setPtr = subsets[i];
-
-        dbRegisterObject(&newSetObject, &newObjectId);
-
-        setAdd(result, newObjectId);
-    }
-
-    free(subsets);
-    free(contents);
-
-    return result;
-}
-
-set *setFlatten(const set *s, int lock)
-{
-    setIterator *iter = NULL;
-    set *result = NULL;
-
-    if (NULL == s)
-        return NULL;
-
-    lockRead(s);
-
-    if (NULL == (result = setCopy(s)))
-    {
-        unlockRead(s);
-        return NULL;
-    }
-
-    if (0 != setGetIter(s, &iter))
-    {
-        unlockRead(s);
-        setDestroy(result);
-        return NULL;
-    }
-
-    while (0 == setGetNext(iter))
-    {
-        const dbObject *obj = dbGetObject(iter->val, lock);
-
-        if (NULL == obj)
-            continue;
-
-        switch (obj->objectType)
-        {
-            case objectSet:
-                {
-                    set *flattened = setFlatten(obj->objectPtr.setPtr, lock);
-                    set *mergeResult = NULL;
-
-                    if (NULL == flattened)
-                        continue;
-
-                    mergeResult = setUnion(result, flattened);
-                    setDestroy(flattened);
-                    setDestroy(result);
-                    if (NULL == mergeResult)
-                    {
-                        unlockRead(s);
-                        setDestroyIter(iter);
-                        return NULL;
-                    }
-                    result = mergeResult;
-                }
-                break;
-
-            case objectTuple:
-                {
-                    set *flattened = tupleFlatten(obj->objectPtr.tuplePtr, lock);
-                    set *mergeResult = NULL;
-
-                    if (NULL == flattened)
-                        continue;
-
-                    mergeResult = setUnion(result, flattened);
-                    setDestroy(flattened);
-                    setDestroy(result);
-                    if (NULL == mergeResult)
-                    {
-                        unlockRead(s);
-                        setDestroyIter(iter);
-                        return NULL;
-                    }
-                    result = mergeResult;
-                }
-                break;
-        }
-    }
-
-    unlockRead(s);
-    setDestroyIter(iter);
-    return result;
-}
-
-int setCmpE(const set *a, const set *b)
-{
-    valType byte, bytesCount;
-
-    if (NULL == a || NULL == b)
-        return -1;
-
-    if (a == b)
-        return 1;
-
-    if (a->card != b->card)
-        return 0;
-
-    bytesCount = __min(a->length, b->length);
-    for (byte = 0; byte < bytesCount; byte++)
-    {
-        if (a->data[byte] != b->data[byte])
-            return 0;
-    }
-
-    return 1;
-}
-
-int setCmpSubset(const set *a, const set *b)
-{
-    valType byte, bytesCount, aBytes;
-
-    if (NULL == a || NULL == b)
-        return -1;
-
-    if (0 == a->card)
-        return 1;
-
-    if (a->card > b->card)
-        return 0;
-
-    bytesCount = __min(a->length, b->length);
-    aBytes = 0;
-    for (byte = 0; byte < bytesCount; byte++)
-    {
-        aBytes += byteBitCount(a->data[byte]);
-        if ((a->data[byte] | b->data[byte]) != b->data[byte])
-            return 0;
-    }
-
-    if (aBytes != a->card)
-        return 0;
-
-    return 1;
-}
-
-int setCmpSubsetOrEq(const set *a, const set *b)
-{
-    return setCmpSubset(a, b) || setCmpE(a, b);
-}
-
-int setGetRand(const set *s, valType *val)
-{
-    setIterator *i;
-    valType *values, valuesIndex = 0;
-
-    if (NULL == s || -1 == setGetIter(s, &i) || NULL == i)
-        return -1;
-
-    if (NULL == (values = (valType *) malloc(s->card * sizeof(valType))))
-    {
-        setDestroyIter(i);
-        return -1;
-    }
-
-    while (0 == setGetNext(i))
-    {
-        values[valuesIndex++] = i->val;
-    }
-
-    valuesIndex = (rand() * rand()) % s->card;
-
-    *val = values[valuesIndex];
-
-    setDestroyIter(i);
-    free(values);
-
-    return 0;
-}
-
-unsigned setTrunc(set *s)
-{
-    unsigned i, freed;
-
-    if (NULL == s)
-        return 0;
-
-    if (0 == s->length)
-        return 0;
-
-    if (0 == s->card)
-    {
-        unsigned freed = s->length;
-        s->data = (char *) realloc(s->data, 0);
-        s->length = 0;
-        return freed;
-    }
-
-    i = s->length - 1;
-    while (0 == s->data[i])
-    {
-        if (0 == i)
-            break;
-
-        i--;
-    }
-
-    freed = s->length - i - 1;
-    s->length = i + 1;
-
-    s->data = (char *) realloc(s->data, s->length);
-
-    return freed;
-}
-
-int setGetIter(const set *s, setIterator **iter)
-{
-    setIterator *i;
-    valType bit;
-
-    if (NULL == s)
-        return -1;
-
-    if (0 == s->length || 0 == s->card)
-    {
-        *iter = NULL;
-        return 0;
-    }
-
-    for (bit = 0; bit < 8 * s->length; bit++)
-    {
-        if (1 == setGetBit(s, bit))
-        {
-            if (NULL == (i = (setIterator *) malloc(sizeof(setIterator))))
-                return -1;
-
-            i->s = s;
-            i->i = bit;
-
-            *iter = i;
-
-            return 0;
-        }
-    }
-
-    *iter = NULL;
-
-    return 0;
-}
-
-int setGetNext(setIterator *iter)
-{
-    if (NULL == iter || NULL == iter->s || 0 == iter->s->length || 0 == iter->s->card)
-        return -1;
-
-    for (; iter->i < 8 * iter->s->length; )
-    {
-        if (1 == setGetBit(iter->s, iter->i))
-        {
-            iter->val = iter->i;
-            iter->i++;
-            return 0;
-        }
-
-        iter->i++;
-    }
-
-    return -1;
-}
-
-int setCanHold(set *s, valType val)
-{
-    if (NULL == s)
-        return 0;
-
-    if (s->length * 8 >= val + 1)
-        return 1;
-
-    return 0;
-}
-
-int setGrow(set *s, valType val)
-{
-    char *t;
-    valType newLen = 0;
-
-    if (setCanHold(s, val))
-        return 0;
-
-    if (NULL == s)
-        return -1;
-
-    newLen = 1 + val / 8;
-    t = (char *) realloc(s->data, newLen);
-
-    if (NULL != t)
-    {
-        memset(t + s->length, 0, newLen - s->length);
-        s->length = newLen;
-        s->data = t;
-        return 0;
-    }
-
-    return -1;
-}
-
-int setSetBit(set *s, valType bit, unsigned val)
-{
-    valType byte = bit / 8;
-    char v = 1 << (bit % 8);
-
-    if (byte >= s->length * 8)
-        return -1;
-
-    // Make val 0 or 1;
-    if (val = val ? 1 : 0)
-        s->data[byte] |= v;
-    else
-        s->data[byte] &= ~v;
-
-    return val;
-}
-
-int setGetBit(const set *s, valType bit)
-{
-    valType byte = bit / 8;
-    char v = 1 << (bit % 8);
-
-    if (byte >= s->length)
-        return 0;
-
-    return 0 != (s->data[byte] & v);
-}
-
-unsigned char bitCountMatrix[256] =
-{
-    0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4, 1, 2, 2, 3, 2, 3, 3,
-    4, 2, 3, 3, 4, 3, 4, 4, 5, 1, 2, 2, 3, 2, 3, 3, 4, 2, 3, 3, 4, 3, 4,
-    4, 5, 2, 3, 3, 4, 3, 4, 4, 5, 3, 4, 4, 5, 4, 5, 5, 6, 1, 2, 2, 3, 2,
-    3, 3, 4, 2, 3, 3, 4, 3, 4, 4, 5, 2, 3, 3, 4, 3, 4, 4, 5, 3, 4, 4, 5,
-    4, 5, 5, 6, 2, 3, 3, 4, 3, 4, 4, 5, 3, 4, 4, 5, 4, 5, 5, 6, 3, 4, 4,
-    5, 4, 5, 5, 6, 4, 5, 5, 6, 5, 6, 6, 7, 1, 2, 2, 3, 2, 3, 3, 4, 2, 3,
-    3, 4, 3, 4, 4, 5, 2, 3, 3, 4, 3, 4, 4, 5, 3, 4, 4, 5, 4, 5, 5, 6, 2,
-    3, 3, 4, 3, 4, 4, 5, 3, 4, 4, 5, 4, 5, 5, 6, 3, 4, 4, 5, 4, 5, 5, 6,
-    4, 5, 5, 6, 5, 6, 6, 7, 2, 3, 3, 4, 3, 4, 4, 5, 3, 4, 4, 5, 4, 5, 5, 6,
-    3, 4, 4, 5, 4, 5, 5, 6, 4, 5, 5, 6, 5, 6, 6, 7, 3, 4, 4, 5, 4, 5, 5, 6,
-    4, 5, 5, 6, 5, 6, 6, 7, 4, 5, 5, 6, 5, 6, 6, 7, 5, 6, 6, 7, 6, 7, 7, 8
-};
-
-__inline static int byteBitCount(unsigned byte)
-{
-    return bitCountMatrix[byte & 0xff];
-}
+// set.c - Set API and implementation.
+
+#include <malloc.h>
+#include <stdlib.h>
+#include <memory.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "adlist.h"
+
+#include "dbengine.h"
+#include "syncengine.h"
+#include "dbobject.h"
+#include "set.h"
+#include "tuple.h"
+
+// Random generator state of each client thread, zero until first use.
+static __declspec(thread) unsigned long long randState;
+
+set *setCreate(void)
+{
+    set *s = (set *) malloc(sizeof(set));
+
+    if (s)
+    {
+        s->card = 0;
+        s->data = 0;
+        s->length = 0;
+        s->capacity = 0;
+        s->registered = 0;
+    }
+
+    return s;
+}
+
+set *setCopy(const set *s)
+{
+    set *result;
+
+    if (NULL == (result = setCreate()))
+        return NULL;
+
+    if (0 != s->length)
+    {
+        if (NULL == (result->data = setDataAlloc(s->length)))
+        {
+            free(result);
+            return NULL;
+        }
+
+        memcpy(result->data, s->data, s->length);
+    }
+
+    result->length = s->length;
+    result->capacity = s->length;
+    result->card = s->card;
+
+    return result;
+}
+
+void setDestroy(set *s)
+{
+    if (s)
+    {
+        if (s->data)
+            setDataFree(s->data, s->capacity);
+        free(s);
+    }
+}
+
+void setDestroyIter(setIterator *iter)
+{
+    if (NULL != iter)
+        free(iter);
+}
+
+int setAdd(set *s, valType val)
+{
+    if (NULL == s)
+        return -1;
+
+    if (!setCanHold(s, val))
+    {
+        if (0 != setGrow(s, val))
+            return -1;
+    }
+
+    if (1 == setGetBit(s, val))
+    {
+        return 1;
+    }
+    else if (-1 == setSetBit(s, val, 1))
+    {
+        return -1;
+    }
+
+    s->card++;
+
+    return 0;
+}
+
+int setAddRange(set *s, valType from, valType to)
+{
+    valType bit, firstByte, lastByte;
+
+    if (NULL == s || from > to)
+        return -1;
+
+    if (!setCanHold(s, to))
+    {
+        if (0 != setGrow(s, to))
+            return -1;
+    }
+
+    // Partial bytes at the edges bit by bit, whole bytes in between with memset.
+    for (bit = from; bit <= to && 0 != bit % 8; bit++)
+        if (0 == setGetBit(s, bit) && -1 != setSetBit(s, bit, 1))
+            s->card++;
+
+    if (bit > to)
+        return 0;
+
+    firstByte = bit / 8;
+    lastByte = (to + 1) / 8;
+
+    if (firstByte < lastByte)
+    {
+        s->card += (lastByte - firstByte) * 8 - bytesBitCount(s->data + firstByte, lastByte - firstByte);
+        memset(s->data + firstByte, 0xFF, lastByte - firstByte);
+    }
+
+    for (bit = lastByte * 8; bit <= to; bit++)
+        if (0 == setGetBit(s, bit) && -1 != setSetBit(s, bit, 1))
+            s->card++;
+
+    return 0;
+}
+
+int setAddMany(set *s, const valType *vals, size_t count)
+{
+    size_t i, j;
+
+    if (NULL == s || NULL == vals)
+        return -1;
+
+    for (i = 0; i < count; i = j)
+    {
+        for (j = i + 1; j < count && vals[j] == vals[j - 1] + 1; j++);
+
+        if (j - i > 1 ? 0 != setAddRange(s, vals[i], vals[j - 1]) : -1 == setAdd(s, vals[i]))
+            return -1;
+    }
+
+    return 0;
+}
+
+int setRemove(set *s, valType val)
+{
+    if (NULL == s)
+        return -1;
+
+    if (!setCanHold(s, val) || 0 == setGetBit(s, val))
+        return 1;
+
+    if (-1 == setSetBit(s, val, 0))
+        return -1;
+
+    s->card--;
+
+    return 0;
+}
+
+valType setCard(const set *s)
+{
+    if (NULL == s)
+        return 0;
+
+    return s->card;
+}
+
+int setIsMember(const set *s, valType val)
+{
+    return 1 == setGetBit(s, val);
+}
+
+int setGetBounds(const set *s, valType *min, valType *max)
+{
+    valType first = 0, last;
+    unsigned char byte;
+
+    if (NULL == s || 0 == s->card)
+        return -1;
+
+    while (first < s->length && 0 == s->data[first])
+        first++;
+
+    last = s->length - 1;
+    while (last > first && 0 == s->data[last])
+        last--;
+
+    for (*min = first * 8, byte = (unsigned char) s->data[first]; 0 == (byte & 1); byte >>= 1)
+        (*min)++;
+
+    for (*max = last * 8 + 7, byte = (unsigned char) s->data[last]; 0 == (byte & 0x80); byte <<= 1)
+        (*max)--;
+
+    return 0;
+}
+
+set *setDiff(const set *a, const set *b)
+{
+    const set *operands[2];
+
+    operands[0] = a;
+    operands[1] = b;
+    return setDiffN(operands, 2);
+}
+
+set *setSymDiff(const set *a, const set *b)
+{
+    set *result;
+    valType byte, blockEnd;
+
+    if (NULL == a || NULL == b || NULL == (result = setCreate()))
+        return NULL;
+
+    result->length = __max(0 != a->card ? a->length : 0, 0 != b->card ? b->length : 0);
+
+    if (0 == result->length)
+    {
+        return result;
+    }
+
+    if (NULL == (result->data = setDataAlloc(result->length)))
+    {
+        setDestroy(result);
+        return NULL;
+    }
+
+    result->capacity = result->length;
+
+    for (byte = 0; byte < result->length; byte = blockEnd)
+    {
+        blockEnd = __min(result->length, byte + SET_BLOCK_SIZE);
+        memset(result->data + byte, 0, blockEnd - byte);
+
+        if (0 != a->card && byte < a->length)
+            bytesXor(result->data + byte, a->data + byte, __min(blockEnd, a->length) - byte);
+
+        if (0 != b->card && byte < b->length)
+            bytesXor(result->data + byte, b->data + byte, __min(blockEnd, b->length) - byte);
+
+        result->card += bytesBitCount(result->data + byte, blockEnd - byte);
+    }
+
+    return result;
+}
+
+set *setInter(const set *a, const set *b)
+{
+    const set *operands[2];
+
+    operands[0] = a;
+    operands[1] = b;
+    return setInterN(operands, 2);
+}
+
+set *setUnion(const set *a, const set *b)
+{
+    const set *operands[2];
+
+    operands[0] = a;
+    operands[1] = b;
+    return setUnionN(operands, 2);
+}
+
+set *setUnionN(const set **sets, size_t count)
+{
+    set *result;
+    valType byte, blockEnd;
+    size_t k;
+
+    if (NULL == sets || 0 == count || NULL == (result = setCreate()))
+        return NULL;
+
+    for (k = 0; k < count; k++)
+    {
+        if (NULL == sets[k])
+        {
+            setDestroy(result);
+            return NULL;
+        }
+
+        if (0 != sets[k]->card)
+            result->length = __max(result->length, sets[k]->length);
+    }
+
+    if (0 == result->length)
+    {
+        return result;
+    }
+
+    if (NULL == (result->data = setDataAlloc(result->length)))
+    {
+        setDestroy(result);
+        return NULL;
+    }
+
+    result->capacity = result->length;
+
+    // Each block stays in cache while all operands are merged into it and counted.
+    for (byte = 0; byte < result->length; byte = blockEnd)
+    {
+        blockEnd = __min(result->length, byte + SET_BLOCK_SIZE);
+        memset(result->data + byte, 0, blockEnd - byte);
+
+        for (k = 0; k < count; k++)
+        {
+            if (0 != sets[k]->card && byte < sets[k]->length)
+                bytesOr(result->data + byte, sets[k]->data + byte, __min(blockEnd, sets[k]->length) - byte);
+        }
+
+        result->card += bytesBitCount(result->data + byte, blockEnd - byte);
+    }
+
+    return result;
+}
+
+set *setInterN(const set **sets, size_t count)
+{
+    set *result;
+    valType byte, blockEnd;
+    size_t k;
+
+    if (NULL == sets || 0 == count || NULL == (result = setCreate()))
+        return NULL;
+
+    for (k = 0; k < count; k++)
+    {
+        if (NULL == sets[k])
+        {
+            setDestroy(result);
+            return NULL;
+        }
+    }
+
+    result->length = sets[0]->length;
+
+    for (k = 0; k < count; k++)
+    {
+        if (0 == sets[k]->card)
+        {
+            result->length = 0;
+            return result;
+        }
+
+        result->length = __min(result->length, sets[k]->length);
+    }
+
+    if (0 == result->length)
+    {
+        return result;
+    }
+
+    if (NULL == (result->data = setDataAlloc(result->length)))
+    {
+        setDestroy(result);
+        return NULL;
+    }
+
+    result->capacity = result->length;
+
+    for (byte = 0; byte < result->length; byte = blockEnd)
+    {
+        blockEnd = __min(result->length, byte + SET_BLOCK_SIZE);
+        memcpy(result->data + byte, sets[0]->data + byte, blockEnd - byte);
+
+        for (k = 1; k < count; k++)
+            bytesAnd(result->data + byte, sets[k]->data + byte, blockEnd - byte);
+
+        result->card += bytesBitCount(result->data + byte, blockEnd - byte);
+    }
+
+    return result;
+}
+
+set *setDiffN(const set **sets, size_t count)
+{
+    set *result;
+    valType byte, blockEnd;
+    size_t k;
+
+    if (NULL == sets || 0 == count || NULL == (result = setCreate()))
+        return NULL;
+
+    for (k = 0; k < count; k++)
+    {
+        if (NULL == sets[k])
+        {
+            setDestroy(result);
+            return NULL;
+        }
+    }
+
+    if (0 == sets[0]->card || 0 == sets[0]->length)
+    {
+        return result;
+    }
+
+    result->length = sets[0]->length;
+
+    if (NULL == (result->data = setDataAlloc(result->length)))
+    {
+        setDestroy(result);
+        return NULL;
+    }
+
+    result->capacity = result->length;
+
+    for (byte = 0; byte < result->length; byte = blockEnd)
+    {
+        blockEnd = __min(result->length, byte + SET_BLOCK_SIZE);
+        memcpy(result->data + byte, sets[0]->data + byte, blockEnd - byte);
+
+        for (k = 1; k < count; k++)
+        {
+            if (0 != sets[k]->card && byte < sets[k]->length)
+                bytesAndNot(result->data + byte, sets[k]->data + byte, __min(blockEnd, sets[k]->length) - byte);
+        }
+
+        result->card += bytesBitCount(result->data + byte, blockEnd - byte);
+    }
+
+    return result;
+}
+
+int setMerge(set *dst, const set *src)
+{
+    valType before;
+
+    if (NULL == dst || NULL == src)
+        return -1;
+
+    if (0 == src->card || 0 == src->length)
+        return 0;
+
+    if (-1 == setGrow(dst, src->length * 8 - 1))
+        return -1;
+
+    before = bytesBitCount(dst->data, src->length);
+    bytesOr(dst->data, src->data, src->length);
+    dst->card += bytesBitCount(dst->data, src->length) - before;
+    return 0;
+}
+
+void setSubtract(set *dst, const set *src)
+{
+    valType before, n;
+
+    if (NULL == dst || NULL == src || 0 == dst->card || 0 == src->card)
+        return;
+
+    n = __min(dst->length, src->length);
+    before = bytesBitCount(dst->data, n);
+    bytesAndNot(dst->data, src->data, n);
+    dst->card -= before - bytesBitCount(dst->data, n);
+}
+
+int setApply(set *dst, const set *src, setWordOp op, set *changed)
+{
+    valType length, byte, count = 0;
+    size_t word, other, diff;
+
+    if (NULL == dst || NULL == src || (setWordOr != op && setWordAnd != op && setWordAndNot != op))
+        return -1;
+
+    // Only bytes which can change are visited, union is the only one that grows dst.
+    switch (op)
+    {
+        case setWordOr:
+            length = 0 != src->card ? src->length : 0;
+            if (0 != length && -1 == setGrow(dst, length * 8 - 1))
+                return -1;
+            break;
+
+        case setWordAnd:
+            length = 0 != dst->card ? dst->length : 0;
+            break;
+
+        default:
+            length = 0 != dst->card && 0 != src->card ? __min(dst->length, src->length) : 0;
+            break;
+    }
+
+    if (NULL != changed && 0 != length && -1 == setGrow(changed, length * 8 - 1))
+        return -1;
+
+    for (byte = 0; byte < length; byte += sizeof(size_t))
+    {
+        word = setLoadWord(dst, byte);
+        other = setLoadWord(src, byte);
+
+        switch (op)
+        {
+            case setWordOr:
+                diff = other & ~word;
+                break;
+
+            case setWordAnd:
+                diff = word & ~other;
+                break;
+
+            default:
+                diff = word & other;
+                break;
+        }
+
+        if (0 == diff)
+            continue;
+
+        setStoreWord(dst, byte, word ^ diff);
+        count += wordBitCount(diff);
+
+        if (NULL != changed)
+        {
+            setStoreWord(changed, byte, diff);
+            changed->card += wordBitCount(diff);
+        }
+    }
+
+    if (setWordOr == op)
+        dst->card += count;
+    else
+        dst->card -= count;
+
+    return 0;
+}
+
+valType setInterCardN(const set **sets, size_t count)
+{
+    return setCountWords(sets, count, setWordAnd, 0);
+}
+
+valType setUnionCardN(const set **sets, size_t count)
+{
+    return setCountWords(sets, count, setWordOr, 0);
+}
+
+valType setDiffCardN(const set **sets, size_t count)
+{
+    return setCountWords(sets, count, setWordAndNot, 0);
+}
+
+valType setSymDiffCard(const set *a, const set *b)
+{
+    const set *operands[2];
+
+    operands[0] = a;
+    operands[1] = b;
+    return setCountWords(operands, 2, setWordXor, 0);
+}
+
+int setIntersectsN(const set **sets, size_t count)
+{
+    return 0 != setCountWords(sets, count, setWordAnd, 1);
+}
+
+void setInterUnionCard(const set *a, const set *b, valType *inter, valType *uni)
+{
+    valType byte, bytesCount;
+    size_t wordA, wordB;
+
+    *inter = 0;
+    *uni = 0;
+
+    if (NULL == a || NULL == b)
+        return;
+
+    bytesCount = __max(a->length, b->length);
+    for (byte = 0; byte < bytesCount; byte += sizeof(size_t))
+    {
+        wordA = setLoadWord(a, byte);
+        wordB = setLoadWord(b, byte);
+
+        if (0 == (wordA | wordB))
+            continue;
+
+        *inter += wordBitCount(wordA & wordB);
+        *uni += wordBitCount(wordA | wordB);
+    }
+}
+
+set *setBoolean(const set *a)
+{
+    valType *contents = NULL;
+    valType contentsIndex = 0;
+    valType booleanCard = 1;
+    valType i, step, pos;
+    setIterator *iter = NULL;
+    set **subsets = NULL;
+    set *result;
+
+    // Boolean cardinality must fit in valType.
+    if (NULL == a || a->card >= sizeof(valType) * 8 || 0 != setGetIter(a, &iter))
+        return NULL;
+
+    if (NULL == (result = setCreate()))
+    {
+        setDestroyIter(iter);
+        return NULL;
+    }
+
+    booleanCard <<= a->card;
+
+    if (NULL == (subsets = (set **) calloc(booleanCard, sizeof(set *))))
+    {
+        setDestroyIter(iter);
+        setDestroy(result);
+        return NULL;
+    }
+
+    if (NULL == (contents = (valType *) calloc(a->card, sizeof(valType))))
+    {
+        free(subsets);
+        setDestroyIter(iter);
+        setDestroy(result);
+        return NULL;
+    }
+
+    // Create subsets.
+    for (i = 0; i < booleanCard; i++)
+    {
+        valType j;
+
+        if (NULL == (subsets[i] = setCreate()))
+        {
+            for (j = 0; j < i; j++)
+                setDestroy(subsets[j]);
+
+            free(subsets);
+            free(contents);
+            setDestroyIter(iter);
+            setDestroy(result);
+            return NULL;
+        }
+    }
+
+    // Fetch objects.
+    while (0 == setGetNext(iter))
+    {
+        contents[contentsIndex++] = iter->val;
+    }
+    setDestroyIter(iter);
+
+    // Fill sets.
+    step = booleanCard;
+    for (i = 0; i < a->card; i++) // a->card is contentsLength.
+    {
+        step >>= 1;
+        pos = 0;
+
+        while (pos < booleanCard)
+        {
+            valType j;
+
+            pos += step; // First part - don't include.
+
+            for (j = 0; j < step; j++)
+            {
+                setAdd(subsets[pos + j], contents[i]);
+            }
+
+            pos += step;
+        }
+    }
+
+    // Register sets.
+    for (i = 0; i < booleanCard; i++)
+    {
+        dbObject *newSetObject = NULL;
+        valType newObjectId;
+
+        if (NULL == (newSetObject = (dbObject *) calloc(1, sizeof(dbObject))))
+        {
+            valType j;
+            for (j = 0; j < i; j++)
+                setDestroy(subsets[j]);
+
+            free(subsets);
+            free(contents);
+            setDestroy(result);
+            return NULL;
+        }
+
+        newSetObject->objectType = objectSet;
+        newSetObject->objectPtr.setPtr = subsets[i];
+
+        dbRegisterObject(&newSetObject, &newObjectId);
+
+        setAdd(result, newObjectId);
+    }
+
+    free(subsets);
+    free(contents);
+
+    return result;
+}
+
+set *setFlatten(const set *s, int lock)
+{
+    setIterator *iter = NULL;
+    set *result = NULL;
+
+    if (NULL == s)
+        return NULL;
+
+    lockRead(s);
+
+    if (NULL == (result = setCopy(s)))
+    {
+        unlockRead(s);
+        return NULL;
+    }
+
+    if (0 != setGetIter(s, &iter))
+    {
+        unlockRead(s);
+        setDestroy(result);
+        return NULL;
+    }
+
+    while (0 == setGetNext(iter))
+    {
+        const dbObject *obj = dbGetObject(iter->val, lock);
+
+        if (NULL == obj)
+            continue;
+
+        switch (obj->objectType)
+        {
+            case objectSet:
+            case objectPowerSet:
+            case objectCartProd:
+            case objectRelation:
+                {
+                    set *flattened = dbObjectFlatten(obj, lock);
+                    set *mergeResult = NULL;
+
+                    if (NULL == flattened)
+                        continue;
+
+                    mergeResult = setUnion(result, flattened);
+                    setDestroy(flattened);
+                    setDestroy(result);
+                    if (NULL == mergeResult)
+                    {
+                        unlockRead(s);
+                        setDestroyIter(iter);
+                        return NULL;
+                    }
+                    result = mergeResult;
+                }
+                break;
+
+            case objectTuple:
+                {
+                    set *flattened = tupleFlatten(obj->objectPtr.tuplePtr, lock);
+                    set *mergeResult = NULL;
+
+                    if (NULL == flattened)
+                        continue;
+
+                    mergeResult = setUnion(result, flattened);
+                    setDestroy(flattened);
+                    setDestroy(result);
+                    if (NULL == mergeResult)
+                    {
+                        unlockRead(s);
+                        setDestroyIter(iter);
+                        return NULL;
+                    }
+                    result = mergeResult;
+                }
+                break;
+        }
+    }
+
+    unlockRead(s);
+    setDestroyIter(iter);
+    return result;
+}
+
+int setCmpE(const set *a, const set *b)
+{
+    valType byte, bytesCount;
+
+    if (NULL == a || NULL == b)
+        return -1;
+
+    if (a == b)
+        return 1;
+
+    if (a->card != b->card)
+        return 0;
+
+    bytesCount = __max(a->length, b->length);
+    for (byte = 0; byte < bytesCount; byte += sizeof(size_t))
+    {
+        if (setLoadWord(a, byte) != setLoadWord(b, byte))
+            return 0;
+    }
+
+    return 1;
+}
+
+int setCmpSubset(const set *a, const set *b)
+{
+    valType byte;
+
+    if (NULL == a || NULL == b)
+        return -1;
+
+    if (0 == a->card)
+        return 1;
+
+    if (a->card > b->card)
+        return 0;
+
+    // Stops at the first word of a which has a member missing in b.
+    for (byte = 0; byte < a->length; byte += sizeof(size_t))
+    {
+        if (0 != (setLoadWord(a, byte) & ~setLoadWord(b, byte)))
+            return 0;
+    }
+
+    return 1;
+}
+
+int setCmpSubsetOrEq(const set *a, const set *b)
+{
+    return setCmpSubset(a, b) || setCmpE(a, b);
+}
+
+int setGetRand(const set *s, valType *val)
+{
+    return 1 == setGetRandMany(s, val, 1, 1) ? 0 : -1;
+}
+
+int setGetRandMany(const set *s, valType *vals, size_t count, int distinct)
+{
+    valType *ranks = NULL, *table = NULL, mask, j;
+    size_t n, i;
+    setIterator iter;
+
+    if (NULL == s || NULL == vals)
+        return -1;
+
+    if (0 == s->card || 0 == count)
+        return 0;
+
+    n = distinct ? (size_t) __min(count, s->card) : count;
+
+    if (distinct && n == s->card)
+    {
+        setIterSeek(&iter, s, 0);
+        return (int) setGetNextMany(&iter, vals, n);
+    }
+
+    if (NULL == (ranks = (valType *) malloc(n * sizeof(valType))))
+        return -1;
+
+    if (distinct)
+    {
+        // Floyd's algorithm: n distinct ranks out of card with n draws, table keeps ranks taken so far.
+        for (mask = 1; mask < 2 * n; mask <<= 1);
+        mask--;
+
+        if (NULL == (table = (valType *) malloc((mask + 1) * sizeof(valType))))
+        {
+            free(ranks);
+            return -1;
+        }
+
+        memset(table, 0xFF, (mask + 1) * sizeof(valType));
+
+        for (i = 0, j = s->card - n; j < s->card; j++)
+        {
+            valType t = (valType) (setRandNext() % (j + 1));
+
+            if (!setRankInsert(table, mask, t))
+            {
+                setRankInsert(table, mask, j);
+                t = j;
+            }
+
+            ranks[i++] = t;
+        }
+
+        free(table);
+    }
+    else
+    {
+        for (i = 0; i < n; i++)
+            ranks[i] = (valType) (setRandNext() % s->card);
+    }
+
+    qsort(ranks, n, sizeof(valType), valCompare);
+    setSelectRanks(s, ranks, n, vals);
+
+    free(ranks);
+    return (int) n;
+}
+
+unsigned setTrunc(set *s)
+{
+    valType length;
+    unsigned freed;
+
+    if (NULL == s || 0 == s->capacity)
+        return 0;
+
+    length = 0 == s->card ? 0 : s->length;
+
+    while (0 != length && 0 == s->data[length - 1])
+        length--;
+
+    freed = (unsigned) (s->capacity - length);
+    s->length = length;
+
+    if (0 == length)
+    {
+        setDataFree(s->data, s->capacity);
+        s->data = NULL;
+        s->capacity = 0;
+        return freed;
+    }
+
+    // Bitmap stays as it is if it can't be moved to a smaller block.
+    if (0 != setResize(s, length))
+        return 0;
+
+    return freed;
+}
+
+int setGetIter(const set *s, setIterator **iter)
+{
+    setIterator *i;
+    valType bit;
+
+    if (NULL == s)
+        return -1;
+
+    if (0 == s->length || 0 == s->card)
+    {
+        *iter = NULL;
+        return 0;
+    }
+
+    for (bit = 0; bit < 8 * s->length; bit++)
+    {
+        if (0 == bit % 8 && 0 == s->data[bit / 8])
+        {
+            bit += 7;
+            continue;
+        }
+
+        if (1 == setGetBit(s, bit))
+        {
+            if (NULL == (i = (setIterator *) malloc(sizeof(setIterator))))
+                return -1;
+
+            i->s = s;
+            i->i = bit;
+
+            *iter = i;
+
+            return 0;
+        }
+    }
+
+    *iter = NULL;
+
+    return 0;
+}
+
+int setGetNext(setIterator *iter)
+{
+    if (NULL == iter || NULL == iter->s || 0 == iter->s->length || 0 == iter->s->card)
+        return -1;
+
+    for (; iter->i < 8 * iter->s->length; )
+    {
+        // Skip empty words and bytes, sparse sets are mostly zeroes.
+        if (0 == iter->i % (8 * sizeof(size_t)) &&
+            iter->i / 8 + sizeof(size_t) <= iter->s->length &&
+            0 == *(const size_t *) (iter->s->data + iter->i / 8))
+        {
+            iter->i += 8 * sizeof(size_t);
+            continue;
+        }
+
+        if (0 == iter->i % 8 && 0 == iter->s->data[iter->i / 8])
+        {
+            iter->i += 8;
+            continue;
+        }
+
+        if (1 == setGetBit(iter->s, iter->i))
+        {
+            iter->val = iter->i;
+            iter->i++;
+            return 0;
+        }
+
+        iter->i++;
+    }
+
+    return -1;
+}
+
+void setIterSeek(setIterator *iter, const set *s, valType from)
+{
+    iter->s = s;
+    iter->i = from;
+    iter->val = 0;
+}
+
+size_t setGetNextMany(setIterator *iter, valType *vals, size_t max)
+{
+    size_t n = 0;
+
+    while (n < max && 0 == setGetNext(iter))
+        vals[n++] = iter->val;
+
+    return n;
+}
+
+int setCanHold(set *s, valType val)
+{
+    if (NULL == s)
+        return 0;
+
+    if (s->length * 8 >= val + 1)
+        return 1;
+
+    return 0;
+}
+
+int setGrow(set *s, valType val)
+{
+    valType newLen, capacity;
+
+    if (setCanHold(s, val))
+        return 0;
+
+    if (NULL == s)
+        return -1;
+
+    newLen = 1 + val / 8;
+
+    // Bytes past length are kept zero, so growing within capacity only moves length.
+    if (newLen > s->capacity)
+    {
+        capacity = s->capacity + __min(s->capacity, SET_GROW_MAX_STEP);
+        capacity = __max(capacity, newLen);
+        capacity = (capacity + sizeof(size_t) - 1) & ~(valType) (sizeof(size_t) - 1);
+
+        if (capacity >= SET_HUGE_THRESHOLD)
+            capacity = (capacity + SET_HUGE_ALIGN - 1) & ~(valType) (SET_HUGE_ALIGN - 1);
+
+        if (0 != setResize(s, capacity))
+            return -1;
+    }
+
+    s->length = newLen;
+    return 0;
+}
+
+int setSetBit(set *s, valType bit, unsigned val)
+{
+    valType byte = bit / 8;
+    char v = 1 << (bit % 8);
+
+    if (byte >= s->length * 8)
+        return -1;
+
+    // Make val 0 or 1;
+    if (val = val ? 1 : 0)
+        s->data[byte] |= v;
+    else
+        s->data[byte] &= ~v;
+
+    return val;
+}
+
+int setGetBit(const set *s, valType bit)
+{
+    valType byte = bit / 8;
+    char v = 1 << (bit % 8);
+
+    if (byte >= s->length)
+        return 0;
+
+    return 0 != (s->data[byte] & v);
+}
+
+unsigned char bitCountMatrix[256] =
+{
+    0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4, 1, 2, 2, 3, 2, 3, 3,
+    4, 2, 3, 3, 4, 3, 4, 4, 5, 1, 2, 2, 3, 2, 3, 3, 4, 2, 3, 3, 4, 3, 4,
+    4, 5, 2, 3, 3, 4, 3, 4, 4, 5, 3, 4, 4, 5, 4, 5, 5, 6, 1, 2, 2, 3, 2,
+    3, 3, 4, 2, 3, 3, 4, 3, 4, 4, 5, 2, 3, 3, 4, 3, 4, 4, 5, 3, 4, 4, 5,
+    4, 5, 5, 6, 2, 3, 3, 4, 3, 4, 4, 5, 3, 4, 4, 5, 4, 5, 5, 6, 3, 4, 4,
+    5, 4, 5, 5, 6, 4, 5, 5, 6, 5, 6, 6, 7, 1, 2, 2, 3, 2, 3, 3, 4, 2, 3,
+    3, 4, 3, 4, 4, 5, 2, 3, 3, 4, 3, 4, 4, 5, 3, 4, 4, 5, 4, 5, 5, 6, 2,
+    3, 3, 4, 3, 4, 4, 5, 3, 4, 4, 5, 4, 5, 5, 6, 3, 4, 4, 5, 4, 5, 5, 6,
+    4, 5, 5, 6, 5, 6, 6, 7, 2, 3, 3, 4, 3, 4, 4, 5, 3, 4, 4, 5, 4, 5, 5, 6,
+    3, 4, 4, 5, 4, 5, 5, 6, 4, 5, 5, 6, 5, 6, 6, 7, 3, 4, 4, 5, 4, 5, 5, 6,
+    4, 5, 5, 6, 5, 6, 6, 7, 4, 5, 5, 6, 5, 6, 6, 7, 5, 6, 6, 7, 6, 7, 7, 8
+};
+
+__inline static int byteBitCount(unsigned byte)
+{
+    return bitCountMatrix[byte & 0xff];
+}
+
+__inline static int wordBitCount(size_t word)
+{
+    word = word - ((word >> 1) & (~(size_t) 0 / 3));
+    word = (word & (~(size_t) 0 / 15 * 3)) + ((word >> 2) & (~(size_t) 0 / 15 * 3));
+    word = (word + (word >> 4)) & (~(size_t) 0 / 255 * 15);
+    return (int) ((word * (~(size_t) 0 / 255)) >> (sizeof(size_t) - 1) * 8);
+}
+
+// Bitmap kernels. Set data comes from malloc and blocks start at SET_BLOCK_SIZE boundaries,
+// so word access is aligned; the tail shorter than a word is processed bytewise.
+static valType bytesBitCount(const char *p, valType n)
+{
+    valType result = 0, i, words = n / sizeof(size_t);
+    const size_t *w = (const size_t *) p;
+
+    for (i = 0; i < words; i++)
+        result += wordBitCount(w[i]);
+
+    for (i = words * sizeof(size_t); i < n; i++)
+        result += byteBitCount(p[i]);
+
+    return result;
+}
+
+static void bytesOr(char *dst, const char *src, valType n)
+{
+    valType i, words = n / sizeof(size_t);
+    size_t *d = (size_t *) dst;
+    const size_t *s = (const size_t *) src;
+
+    for (i = 0; i < words; i++)
+        d[i] |= s[i];
+
+    for (i = words * sizeof(size_t); i < n; i++)
+        dst[i] |= src[i];
+}
+
+static void bytesAnd(char *dst, const char *src, valType n)
+{
+    valType i, words = n / sizeof(size_t);
+    size_t *d = (size_t *) dst;
+    const size_t *s = (const size_t *) src;
+
+    for (i = 0; i < words; i++)
+        d[i] &= s[i];
+
+    for (i = words * sizeof(size_t); i < n; i++)
+        dst[i] &= src[i];
+}
+
+static void bytesAndNot(char *dst, const char *src, valType n)
+{
+    valType i, words = n / sizeof(size_t);
+    size_t *d = (size_t *) dst;
+    const size_t *s = (const size_t *) src;
+
+    for (i = 0; i < words; i++)
+        d[i] &= ~s[i];
+
+    for (i = words * sizeof(size_t); i < n; i++)
+        dst[i] &= ~src[i];
+}
+
+static void bytesXor(char *dst, const char *src, valType n)
+{
+    valType i, words = n / sizeof(size_t);
+    size_t *d = (size_t *) dst;
+    const size_t *s = (const size_t *) src;
+
+    for (i = 0; i < words; i++)
+        d[i] ^= s[i];
+
+    for (i = words * sizeof(size_t); i < n; i++)
+        dst[i] ^= src[i];
+}
+
+__inline static size_t setLoadWord(const set *s, valType byte)
+{
+    size_t word = 0;
+
+    if (0 == s->card || byte >= s->length)
+        return 0;
+
+    if (byte + sizeof(size_t) <= s->length)
+        return *(const size_t *) (s->data + byte);
+
+    memcpy(&word, s->data + byte, s->length - byte);
+    return word;
+}
+
+__inline static void setStoreWord(set *s, valType byte, size_t word)
+{
+    if (byte + sizeof(size_t) <= s->length)
+        *(size_t *) (s->data + byte) = word;
+    else
+        memcpy(s->data + byte, &word, s->length - byte);
+}
+
+static valType setCountWords(const set **sets, size_t count, setWordOp op, int stopAtFirst)
+{
+    valType result = 0, length, byte;
+    size_t k, word;
+
+    if (NULL == sets || 0 == count)
+        return 0;
+
+    for (k = 0; k < count; k++)
+        if (NULL == sets[k])
+            return 0;
+
+    // Only bytes which can hold a member of the result are visited.
+    switch (op)
+    {
+        case setWordAnd:
+            length = sets[0]->length;
+            for (k = 0; k < count; k++)
+                length = 0 != sets[k]->card ? __min(length, sets[k]->length) : 0;
+            break;
+
+        case setWordAndNot:
+            length = 0 != sets[0]->card ? sets[0]->length : 0;
+            break;
+
+        default:
+            length = 0;
+            for (k = 0; k < count; k++)
+                if (0 != sets[k]->card)
+                    length = __max(length, sets[k]->length);
+            break;
+    }
+
+    for (byte = 0; byte < length; byte += sizeof(size_t))
+    {
+        word = setLoadWord(sets[0], byte);
+
+        for (k = 1; k < count; k++)
+        {
+            switch (op)
+            {
+                case setWordAnd:
+                    word &= setLoadWord(sets[k], byte);
+                    break;
+
+                case setWordOr:
+                    word |= setLoadWord(sets[k], byte);
+                    break;
+
+                case setWordAndNot:
+                    word &= ~setLoadWord(sets[k], byte);
+                    break;
+
+                case setWordXor:
+                    word ^= setLoadWord(sets[k], byte);
+                    break;
+            }
+
+            if (0 == word && setWordOr != op && setWordXor != op)
+                break;
+        }
+
+        if (0 != word)
+        {
+            result += wordBitCount(word);
+
+            if (stopAtFirst)
+                return result;
+        }
+    }
+
+    return result;
+}
+
+// SplitMix64, threads don't share state, so there is no contention on the CRT generator.
+static unsigned long long setRandNext(void)
+{
+    unsigned long long z;
+
+    if (0 == randState)
+        randState = ((unsigned long long) time(NULL) << 32) ^ (unsigned long long) (size_t) &z ^ clock() ^ 1;
+
+    z = (randState += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+static void setSelectRanks(const set *s, const valType *ranks, size_t count, valType *vals)
+{
+    valType byte, seen = 0;
+    size_t k = 0, word;
+    int bits;
+
+    for (byte = 0; byte < s->length && k < count; byte += sizeof(size_t))
+    {
+        if (0 == (word = setLoadWord(s, byte)))
+            continue;
+
+        bits = wordBitCount(word);
+
+        while (k < count && ranks[k] < seen + bits)
+        {
+            vals[k] = 8 * byte + wordSelect(word, ranks[k] - seen);
+            k++;
+        }
+
+        seen += bits;
+    }
+}
+
+__inline static unsigned wordSelect(size_t word, valType rank)
+{
+    unsigned bit = 0;
+
+    while (rank--)
+        word &= word - 1;
+
+    while (0 == (word >> bit & 1))
+        bit++;
+
+    return bit;
+}
+
+static int setRankInsert(valType *table, valType mask, valType rank)
+{
+    valType i = (valType) (rank * 0x9E3779B97F4A7C15ULL >> 17) & mask;
+
+    while ((valType) -1 != table[i])
+    {
+        if (rank == table[i])
+            return 0;
+
+        i = (i + 1) & mask;
+    }
+
+    table[i] = rank;
+    return 1;
+}
+
+static int valCompare(const void *a, const void *b)
+{
+    valType x = *(const valType *) a, y = *(const valType *) b;
+
+    return x < y ? -1 : x > y;
+}
+
+static int setResize(set *s, valType capacity)
+{
+    char *t = NULL;
+    valType keep = __min(s->length, capacity);
+
+    // Blocks on the same side of the threshold come from the same allocator and can be resized in place.
+    if (s->capacity < SET_HUGE_THRESHOLD && capacity < SET_HUGE_THRESHOLD)
+    {
+        if (NULL == (t = (char *) realloc(s->data, capacity)))
+            return -1;
+    }
+    else if (s->capacity >= SET_HUGE_THRESHOLD && capacity >= SET_HUGE_THRESHOLD)
+    {
+        if (NULL == (t = (char *) _aligned_realloc(s->data, capacity, SET_HUGE_ALIGN)))
+            return -1;
+    }
+    else
+    {
+        if (NULL == (t = setDataAlloc(capacity)))
+            return -1;
+
+        if (0 != keep)
+            memcpy(t, s->data, keep);
+
+        if (NULL != s->data)
+            setDataFree(s->data, s->capacity);
+    }
+
+    if (capacity > keep)
+        memset(t + keep, 0, capacity - keep);
+
+    s->data = t;
+    s->capacity = capacity;
+    return 0;
+}
+
+static char *setDataAlloc(valType capacity)
+{
+    if (capacity >= SET_HUGE_THRESHOLD)
+        return (char *) _aligned_malloc(capacity, SET_HUGE_ALIGN);
+
+    return (char *) malloc(capacity);
+}
+
+static void setDataFree(char *data, valType capacity)
+{
+    if (capacity >= SET_HUGE_THRESHOLD)
+        _aligned_free(data);
+    else
+        free(data);
+}
@@ -1,88 +1,173 @@
-// set.h - Set API and implementation.
-
-#ifndef __SET_H__
-#define __SET_H__
-
-#include "athena.h"
-
-// Set.
-typedef struct set
-{
-    char *data;
-    valType length; // In bytes.
-    valType card;
-    int registered;
-} set;
-
-// Set iterator.
-typedef struct setIterator
-{
-    const set *s;
-    valType i, val;
-} setIterator;
-
-// Public API.
-// Creates new set. Returns set pointer or null on error.
-set *setCreate(void);
-// Creates copy of set s. Returns pointer to new set or null on error.
-set *setCopy(const set *s);
-// Destroys set.
-void setDestroy(set *s);
-
-// Adds element to the set. Returns 0 on ok, 1 if element already exists, -1 on error.
-int setAdd(set *s, valType val);
-// Removes element from the set. Returns 0 on ok, 1 if element wasn't present, -1 on error.
-int setRemove(set *s, valType val);
-
-// Returns set cardinality.
-valType setCard(const set *s);
-// Gets random element from the set. Returns 0 on ok, -1 on error.
-int setGetRand(const set *s, valType *val);
-// Returns 1 if val is in set, 0 otherwise.
-int setIsMember(const set *s, valType val);
-
-// Returns set a - b or null on error.
-set *setDiff(const set *a, const set *b);
-// Returns set (a - b) + (b - a) or null on error.
-set *setSymDiff(const set *a, const set *b);
-// Returns set a * b or null on error.
-set *setInter(const set *a, const set *b);
-// Returns set a + b or null on error.
-set *setUnion(const set *a, const set *b);
-// Returns set A x B or null on error.
-set *setCartProd(const set *a, const set *b);
-// Returns boolean set of a or null on error.
-set *setBoolean(const set *a);
-// Returns flattened set.
-set *setFlatten(const set *s, int lock);
-
-// Returns 1 if a = b or -1 on error.
-int setCmpE(const set *a, const set *b);
-// Returns 1 if a is subset of b (A c B) or -1 on error.
-int setCmpSubset(const set *a, const set *b);
-// Returns 1 if a is subset of b (A c B) or a = b. Returns -1 on error
-int setCmpSubsetOrEq(const set *a, const set *b);
-
-// Returns number of bytes freed.
-unsigned setTrunc(set *s);
-
-// Gets set iterator pointing to the first set element. *iter is set to null if set is empty. Return 0 on ok or -1 on error.
-int setGetIter(const set *s, setIterator **iter);
-// Destroys set iterator.
-void setDestroyIter(setIterator *iter);
-// Gets next element from the set pointed by iter. Returns 0 on ok or -1 on error.
-int setGetNext(setIterator *iter);
-
-// Private API.
-// Returns 1 if s can hold val, 0 otherwise.
-int setCanHold(set *s, valType val);
-// Grows s to make it able to hold val. Returns -1 on error.
-static int setGrow(set *s, valType val);
-// Sets bit number "bit" in s to val. Returns val or -1 on error.
-static int setSetBit(set *s, valType bit, unsigned val);
-// Gets bit number "bit" in s. Returns bit value or -1 on error.
-static int setGetBit(const set *s, valType bit);
-// Count set bits in byte;
-__inline static int byteBitCount(unsigned byte);
-
-#endif /* __SET_H__ */
+// set.h - Set API and implementation.
+
+#ifndef __SET_H__
+#define __SET_H__
+
+#include "athena.h"
+
+// Bitmaps are processed in blocks of this many bytes, so n-ary operations
+// read each operand and write the result in one pass.
+#define SET_BLOCK_SIZE 4096
+
+// Growing bitmap at least doubles its capacity, but adds no more than SET_GROW_MAX_STEP bytes at once.
+#define SET_GROW_MAX_STEP (64 * 1024 * 1024)
+// Bitmaps of at least SET_HUGE_THRESHOLD bytes are allocated in whole huge pages.
+#define SET_HUGE_THRESHOLD (2 * 1024 * 1024)
+#define SET_HUGE_ALIGN (2 * 1024 * 1024)
+
+// Set.
+typedef struct set
+{
+    char *data;
+    valType length;     // In bytes.
+    valType capacity;   // Allocated bytes, ones past length are zero.
+    valType card;
+    int registered;
+    unsigned int hash;  // Object index hash, kept up to date while registered.
+} set;
+
+// Set iterator.
+typedef struct setIterator
+{
+    const set *s;
+    valType i, val;
+} setIterator;
+
+// Word operations of setApply and counting kernels.
+typedef enum setWordOp
+{
+    setWordAnd, setWordOr, setWordAndNot, setWordXor
+} setWordOp;
+
+// Public API.
+// Creates new set. Returns set pointer or null on error.
+set *setCreate(void);
+// Creates copy of set s. Returns pointer to new set or null on error.
+set *setCopy(const set *s);
+// Destroys set.
+void setDestroy(set *s);
+
+// Adds element to the set. Returns 0 on ok, 1 if element already exists, -1 on error.
+int setAdd(set *s, valType val);
+// Adds every element from from to to inclusive. Returns -1 on error.
+int setAddRange(set *s, valType from, valType to);
+// Adds count elements, runs of consecutive elements are added with setAddRange. Returns -1 on error.
+int setAddMany(set *s, const valType *vals, size_t count);
+// Removes element from the set. Returns 0 on ok, 1 if element wasn't present, -1 on error.
+int setRemove(set *s, valType val);
+
+// Returns set cardinality.
+valType setCard(const set *s);
+// Gets random element from the set. Returns 0 on ok, -1 on error.
+int setGetRand(const set *s, valType *val);
+// Samples count elements into vals in ascending order, distinct ones if distinct is set. Costs one pass
+// over the bitmap words and O(count) memory. Returns number of elements written, at most card for
+// distinct samples, or -1 on error.
+int setGetRandMany(const set *s, valType *vals, size_t count, int distinct);
+// Returns 1 if val is in set, 0 otherwise.
+int setIsMember(const set *s, valType val);
+// Gets smallest and largest element of the set. Returns 0 on ok, -1 if set is empty or on error.
+int setGetBounds(const set *s, valType *min, valType *max);
+
+// Returns set a - b or null on error.
+set *setDiff(const set *a, const set *b);
+// Returns set (a - b) + (b - a) or null on error.
+set *setSymDiff(const set *a, const set *b);
+// Returns set a * b or null on error.
+set *setInter(const set *a, const set *b);
+// Returns set a + b or null on error.
+set *setUnion(const set *a, const set *b);
+// Returns union of count sets or null on error.
+set *setUnionN(const set **sets, size_t count);
+// Returns intersection of count sets or null on error.
+set *setInterN(const set **sets, size_t count);
+// Returns sets[0] - sets[1] - ... - sets[count - 1] or null on error.
+set *setDiffN(const set **sets, size_t count);
+// Adds every member of src to dst in place. Returns -1 on error.
+int setMerge(set *dst, const set *src);
+// Removes every member of src from dst in place.
+void setSubtract(set *dst, const set *src);
+// Replaces dst with dst | src, dst & src or dst & ~src in one pass over the bitmap of dst. Members which
+// came or went are added to changed unless it's NULL, it must be empty. Returns -1 on error.
+int setApply(set *dst, const set *src, setWordOp op, set *changed);
+// Returns cardinality of intersection, union or difference of count sets without building it.
+valType setInterCardN(const set **sets, size_t count);
+valType setUnionCardN(const set **sets, size_t count);
+valType setDiffCardN(const set **sets, size_t count);
+// Returns cardinality of a ~ b without building it.
+valType setSymDiffCard(const set *a, const set *b);
+// Returns 1 if count sets have a common member, 0 otherwise. Stops at the first common word.
+int setIntersectsN(const set **sets, size_t count);
+// Sets *inter and *uni to cardinalities of a * b and a + b, both counted in one pass.
+void setInterUnionCard(const set *a, const set *b, valType *inter, valType *uni);
+// Returns boolean set of a or null on error.
+set *setBoolean(const set *a);
+// Returns flattened set.
+set *setFlatten(const set *s, int lock);
+
+// Returns 1 if a = b or -1 on error.
+int setCmpE(const set *a, const set *b);
+// Returns 1 if a is subset of b (A c B) or -1 on error.
+int setCmpSubset(const set *a, const set *b);
+// Returns 1 if a is subset of b (A c B) or a = b. Returns -1 on error
+int setCmpSubsetOrEq(const set *a, const set *b);
+
+// Drops trailing zero bytes and releases capacity past length, the only place capacity shrinks.
+// Returns number of bytes freed.
+unsigned setTrunc(set *s);
+
+// Gets set iterator pointing to the first set element. *iter is set to null if set is empty. Return 0 on ok or -1 on error.
+int setGetIter(const set *s, setIterator **iter);
+// Destroys set iterator.
+void setDestroyIter(setIterator *iter);
+// Gets next element from the set pointed by iter. Returns 0 on ok or -1 on error.
+int setGetNext(setIterator *iter);
+// Points iter at the first element of s not less than from, without allocating.
+void setIterSeek(setIterator *iter, const set *s, valType from);
+// Gets at most max next elements into vals. Returns number of elements fetched, 0 at the end of set.
+size_t setGetNextMany(setIterator *iter, valType *vals, size_t max);
+
+// Private API.
+// Returns 1 if s can hold val, 0 otherwise.
+int setCanHold(set *s, valType val);
+// Grows s to make it able to hold val. Returns -1 on error.
+static int setGrow(set *s, valType val);
+// Reallocates bitmap of s to capacity bytes, zeroing bytes past length. Returns -1 on error.
+static int setResize(set *s, valType capacity);
+// Returns uninitialized bitmap of capacity bytes or NULL on error.
+static char *setDataAlloc(valType capacity);
+// Frees bitmap allocated with capacity bytes.
+static void setDataFree(char *data, valType capacity);
+// Sets bit number "bit" in s to val. Returns val or -1 on error.
+static int setSetBit(set *s, valType bit, unsigned val);
+// Gets bit number "bit" in s. Returns bit value or -1 on error.
+static int setGetBit(const set *s, valType bit);
+// Count set bits in byte;
+__inline static int byteBitCount(unsigned byte);
+// Count set bits in machine word.
+__inline static int wordBitCount(size_t word);
+// Count set bits in n bytes of bitmap.
+static valType bytesBitCount(const char *p, valType n);
+// dst = dst | src, dst & src, dst & ~src, dst ^ src over n bytes.
+static void bytesOr(char *dst, const char *src, valType n);
+static void bytesAnd(char *dst, const char *src, valType n);
+static void bytesAndNot(char *dst, const char *src, valType n);
+static void bytesXor(char *dst, const char *src, valType n);
+// Returns machine word of s starting at byte, zero padded past the end of bitmap.
+__inline static size_t setLoadWord(const set *s, valType byte);
+// Writes word to s starting at byte, bytes past the end of bitmap are left out.
+__inline static void setStoreWord(set *s, valType byte, size_t word);
+// Returns next number of calling thread's generator, seeded on first use.
+static unsigned long long setRandNext(void);
+// Writes elements of s at ascending ranks to vals in one pass over the bitmap.
+static void setSelectRanks(const set *s, const valType *ranks, size_t count, valType *vals);
+// Returns position of set bit number rank in word.
+__inline static unsigned wordSelect(size_t word, valType rank);
+// Adds rank to open addressing table of mask + 1 slots. Returns 1 if added, 0 if already there.
+static int setRankInsert(valType *table, valType mask, valType rank);
+static int valCompare(const void *a, const void *b);
+// Counts bits of sets[0] op sets[1] op ... word by word without allocation.
+// If stopAtFirst is set, returns as soon as a non-zero word is found.
+static valType setCountWords(const set **sets, size_t count, setWordOp op, int stopAtFirst);
+
+#endif /* __SET_H__ */
@@ -1,141 +1,179 @@
-// tokenizer.h - Fetches tokens from input stream.
-
-#include <stdlib.h>
-#include <ctype.h>
-
-#include "sds.h"
-
-#include "athena.h"
-#include "tokenizer.h"
-
-tokenType fetchToken(const sds s, size_t *pos, char **tokenPtr, size_t *tokenLen)
-{
-    if (NULL == s || 0 == strlen(s) || NULL == pos || NULL == tokenPtr || NULL == tokenLen)
-        return tokenError;
-
-    if (*pos >= strlen(s))
-    {
-        *tokenLen = 0;
-        return tokenEnd;
-    }
-
-    while (*pos < strlen(s) && isspace(s[*pos]))
-        (*pos)++;
-
-    if (*pos >= strlen(s))
-    {
-        *tokenLen = 0;
-        return tokenEnd;
-    }
-
-    switch (s[*pos])
-    {
-        case '{':
-            *tokenPtr = &(s[*pos]);
-            *tokenLen = 1;
-            (*pos)++;
-            return tokenSetStart;
-
-        case '[':
-            *tokenPtr = &(s[*pos]);
-            *tokenLen = 1;
-            (*pos)++;
-            return tokenTupleStart;
-
-        case '}':
-            *tokenPtr = &(s[*pos]);
-            *tokenLen = 1;
-            (*pos)++;
-            return tokenSetEnd;
-
-        case ']':
-            *tokenPtr = &(s[*pos]);
-            *tokenLen = 1;
-            (*pos)++;
-            return tokenTupleEnd;
-
-        case '(':
-            *tokenPtr = &(s[*pos]);
-            *tokenLen = 1;
-            (*pos)++;
-            return tokenLeftBrace;
-
-        case ')':
-            *tokenPtr = &(s[*pos]);
-            *tokenLen = 1;
-            (*pos)++;
-            return tokenRightBrace;
-
-        case ',':
-            *tokenPtr = &(s[*pos]);
-            *tokenLen = 1;
-            (*pos)++;
-            return tokenDelim;
-
-        case '+':
-            *tokenPtr = &(s[*pos]);
-            *tokenLen = 1;
-            (*pos)++;
-            return tokenPlus;
-
-        case '-':
-            *tokenPtr = &(s[*pos]);
-            *tokenLen = 1;
-            (*pos)++;
-            return tokenMinus;
-
-        case '*':
-            *tokenPtr = &(s[*pos]);
-            *tokenLen = 1;
-            (*pos)++;
-            return tokenMultiply;
-
-        case '~':
-            *tokenPtr = &(s[*pos]);
-            *tokenLen = 1;
-            (*pos)++;
-            return tokenSymDiff;
-
-        case '@':
-            *tokenPtr = &(s[*pos]);
-            *tokenLen = 1;
-            (*pos)++;
-            return tokenCartProd;
-
-        case '^':
-            *tokenPtr = &(s[*pos]);
-            *tokenLen = 1;
-            (*pos)++;
-            return tokenBoolean;
-
-        default:
-            if (isdigit(s[*pos]))
-            {
-                *tokenPtr = &(s[*pos]);
-                *tokenLen = 0;
-
-                while (*pos < strlen(s) && isdigit(s[*pos]))
-                {
-                    (*pos)++;
-                    (*tokenLen)++;
-                }
-
-                return tokenVal;
-            }
-            else if (isalpha(s[*pos]))
-            {
-                *tokenPtr = &(s[*pos]);
-                *tokenLen = 0;
-
-                while (*pos < strlen(s) && (isalpha(s[*pos]) || isdigit(s[*pos])))
-                {
-                    (*pos)++;
-                    (*tokenLen)++;
-                }
-
-                return tokenIdentifier;
-            }
-
-            return tokenError;
-    }
-}
+// tokenizer.h - Fetches tokens from input stream.
+
+#include <stdlib.h>
+#include <memory.h>
+
+#include "sds.h"
+
+#include "athena.h"
+#include "tokenizer.h"
+
+// Character classes.
+#define CHAR_SPACE 1
+#define CHAR_DIGIT 2
+#define CHAR_ALPHA 4
+
+static const unsigned char charClass[256] =
+{
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 1, 0, 0,     // \t \n \v \f \r
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,     // ' '
+    2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 0, 0, 0, 0, 0, 0,     // 0-9
+    0, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,     // A-O
+    4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 0, 0, 0, 0, 0,     // P-Z
+    0, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,     // a-o
+    4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 0, 0, 0, 0, 0      // p-z
+};
+
+static tokenType charToken(char c);
+static __inline size_t scanDigits(const char *p, size_t len);
+static __inline unsigned long long loadWord(const char *p);
+
+tokenType fetchToken(const sds s, size_t *pos, char **tokenPtr, size_t *tokenLen)
+{
+    size_t len, start;
+    const unsigned char *p = (const unsigned char *) s;
+    tokenType tt;
+
+    if (NULL == s || NULL == pos || NULL == tokenPtr || NULL == tokenLen)
+        return tokenError;
+
+    len = sdslen(s);
+
+    while (*pos < len && (charClass[p[*pos]] & CHAR_SPACE))
+        (*pos)++;
+
+    if (*pos >= len)
+    {
+        *tokenLen = 0;
+        return tokenEnd;
+    }
+
+    start = *pos;
+    *tokenPtr = &(s[start]);
+
+    if (charClass[p[start]] & CHAR_DIGIT)
+    {
+        *tokenLen = scanDigits(&(s[start]), len - start);
+        *pos += *tokenLen;
+        return tokenVal;
+    }
+
+    if (charClass[p[start]] & CHAR_ALPHA)
+    {
+        while (*pos < len && (charClass[p[*pos]] & (CHAR_ALPHA | CHAR_DIGIT)))
+            (*pos)++;
+
+        *tokenLen = *pos - start;
+        return tokenIdentifier;
+    }
+
+    if ('.' == s[start])
+    {
+        if (start + 1 >= len || '.' != s[start + 1])
+            return tokenError;
+
+        *tokenLen = 2;
+        *pos += 2;
+        return tokenDots;
+    }
+
+    if (tokenError != (tt = charToken(s[start])))
+    {
+        *tokenLen = 1;
+        (*pos)++;
+    }
+
+    return tt;
+}
+
+valType tokenToVal(const char *p, size_t len)
+{
+    valType result = 0;
+    unsigned long long chunk;
+
+    // Eight digits at a time: pairs, then quads, then the whole group are combined in place.
+    while (len >= 8)
+    {
+        chunk = loadWord(p) - 0x3030303030303030ULL;
+        chunk = (chunk * 10 + (chunk >> 8)) & 0x00FF00FF00FF00FFULL;
+        chunk = (chunk * 100 + (chunk >> 16)) & 0x0000FFFF0000FFFFULL;
+        chunk = (chunk * 10000 + (chunk >> 32)) & 0x00000000FFFFFFFFULL;
+
+        result = result * 100000000 + (valType) chunk;
+        p += 8;
+        len -= 8;
+    }
+
+    while (len--)
+        result = result * 10 + (*p++ - '0');
+
+    return result;
+}
+
+// Private api.
+// Returns token made of single character c or tokenError.
+static tokenType charToken(char c)
+{
+    switch (c)
+    {
+        case '{': return tokenSetStart;
+        case '}': return tokenSetEnd;
+        case '[': return tokenTupleStart;
+        case ']': return tokenTupleEnd;
+        case '(': return tokenLeftBrace;
+        case ')': return tokenRightBrace;
+        case ',': return tokenDelim;
+        case '+': return tokenPlus;
+        case '-': return tokenMinus;
+        case '*': return tokenMultiply;
+        case '~': return tokenSymDiff;
+        case '@': return tokenCartProd;
+        case '^': return tokenBoolean;
+        case ';': return tokenCompose;
+        case '!': return tokenInverse;
+        case '<': return tokenDomain;
+        case '>': return tokenRange;
+        case '&': return tokenClosure;
+        case '#': return tokenProject;
+        case '$': return tokenJoin;
+        case '|': return tokenSelect;
+    }
+
+    return tokenError;
+}
+
+// Returns length of digit run at p, at most len. Whole words are checked at once.
+static __inline size_t scanDigits(const char *p, size_t len)
+{
+    size_t n = 0;
+    unsigned long long w;
+
+    // Every byte is a digit if its high nibble is 3 and adding 6 doesn't carry into it.
+    while (n + 8 <= len)
+    {
+        w = loadWord(p + n);
+
+        if (0x3030303030303030ULL != (w & 0xF0F0F0F0F0F0F0F0ULL) ||
+            0x3030303030303030ULL != ((w + 0x0606060606060606ULL) & 0xF0F0F0F0F0F0F0F0ULL))
+        {
+            break;
+        }
+
+        n += 8;
+    }
+
+    while (n < len && (charClass[(unsigned char) p[n]] & CHAR_DIGIT))
+        n++;
+
+    return n;
+}
+
+// Loads 8 bytes at p, first byte lowest.
+static __inline unsigned long long loadWord(const char *p)
+{
+    unsigned long long w;
+
+    memcpy(&w, p, sizeof(w));
+    return w;
+}
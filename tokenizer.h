@@ -1,17 +1,21 @@
-// tokenizer.h - Fetches tokens from input stream.
-
-#ifndef __TOKENIZER_H__
-#define __TOKENIZER_H__
-
-typedef enum tokenType
-{
-    tokenSetStart, tokenSetEnd, tokenTupleStart, tokenTupleEnd, tokenVal, tokenError, tokenEnd,
-    tokenLeftBrace, tokenRightBrace, tokenDelim,
-    tokenPlus, tokenMinus, tokenMultiply, tokenSymDiff, tokenCartProd, tokenBoolean, tokenIdentifier
-} tokenType;
-
-// Fetches next token from s and advances pos to next one.
-// Returns tokenType or error and sets tokenPtr to fetched token.
-tokenType fetchToken(const sds s, size_t *pos, char **tokenPtr, size_t *tokenLen);
-
-#endif /* __TOKENIZER_H__ */
+// tokenizer.h - Fetches tokens from input stream.
+
+#ifndef __TOKENIZER_H__
+#define __TOKENIZER_H__
+
+typedef enum tokenType
+{
+    tokenSetStart, tokenSetEnd, tokenTupleStart, tokenTupleEnd, tokenVal, tokenError, tokenEnd,
+    tokenLeftBrace, tokenRightBrace, tokenDelim,
+    tokenPlus, tokenMinus, tokenMultiply, tokenSymDiff, tokenCartProd, tokenBoolean, tokenIdentifier,
+    tokenCompose, tokenInverse, tokenDomain, tokenRange, tokenClosure, tokenProject, tokenJoin, tokenSelect,
+    tokenDots
+} tokenType;
+
+// Fetches next token from s and advances pos to next one.
+// Returns tokenType or error and sets tokenPtr to fetched token.
+tokenType fetchToken(const sds s, size_t *pos, char **tokenPtr, size_t *tokenLen);
+// Converts len decimal digits at p to value.
+valType tokenToVal(const char *p, size_t len);
+
+#endif /* __TOKENIZER_H__ */
@@ -1,199 +1,552 @@
-// tuple.c - Tuple utils.
-
-#include <stdio.h>
-#include <stdlib.h>
-
-#include "adlist.h"
-
-#include "athena.h"
-#include "setutils.h"
-#include "tuple.h"
-#include "dbengine.h"
-#include "syncengine.h"
-#include "dbobject.h"
-#include "eval.h"
-
-dbObject *tupleParse(const sds s, size_t *pos, valType *id)
-{
-    dbObject *newTuple = NULL;
-    if (NULL == (newTuple = eval(s, pos)))
-        return NULL;
-
-    if (objectTuple != newTuple->objectType)
-    {
-        dbUnregisterObject(newTuple->id);
-        return NULL;
-    }
-
-    *id = newTuple->id;
-    return newTuple;
-}
-
-int tupleCmp(list *a, list *b)
-{
-    listIter *aIter = NULL, *bIter = NULL;
-    listNode *ai = NULL, *bi = NULL;
-
-    if (NULL == a || NULL == b)
-        return -1;
-
-    if (listLength(a) != listLength(b))
-    {
-        return 0;
-    }
-
-    if (NULL == (aIter = listGetIterator(a, AL_START_HEAD)))
-    {
-        return -1;
-    }
-
-    if (NULL == (bIter = listGetIterator(b, AL_START_HEAD)))
-    {
-        listReleaseIterator(aIter);
-        return -1;
-    }
-
-    while (NULL != (ai = listNext(aIter)) && NULL != (bi = listNext(bIter)))
-    {
-        if (ai->value != bi->value)
-        {
-            listReleaseIterator(aIter);
-            listReleaseIterator(bIter);
-            return 0;
-        }
-    }
-
-    listReleaseIterator(aIter);
-    listReleaseIterator(bIter);
-    return 1;
-}
-
-int tuplePrint(list *tuple, FILE *f, int lock)
-{
-    listIter *iter = NULL;
-    listNode *node = NULL;
-    valType counter = 0;
-
-    if (NULL == tuple || NULL == f)
-        return -1;
-
-    fprintf(f, "[ ");
-    if (NULL == (iter = listGetIterator(tuple, AL_START_HEAD)))
-    {
-        fprintf(f, "]");
-        return 0;
-    }
-
-    while (NULL != (node = listNext(iter)))
-    {
-        const dbObject *obj = dbGetObject((valType) listNodeValue(node), lock);
-
-        if (NULL == obj)
-        {
-            fprintf(f, "(null)");
-        }
-        else
-        {
-            dbObjectPrint(obj, f, lock);
-        }
-
-        counter++;
-        if (counter < listLength(tuple))
-            fprintf(f, ",");
-
-        fprintf(f, " ");
-    }
-
-    fprintf(f, "]");
-
-    listReleaseIterator(iter);
-    return 0;
-}
-
-set *tupleFlatten(list *t, int lock)
-{
-    listIter *iter = NULL;
-    listNode *node = NULL;
-    set *result = NULL;
-
-    if (NULL == t)
-        return NULL;
-
-    if (NULL == (result = setCreate()))
-        return NULL;
-
-    lockRead(t);
-    if (NULL == (iter = listGetIterator(t, AL_START_HEAD)))
-    {
-        unlockRead(t);
-        setDestroy(result);
-        return NULL;
-    }
-
-    while (NULL != (node = listNext(iter)))
-    {
-        valType objId = (valType) listNodeValue(node);
-        const dbObject *obj = dbGetObject(objId, lock);
-
-        if (NULL == obj)
-            continue;
-
-        if (-1 == setAdd(result, objId))
-        {
-            unlockRead(t);
-            listReleaseIterator(iter);
-            setDestroy(result);
-            return NULL;
-        }
-
-        switch (obj->objectType)
-        {
-            case objectSet:
-                {
-                    set *flattened = setFlatten(obj->objectPtr.setPtr, lock);
-                    set *mergeResult = NULL;
-
-                    if (NULL == flattened)
-                        continue;
-
-                    mergeResult = setUnion(result, flattened);
-                    setDestroy(flattened);
-                    setDestroy(result);
-                    if (NULL == mergeResult)
-                    {
-                        unlockRead(t);
-                        listReleaseIterator(iter);
-                        return NULL;
-                    }
-                    result = mergeResult;
-                }
-                break;
-
-            case objectTuple:
-                {
-                    set *flattened = tupleFlatten(obj->objectPtr.tuplePtr, lock);
-                    set *mergeResult = NULL;
-
-                    if (NULL == flattened)
-                        continue;
-
-                    mergeResult = setUnion(result, flattened);
-                    setDestroy(flattened);
-                    setDestroy(result);
-                    if (NULL == mergeResult)
-                    {
-                        unlockRead(t);
-                        listReleaseIterator(iter);
-                        return NULL;
-                    }
-                    result = mergeResult;
-                }
-                break;
-        }
-    }
-
-    unlockRead(t);
-    listReleaseIterator(iter);
-
-    return result;
-}
+// tuple.c - Tuple utils.
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "adlist.h"
+#include "dict.h"
+
+#include "athena.h"
+#include "setutils.h"
+#include "tuple.h"
+#include "dbengine.h"
+#include "syncengine.h"
+#include "dbobject.h"
+#include "eval.h"
+#include "reply.h"
+
+static dictType dictJoinType;
+
+static const list *tupleMember(valType id, int lock);
+static int tupleComponent(const list *t, valType pos, valType *id);
+
+dbObject *tupleParse(const sds s, size_t *pos, valType *id)
+{
+    dbObject *newTuple = NULL;
+    if (NULL == (newTuple = eval(s, pos)))
+        return NULL;
+
+    if (objectTuple != newTuple->objectType)
+    {
+        dbUnregisterObject(newTuple->id);
+        return NULL;
+    }
+
+    *id = newTuple->id;
+    return newTuple;
+}
+
+int tupleCmp(list *a, list *b)
+{
+    listIter *aIter = NULL, *bIter = NULL;
+    listNode *ai = NULL, *bi = NULL;
+
+    if (NULL == a || NULL == b)
+        return -1;
+
+    if (listLength(a) != listLength(b))
+    {
+        return 0;
+    }
+
+    if (NULL == (aIter = listGetIterator(a, AL_START_HEAD)))
+    {
+        return -1;
+    }
+
+    if (NULL == (bIter = listGetIterator(b, AL_START_HEAD)))
+    {
+        listReleaseIterator(aIter);
+        return -1;
+    }
+
+    while (NULL != (ai = listNext(aIter)) && NULL != (bi = listNext(bIter)))
+    {
+        if (ai->value != bi->value)
+        {
+            listReleaseIterator(aIter);
+            listReleaseIterator(bIter);
+            return 0;
+        }
+    }
+
+    listReleaseIterator(aIter);
+    listReleaseIterator(bIter);
+    return 1;
+}
+
+int tuplePrint(list *tuple, reply *r, int lock)
+{
+    if (NULL == tuple || NULL == r)
+        return -1;
+
+    return replyTuple(r, tuple, lock);
+}
+
+set *tupleFlatten(list *t, int lock)
+{
+    listIter *iter = NULL;
+    listNode *node = NULL;
+    set *result = NULL;
+
+    if (NULL == t)
+        return NULL;
+
+    if (NULL == (result = setCreate()))
+        return NULL;
+
+    lockRead(t);
+    if (NULL == (iter = listGetIterator(t, AL_START_HEAD)))
+    {
+        unlockRead(t);
+        setDestroy(result);
+        return NULL;
+    }
+
+    while (NULL != (node = listNext(iter)))
+    {
+        valType objId = (valType) listNodeValue(node);
+        const dbObject *obj = dbGetObject(objId, lock);
+
+        if (NULL == obj)
+            continue;
+
+        if (-1 == setAdd(result, objId))
+        {
+            unlockRead(t);
+            listReleaseIterator(iter);
+            setDestroy(result);
+            return NULL;
+        }
+
+        switch (obj->objectType)
+        {
+            case objectSet:
+            case objectPowerSet:
+            case objectCartProd:
+            case objectRelation:
+                {
+                    set *flattened = dbObjectFlatten(obj, lock);
+                    set *mergeResult = NULL;
+
+                    if (NULL == flattened)
+                        continue;
+
+                    mergeResult = setUnion(result, flattened);
+                    setDestroy(flattened);
+                    setDestroy(result);
+                    if (NULL == mergeResult)
+                    {
+                        unlockRead(t);
+                        listReleaseIterator(iter);
+                        return NULL;
+                    }
+                    result = mergeResult;
+                }
+                break;
+
+            case objectTuple:
+                {
+                    set *flattened = tupleFlatten(obj->objectPtr.tuplePtr, lock);
+                    set *mergeResult = NULL;
+
+                    if (NULL == flattened)
+                        continue;
+
+                    mergeResult = setUnion(result, flattened);
+                    setDestroy(flattened);
+                    setDestroy(result);
+                    if (NULL == mergeResult)
+                    {
+                        unlockRead(t);
+                        listReleaseIterator(iter);
+                        return NULL;
+                    }
+                    result = mergeResult;
+                }
+                break;
+        }
+    }
+
+    unlockRead(t);
+    listReleaseIterator(iter);
+
+    return result;
+}
+
+set *tupleProject(const set *s, const valType *positions, size_t count, int lock)
+{
+    set *result = NULL;
+    setIterator *iter = NULL;
+    tupleBatch *batch = NULL;
+    list *projected = NULL;
+    valType component;
+    size_t k;
+    int failed = 0;
+
+    if (NULL == s || NULL == positions || 0 == count)
+        return NULL;
+
+    if (NULL == (result = setCreate()))
+        return NULL;
+
+    if (NULL == (batch = (tupleBatch *) calloc(1, sizeof(tupleBatch))) ||
+        0 != setGetIter(s, &iter))
+    {
+        free(batch);
+        setDestroy(result);
+        return NULL;
+    }
+
+    while (!failed && NULL != iter && 0 == setGetNext(iter))
+    {
+        const list *t = tupleMember(iter->val, lock);
+
+        if (NULL == t)
+            continue;
+
+        for (k = 0; k < count && positions[k] < listLength(t); k++);
+
+        // Tuple is too short.
+        if (k < count)
+            continue;
+
+        if (1 == count)
+        {
+            tupleComponent(t, positions[0], &component);
+            failed = -1 == setAdd(result, component);
+            continue;
+        }
+
+        if (NULL == (projected = listCreate()))
+        {
+            failed = 1;
+            break;
+        }
+
+        for (k = 0; k < count && !failed; k++)
+        {
+            tupleComponent(t, positions[k], &component);
+            failed = NULL == listAddNodeTail(projected, (void *) component);
+        }
+
+        if (failed)
+            listRelease(projected);
+        else
+            failed = 0 != tupleBatchAdd(batch, projected, result);
+    }
+
+    setDestroyIter(iter);
+
+    if (failed || 0 != tupleBatchFlush(batch, result))
+    {
+        tupleBatchDiscard(batch);
+        free(batch);
+        setDestroy(result);
+        return NULL;
+    }
+
+    free(batch);
+    return result;
+}
+
+set *tupleSelect(const set *s, valType pos, valType id, int lock)
+{
+    set *result = NULL;
+    setIterator *iter = NULL;
+    valType component;
+
+    if (NULL == s)
+        return NULL;
+
+    if (pos < TUPLE_INDEX_POSITIONS)
+        return dbTupleIndexInter(s, pos, id, lock);
+
+    if (NULL == (result = setCreate()))
+        return NULL;
+
+    if (0 != setGetIter(s, &iter))
+    {
+        setDestroy(result);
+        return NULL;
+    }
+
+    while (NULL != iter && 0 == setGetNext(iter))
+    {
+        const list *t = tupleMember(iter->val, lock);
+
+        if (NULL != t && 0 == tupleComponent(t, pos, &component) && id == component &&
+            -1 == setAdd(result, iter->val))
+        {
+            setDestroyIter(iter);
+            setDestroy(result);
+            return NULL;
+        }
+    }
+
+    setDestroyIter(iter);
+    return result;
+}
+
+set *tupleJoin(const set *a, valType i, const set *b, valType j, int lock)
+{
+    const set *build = NULL, *probe = NULL;
+    valType buildPos, probePos, component;
+    int buildIsLeft;
+    dict *table = NULL;
+    set *result = NULL;
+    setIterator *iter = NULL;
+    tupleBatch *batch = NULL;
+    list *bucket = NULL;
+    int failed = 0;
+
+    if (NULL == a || NULL == b)
+        return NULL;
+
+    buildIsLeft = a->card <= b->card;
+    build = buildIsLeft ? a : b;
+    probe = buildIsLeft ? b : a;
+    buildPos = buildIsLeft ? i : j;
+    probePos = buildIsLeft ? j : i;
+
+    if (NULL == (result = setCreate()))
+        return NULL;
+
+    if (NULL == (table = dictCreate(&dictJoinType, NULL)))
+    {
+        setDestroy(result);
+        return NULL;
+    }
+
+    // Build: component id -> tuples of the smaller side having it at buildPos.
+    if (0 != setGetIter(build, &iter))
+        failed = 1;
+
+    while (!failed && NULL != iter && 0 == setGetNext(iter))
+    {
+        const list *t = tupleMember(iter->val, lock);
+
+        if (NULL == t || 0 != tupleComponent(t, buildPos, &component))
+            continue;
+
+        if (NULL == (bucket = (list *) dictFetchValue(table, (void *) component)))
+        {
+            if (NULL == (bucket = listCreate()))
+            {
+                failed = 1;
+                break;
+            }
+
+            if (DICT_OK != dictAdd(table, (void *) component, bucket))
+            {
+                listRelease(bucket);
+                failed = 1;
+                break;
+            }
+        }
+
+        if (NULL == listAddNodeTail(bucket, (void *) t))
+            failed = 1;
+    }
+
+    setDestroyIter(iter);
+    iter = NULL;
+
+    // Probe.
+    if (failed ||
+        NULL == (batch = (tupleBatch *) calloc(1, sizeof(tupleBatch))) ||
+        0 != setGetIter(probe, &iter))
+    {
+        failed = 1;
+    }
+
+    while (!failed && NULL != iter && 0 == setGetNext(iter))
+    {
+        const list *t = tupleMember(iter->val, lock);
+        listNode *match = NULL, *node = NULL;
+
+        if (NULL == t || 0 != tupleComponent(t, probePos, &component) ||
+            NULL == (bucket = (list *) dictFetchValue(table, (void *) component)))
+        {
+            continue;
+        }
+
+        for (match = listFirst(bucket); NULL != match && !failed; match = listNextNode(match))
+        {
+            const list *left = buildIsLeft ? (const list *) listNodeValue(match) : t;
+            const list *right = buildIsLeft ? t : (const list *) listNodeValue(match);
+            list *joined = NULL;
+
+            if (NULL == (joined = listDup((list *) left)))
+            {
+                failed = 1;
+                break;
+            }
+
+            for (node = listFirst(right); NULL != node; node = listNextNode(node))
+            {
+                if (NULL == listAddNodeTail(joined, listNodeValue(node)))
+                {
+                    failed = 1;
+                    break;
+                }
+            }
+
+            if (failed)
+            {
+                listRelease(joined);
+                break;
+            }
+
+            if (0 != tupleBatchAdd(batch, joined, result))
+                failed = 1;
+        }
+    }
+
+    setDestroyIter(iter);
+    dictRelease(table);
+
+    if (failed || 0 != tupleBatchFlush(batch, result))
+    {
+        tupleBatchDiscard(batch);
+        free(batch);
+        setDestroy(result);
+        return NULL;
+    }
+
+    free(batch);
+    return result;
+}
+
+int tupleBatchAdd(tupleBatch *batch, list *t, set *result)
+{
+    dbObject *obj = NULL;
+
+    if (NULL == batch || NULL == t || NULL == result)
+        return -1;
+
+    if (TUPLE_BATCH_SIZE == batch->count && 0 != tupleBatchFlush(batch, result))
+    {
+        listRelease(t);
+        return -1;
+    }
+
+    if (NULL == (obj = (dbObject *) calloc(1, sizeof(dbObject))))
+    {
+        listRelease(t);
+        return -1;
+    }
+
+    obj->objectType = objectTuple;
+    obj->objectPtr.tuplePtr = t;
+    batch->objects[batch->count++] = obj;
+    return 0;
+}
+
+int tupleBatchAddPair(tupleBatch *batch, valType x, valType y, set *result)
+{
+    list *t = NULL;
+
+    if (NULL == batch || NULL == result || NULL == (t = listCreate()))
+        return -1;
+
+    if (NULL == listAddNodeTail(t, (void *) x) ||
+        NULL == listAddNodeTail(t, (void *) y))
+    {
+        listRelease(t);
+        return -1;
+    }
+
+    return tupleBatchAdd(batch, t, result);
+}
+
+int tupleBatchFlush(tupleBatch *batch, set *result)
+{
+    size_t k, count;
+
+    if (NULL == batch || NULL == result)
+        return -1;
+
+    if (0 == (count = batch->count))
+        return 0;
+
+    batch->count = 0;
+
+    if (0 != dbRegisterObjects(batch->objects, count, batch->ids))
+        return -1;
+
+    for (k = 0; k < count; k++)
+        if (-1 == setAdd(result, batch->ids[k]))
+            return -1;
+
+    return 0;
+}
+
+void tupleBatchDiscard(tupleBatch *batch)
+{
+    size_t k;
+
+    if (NULL == batch)
+        return;
+
+    for (k = 0; k < batch->count; k++)
+    {
+        dbObjectRelease(batch->objects[k]);
+        free(batch->objects[k]);
+    }
+
+    batch->count = 0;
+}
+
+// Private api.
+// Returns tuple with given id or NULL if it isn't a tuple.
+static const list *tupleMember(valType id, int lock)
+{
+    const dbObject *obj = dbGetObject(id, lock);
+
+    if (NULL == obj || objectTuple != obj->objectType)
+        return NULL;
+
+    return obj->objectPtr.tuplePtr;
+}
+
+// Returns -1 if t is too short.
+static int tupleComponent(const list *t, valType pos, valType *id)
+{
+    listNode *node = NULL;
+
+    if (pos >= listLength(t))
+        return -1;
+
+    for (node = listFirst(t); 0 != pos; pos--)
+        node = listNextNode(node);
+
+    *id = (valType) listNodeValue(node);
+    return 0;
+}
+
+unsigned int dictJoinKeyHash(const void *key);
+void dictJoinValDestructor(void *privdata, void *val);
+
+/* Join table, keys are component ids, vals are lists of tuples. */
+static dictType dictJoinType =
+{
+    dictJoinKeyHash,             /* hash function */
+    NULL,                        /* key dup */
+    NULL,                        /* val dup */
+    NULL,                        /* key compare */
+    NULL,                        /* key destructor */
+    dictJoinValDestructor        /* val destructor */
+};
+
+unsigned int dictJoinKeyHash(const void *key)
+{
+    return dictIntHashFunction((unsigned int) (valType) key);
+}
+
+void dictJoinValDestructor(void *privdata, void *val)
+{
+    DICT_NOTUSED(privdata);
+
+    listRelease((list *) val);
+}
@@ -1,27 +1,60 @@
-// tuple.h - Tuple utils.
-
-#ifndef __TUPLE_H__
-#define __TUPLE_H__
-
-#include <stdlib.h>
-
-#include "adlist.h"
-#include "sds.h"
-
-#include "dbobject.h"
-#include "set.h"
-
-// Parses tuple from string s and registers it in object index.
-// Returns NULL on error.
-dbObject *tupleParse(const sds s, size_t *pos, valType *id);
-
-// Compares given tuples. Returns 1 on eq, 0 on not eq, -1 on error.
-int tupleCmp(list *a, list *b);
-
-// Returns flattened list.
-set *tupleFlatten(list *t, int lock);
-
-// Returns -1 on error.
-int tuplePrint(list *tuple, FILE *f, int lock);
-
-#endif /* __TUPLE_H__ */
+// tuple.h - Tuple utils.
+
+#ifndef __TUPLE_H__
+#define __TUPLE_H__
+
+#include <stdlib.h>
+
+#include "adlist.h"
+#include "sds.h"
+
+#include "dbobject.h"
+#include "set.h"
+#include "reply.h"
+
+// Tuples built in bulk are registered in batches of this size.
+#define TUPLE_BATCH_SIZE 1024
+
+// Tuples waiting for registration.
+typedef struct tupleBatch
+{
+    dbObject *objects[TUPLE_BATCH_SIZE];
+    valType ids[TUPLE_BATCH_SIZE];
+    size_t count;
+} tupleBatch;
+
+// Parses tuple from string s and registers it in object index.
+// Returns NULL on error.
+dbObject *tupleParse(const sds s, size_t *pos, valType *id);
+
+// Compares given tuples. Returns 1 on eq, 0 on not eq, -1 on error.
+int tupleCmp(list *a, list *b);
+
+// Returns flattened list.
+set *tupleFlatten(list *t, int lock);
+
+// Returns -1 on error.
+int tuplePrint(list *tuple, reply *r, int lock);
+
+// Returns set of tuples made of components at positions of every tuple in s long enough for them.
+// With a single position the components themselves are collected. Returns NULL on error.
+set *tupleProject(const set *s, const valType *positions, size_t count, int lock);
+
+// Returns set of tuples in s having object id at position pos. Positions below TUPLE_INDEX_POSITIONS
+// are answered from the positional index, others by scanning s. Returns NULL on error.
+set *tupleSelect(const set *s, valType pos, valType id, int lock);
+
+// Returns set of concatenations x ++ y of tuples x in a and y in b with x[i] = y[j].
+// Hash join, the table is built on the smaller of a and b. Returns NULL on error.
+set *tupleJoin(const set *a, valType i, const set *b, valType j, int lock);
+
+// Queues tuple t for registration and addition to result, t is consumed. Returns -1 on error.
+int tupleBatchAdd(tupleBatch *batch, list *t, set *result);
+// Queues tuple [ x, y ] like tupleBatchAdd. Returns -1 on error.
+int tupleBatchAddPair(tupleBatch *batch, valType x, valType y, set *result);
+// Registers queued tuples and adds them to result. Returns -1 on error.
+int tupleBatchFlush(tupleBatch *batch, set *result);
+// Releases queued tuples which weren't registered.
+void tupleBatchDiscard(tupleBatch *batch);
+
+#endif /* __TUPLE_H__ */